@@ -0,0 +1,78 @@
+#include <string.h>
+#include <QDateTime>
+#include <atomic>
+#include "adcworker.h"
+
+AdcWorker::AdcWorker(CTools *tool, int intervalMs, QObject *parent) :
+    QObject(parent), tool(tool), timer(NULL), intervalMs(intervalMs), head(0), pending(0)
+{
+    memset(ring, 0, sizeof(ring));
+}
+
+// runs on the worker thread, the timer belongs to it
+void AdcWorker::start()
+{
+    if (NULL == timer) {
+        timer = new QTimer(this);
+        timer->setTimerType(Qt::PreciseTimer);
+        connect(timer, SIGNAL(timeout()), this, SLOT(sample()));
+    }
+    timer->start(intervalMs);
+    sample();
+}
+
+void AdcWorker::stop()
+{
+    if (NULL != timer) {
+        timer->stop();
+    }
+}
+
+void AdcWorker::setInterval(int ms)
+{
+    intervalMs = (ms < 1) ? 1 : ms;
+    if ((NULL != timer) && timer->isActive()) {
+        timer->start(intervalMs);
+    }
+}
+
+void AdcWorker::sample()
+{
+    int h = head.load();
+    AdcSnapshot *snap = &ring[h & (ADC_RING_SIZE - 1)];
+    int value[ADC_CHANNELS];
+
+    for (int channel = 0; channel < ADC_CHANNELS; channel++) {
+        value[channel] = tool->ReadADC(channel);
+    }
+    if ((h > 0) && (0 == memcmp(value, ring[(h - 1) & (ADC_RING_SIZE - 1)].value, sizeof(value)))) {
+        return; // unchanged, the GUI need not wake up
+    }
+    memcpy(snap->value, value, sizeof(value));
+    snap->msecs = QDateTime::currentMSecsSinceEpoch();
+    snap->seq = h;
+    head.storeRelease(h + 1);
+
+    if (pending.testAndSetOrdered(0, 1)) {
+        emit sampled();
+    }
+}
+
+// the newest snapshot, false before the first one; any thread
+bool AdcWorker::latest(AdcSnapshot *snap)
+{
+    int h, now;
+
+    pending.storeRelease(0);
+    do {
+        h = head.loadAcquire();
+        if (0 == h) {
+            return false;
+        }
+        *snap = ring[(h - 1) & (ADC_RING_SIZE - 1)];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        now = head.load();
+        // retry when the writer came around to the slot while it was copied
+    } while (now - h >= ADC_RING_SIZE - 1);
+    return true;
+}
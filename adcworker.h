@@ -0,0 +1,52 @@
+#ifndef ADCWORKER_H
+#define ADCWORKER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QTimer>
+#include "ctools.h"
+
+#define ADC_CHANNELS (3)
+#define ADC_RING_SIZE (16) // power of 2
+#define ADC_INTERVAL_MS (100)
+
+// one reading of every channel
+struct AdcSnapshot {
+    qint64 msecs;   // QDateTime::currentMSecsSinceEpoch() of the reading
+    quint32 seq;
+    int value[ADC_CHANNELS];
+};
+
+// Samples the ADC channels on its own thread at a fixed interval. A
+// reading that differs from the last one goes into a single producer
+// ring; any thread reads the newest one with latest(), without a lock.
+// sampled() is emitted once until the reader takes a snapshot, so a slow
+// GUI gets one queued call, not a backlog, and a steady input none.
+class AdcWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AdcWorker(CTools *tool, int intervalMs = ADC_INTERVAL_MS, QObject *parent = 0);
+    bool latest(AdcSnapshot *snap);
+
+signals:
+    void sampled();
+
+public slots:
+    void start();
+    void stop();
+    void setInterval(int ms);
+
+private slots:
+    void sample();
+
+private:
+    CTools *tool;
+    QTimer *timer;
+    int intervalMs;
+    AdcSnapshot ring[ADC_RING_SIZE];
+    QAtomicInt head;     // snapshots written
+    QAtomicInt pending;  // sampled() not taken yet
+};
+
+#endif // ADCWORKER_H
@@ -1,14 +1,40 @@
+#include <QThread>
+#include <time.h>
+#include <errno.h>
+#include <string.h>
 #include "ctools.h"
 
+class AdcStreamThread : public QThread
+{
+public:
+    explicit AdcStreamThread(CTools *tool) : tool(tool) {}
+
+protected:
+    void run() { tool->streamLoop(); }
+
+private:
+    CTools *tool;
+};
+
 CTools::CTools(QObject *parent) :
     QObject(parent)
 {
-    char chdata[16];
     struct fb_var_screeninfo vinfo;
     struct fb_fix_screeninfo finfo;
 
     adcfd = -1;
-    gpioFile = NULL;
+    for (int pin = 0; pin < GPIO_LINES; pin++) {
+        gpiofd[pin] = -1;
+        gpioExported[pin] = false;
+        gpioOutput[pin] = false;
+    }
+    streamThread = NULL;
+    streamRing = NULL;
+    streamMask = 0;
+    streamChannels = 0;
+    streamMode = ADC_STREAM_BURST;
+    streamPeriodNs = 0;
+    dropped.store(0);
 
 #if 1
     adcfd = open("/dev/fb0", O_RDONLY);
@@ -43,56 +69,104 @@ CTools::CTools(QObject *parent) :
    }
 
     ::ioctl(adcfd, IMX_ADC_INIT);
-
-   gpioFile = new QFile("/sys/class/gpio/unexport");
-   
-   qDebug("close all gpio");
-   for (int pin = 0; pin < 64; pin++) {
-		gpioFile->open(QIODevice::WriteOnly);
-       sprintf(chdata, "%d", pin);
-       gpioFile->write(chdata, sizeof(chdata));
-       gpioFile->close();
-   }
 }
 
-void CTools::setGPIOOutput(int gpionum) {
-    char chdata[64];
-    QFile gpiofile("/sys/class/gpio/export");
-    memset(chdata, 0, sizeof(chdata));
-    sprintf(chdata, "%d", gpionum);
+static bool writeSysfs(const char *path, const char *text)
+{
+    int fd = ::open(path, O_WRONLY);
+    bool ok = (fd >= 0) && (::write(fd, text, strlen(text)) == (ssize_t)strlen(text));
+
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    return ok;
+}
 
-    gpiofile.open(QIODevice::WriteOnly);
-    gpiofile.write(chdata, sizeof(chdata));
-    gpiofile.close();
+// the value file of the line, exported and opened once; a line left
+// exported by an earlier run is taken over as it is
+int CTools::openGPIO(int gpionum, bool output)
+{
+    char path[64];
+    char pin[16];
 
-    sprintf(chdata, "/sys/class/gpio/gpio%d/direction", gpionum);
+    if ((gpionum < 0) || (gpionum >= GPIO_LINES)) {
+        return -1;
+    }
+    if (-1 == gpiofd[gpionum]) {
+        sprintf(pin, "%d", gpionum);
+        if (writeSysfs("/sys/class/gpio/export", pin)) {
+            gpioExported[gpionum] = true;
+        } else if (EBUSY != errno) {
+            qDebug("export gpio%d fail! %s", gpionum, strerror(errno));
+            return -1;
+        }
+        sprintf(path, "/sys/class/gpio/gpio%d/value", gpionum);
+        gpiofd[gpionum] = ::open(path, O_RDWR | O_CLOEXEC);
+        if (-1 == gpiofd[gpionum]) {
+            qDebug("open %s fail! %s", path, strerror(errno));
+            return -1;
+        }
+    }
+    if (output && !gpioOutput[gpionum]) {
+        sprintf(path, "/sys/class/gpio/gpio%d/direction", gpionum);
+        if (!writeSysfs(path, "out")) {
+            qDebug("gpio%d output fail! %s", gpionum, strerror(errno));
+            return -1;
+        }
+        gpioOutput[gpionum] = true;
+    }
+    return gpiofd[gpionum];
+}
 
-    gpiofile.setFileName(chdata);
-    gpiofile.open(QIODevice::WriteOnly);
-    gpiofile.write("out", strlen("outs"));
-    gpiofile.close();
-    return;
+void CTools::setGPIOOutput(int gpionum) {
+    openGPIO(gpionum, true);
 }
 
 void CTools::setGPIOvalue(int gpionum, int value) {
-    char chdata[64];
-    QFile gpiofile;
-    char ch[4];
+    setGPIOvalues(&gpionum, &value, 1);
+}
 
-    if (0 == value) {
-        sprintf(ch, "%d", 0);
-    } else {
-        sprintf(ch, "%d", 0);
+int CTools::setGPIOvalues(const int *gpionums, const int *values, int count)
+{
+    int done = 0;
+    int pin, fd;
+    char ch;
+
+    for (int i = 0; i < count; i++) {
+        pin = gpionums[i];
+        fd = openGPIO(pin, true);
+        if (-1 == fd) {
+            continue;
+        }
+        // always written: xmltest and the engine drive the same lines
+        ch = values[i] ? '1' : '0';
+        if (::pwrite(fd, &ch, 1, 0) != 1) {
+            qDebug("write gpio%d fail! %s", pin, strerror(errno));
+            continue;
+        }
+        done++;
     }
+    return done;
+}
 
-    sprintf(chdata, ("/sys/class/gpio/gpio%d/value"), gpionum);
-
-    gpiofile.setFileName(chdata);
-    gpiofile.open(QIODevice::WriteOnly);
-    gpiofile.write(ch, sizeof(ch));
-    gpiofile.close();
+// the value file reads from the start again with pread, no seek
+int CTools::getGPIOvalues(const int *gpionums, int *values, int count)
+{
+    int done = 0;
+    int fd;
+    char ch[2];
+
+    for (int i = 0; i < count; i++) {
+        fd = openGPIO(gpionums[i], false);
+        if ((-1 == fd) || (::pread(fd, ch, sizeof(ch), 0) < 1)) {
+            values[i] = -1;
+            continue;
+        }
+        values[i] = ('1' == ch[0]);
+        done++;
+    }
+    return done;
 }
-// gpio.c set gpio pins from 0 to 31
 
 
 void CTools::Closefd()
@@ -107,11 +181,19 @@ void CTools::Closefd()
 
 CTools::~CTools()
 {
+    char pin[16];
+
+    stopStream();
     Closefd();
 
-    if (NULL != gpioFile) {
-        delete gpioFile;
-        gpioFile = NULL;
+    for (int i = 0; i < GPIO_LINES; i++) {
+        if (-1 != gpiofd[i]) {
+            ::close(gpiofd[i]);
+        }
+        if (gpioExported[i]) {
+            sprintf(pin, "%d", i);
+            writeSysfs("/sys/class/gpio/unexport", pin);
+        }
     }
 }
 
@@ -134,6 +216,15 @@ QString CTools::GetSysVersion()
 }
 
 int CTools::GetADC(int channel)
+{
+    int value = ReadADC(channel);
+
+    qDebug("Converted value: %d\n", value);
+    return value;
+}
+
+// one conversion, no log: called at the sampling rate of AdcWorker
+int CTools::ReadADC(int channel)
 {
 #if 1
     struct t_adc_convert_param convert_param;
@@ -157,9 +248,130 @@ int CTools::GetADC(int channel)
 
      ::ioctl(adcfd, IMX_ADC_CONVERT, &convert_param);
 
-     qDebug("Converted value: %hu\n", convert_param.result[0]);
      return convert_param.result[0];
 #endif
      return 0;
 }
 
+bool CTools::startStream(unsigned int channels, int rateHz, int mode, int ringSamples)
+{
+    int size = 1;
+
+    stopStream();
+    channels &= 0x7; // ADC0..ADC2
+    if ((-1 == adcfd) || (0 == channels) || (rateHz < 1)) {
+        qDebug("stream: no ADC or no channel");
+        return false;
+    }
+    while (size < ringSamples) {
+        size <<= 1;
+    }
+
+    streamRing = new AdcStreamSample[size];
+    streamMask = size - 1;
+    streamChannels = channels;
+    streamMode = mode;
+    streamPeriodNs = 1000000000LL / rateHz;
+    streamHead.storeRelease(0);
+    streamTail.storeRelease(0);
+    streamStop.storeRelease(0);
+    dropped.storeRelease(0);
+
+    streamThread = new AdcStreamThread(this);
+    streamThread->start(QThread::TimeCriticalPriority);
+    return true;
+}
+
+void CTools::stopStream()
+{
+    if (NULL == streamThread) {
+        return;
+    }
+    streamStop.storeRelease(1);
+    streamThread->wait();
+    delete streamThread;
+    streamThread = NULL;
+    delete[] streamRing;
+    streamRing = NULL;
+}
+
+// samples not released yet, contiguous in the ring: call again after
+// releaseStream() for the ones wrapped to the start
+int CTools::peekStream(const AdcStreamSample **samples)
+{
+    quint32 head = streamHead.loadAcquire();
+    quint32 tail = streamTail.load();
+    quint32 count = head - tail;
+    quint32 index = tail & streamMask;
+
+    if (count > streamMask + 1 - index) {
+        count = streamMask + 1 - index;
+    }
+    *samples = &streamRing[index];
+    return count;
+}
+
+void CTools::releaseStream(int count)
+{
+    streamTail.storeRelease(streamTail.load() + count);
+}
+
+quint32 CTools::streamDropped() const
+{
+    return dropped.load();
+}
+
+// one conversion into the next free slot, the reader sees it after the head moves
+bool CTools::streamConvert(int request, int channel)
+{
+    struct t_adc_convert_param convert_param;
+    struct timespec ts;
+    quint32 head = streamHead.load();
+    AdcStreamSample *sample;
+
+    if (head - streamTail.loadAcquire() > streamMask) {
+        dropped.fetchAndAddRelaxed(1);
+        return false;
+    }
+    sample = &streamRing[head & streamMask];
+
+    convert_param.channel = (ADC_STREAM_MULTI_CHANNEL == channel) ?
+        GER_PURPOSE_ADC0 : (enum t_channel)(GER_PURPOSE_ADC0 + channel);
+    if (::ioctl(adcfd, request, &convert_param)) {
+        return false;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    sample->ns = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    sample->channel = channel;
+    sample->count = (ADC_STREAM_MULTI_CHANNEL == channel) ? 3 : ADC_STREAM_RESULTS;
+    memcpy(sample->value, convert_param.result, sample->count * sizeof(sample->value[0]));
+    streamHead.storeRelease(head + 1);
+    return true;
+}
+
+// the stream thread: absolute deadlines, so the rate does not drift with
+// the conversion time
+void CTools::streamLoop()
+{
+    struct timespec next;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (!streamStop.loadAcquire()) {
+        if (ADC_STREAM_MULTI == streamMode) {
+            streamConvert(IMX_ADC_CONVERT_MULTICHANNEL, ADC_STREAM_MULTI_CHANNEL);
+        } else {
+            for (int channel = 0; channel < 3; channel++) {
+                if (streamChannels & (1 << channel)) {
+                    streamConvert(IMX_ADC_CONVERT, channel);
+                }
+            }
+        }
+
+        next.tv_nsec += streamPeriodNs % 1000000000LL;
+        next.tv_sec += streamPeriodNs / 1000000000LL + next.tv_nsec / 1000000000L;
+        next.tv_nsec %= 1000000000L;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+}
+
@@ -5,6 +5,8 @@
 #include <QString>
 #include <QFile>
 #include <QDebug>
+#include <QAtomicInt>
+#include <QAtomicInteger>
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -15,6 +17,24 @@
 #include <unistd.h>
 #include "imx_adc.h"
 
+#define ADC_STREAM_BURST (0)  // one IMX_ADC_CONVERT burst of 16 results per channel
+#define ADC_STREAM_MULTI (1)  // one IMX_ADC_CONVERT_MULTICHANNEL for ADC0..ADC2
+#define ADC_STREAM_RESULTS (16)
+#define ADC_STREAM_RING (4096)
+
+// one conversion of the stream
+struct AdcStreamSample {
+    qint64 ns;                // CLOCK_MONOTONIC after the ioctl
+    quint16 channel;          // 0..2, or ADC_STREAM_MULTI_CHANNEL
+    quint16 count;            // results in value
+    quint16 value[ADC_STREAM_RESULTS];
+};
+#define ADC_STREAM_MULTI_CHANNEL (0xffff) // value[n] is ADC n
+
+#define GPIO_LINES (64)
+
+class AdcStreamThread;
+
 class CTools : public QObject
 {
     Q_OBJECT
@@ -24,16 +44,54 @@ public:
     QString GetSysVersion();
     void Closefd();
     int GetADC(int channel);
+    int ReadADC(int channel);
     void setGPIOOutput(int gpionum);
     void setGPIOvalue(int gpionum, int value);
 
+    // GPIO lines through sysfs: a line is exported and its value file
+    // opened on first use, and stays open until the CTools goes away.
+    // The batched calls take many lines in one call and return the lines
+    // done.
+    int setGPIOvalues(const int *gpionums, const int *values, int count);
+    int getGPIOvalues(const int *gpionums, int *values, int count);
+
+    // Streaming acquisition: a thread converts the channels of the mask
+    // rateHz times a second into a preallocated ring. The reader takes
+    // the samples in place with peekStream() and hands them back with
+    // releaseStream(); a full ring drops the new samples and counts them.
+    bool startStream(unsigned int channels, int rateHz, int mode = ADC_STREAM_BURST,
+                     int ringSamples = ADC_STREAM_RING);
+    void stopStream();
+    int peekStream(const AdcStreamSample **samples);
+    void releaseStream(int count);
+    quint32 streamDropped() const;
+
 signals:
 
 public slots:
 
 private:
+   friend class AdcStreamThread;
+   void streamLoop();
+   bool streamConvert(int request, int channel);
+   int openGPIO(int gpionum, bool output);
+
    int adcfd;
-   QFile *gpioFile;
+   int gpiofd[GPIO_LINES];      // value file, -1 not open
+   bool gpioExported[GPIO_LINES]; // by us, unexported again at the end
+   bool gpioOutput[GPIO_LINES];
+
+   AdcStreamThread *streamThread;
+   AdcStreamSample *streamRing;
+   quint32 streamMask;        // ring size - 1, a power of 2
+   unsigned int streamChannels;
+   int streamMode;
+   qint64 streamPeriodNs;
+   // free running, they wrap: only head - tail and the low bits count
+   QAtomicInteger<quint32> streamHead; // samples written
+   QAtomicInteger<quint32> streamTail; // samples released by the reader
+   QAtomicInt streamStop;
+   QAtomicInteger<quint32> dropped;
 };
 
 #endif // CTOOLS_H
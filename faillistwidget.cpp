@@ -0,0 +1,63 @@
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include "faillistwidget.h"
+
+FailListWidget::FailListWidget(const QString &dir, QWidget *parent) :
+    QWidget(parent), dir(dir)
+{
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    QHBoxLayout *bar = new QHBoxLayout();
+    QPushButton *back = new QPushButton("Back", this);
+
+    model = new FailModel(this);
+    column = new QComboBox(this);
+    column->addItem("Net", FAIL_COLUMN_NET);
+    column->addItem("Part", FAIL_COLUMN_PART);
+    column->addItem("Verdict", FAIL_COLUMN_VERDICT);
+    column->addItem("Pins", FAIL_COLUMN_PINS);
+    text = new QLineEdit(this);
+    count = new QLabel(this);
+
+    view = new QTableView(this);
+    view->setModel(model);
+    view->setSortingEnabled(true);
+    view->sortByColumn(FAIL_COLUMN_PAIR, Qt::AscendingOrder);
+    view->setSelectionBehavior(QAbstractItemView::SelectRows);
+    view->setWordWrap(false);
+    // fixed row heights: the view never measures the rows it does not show
+    view->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    view->verticalHeader()->setDefaultSectionSize(18);
+    view->verticalHeader()->hide();
+    view->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+    view->horizontalHeader()->setStretchLastSection(true);
+    view->setColumnWidth(FAIL_COLUMN_PAIR, 56);
+    view->setColumnWidth(FAIL_COLUMN_PINS, 90);
+
+    bar->addWidget(column);
+    bar->addWidget(text);
+    bar->addWidget(count);
+    bar->addWidget(back);
+    layout->setContentsMargins(2, 2, 2, 2);
+    layout->setSpacing(2);
+    layout->addLayout(bar);
+    layout->addWidget(view);
+
+    connect(text, SIGNAL(textChanged(QString)), this, SLOT(filter()));
+    connect(column, SIGNAL(currentIndexChanged(int)), this, SLOT(filter()));
+    connect(back, SIGNAL(clicked()), this, SLOT(close()));
+    refresh();
+}
+
+// the history again, with the runs written since
+void FailListWidget::refresh()
+{
+    model->open(dir);
+    count->setText(QString("%1/%2").arg(model->matches()).arg(model->fails()));
+}
+
+void FailListWidget::filter()
+{
+    model->setFilter(column->itemData(column->currentIndex()).toInt(), text->text());
+    count->setText(QString("%1/%2").arg(model->matches()).arg(model->fails()));
+}
@@ -0,0 +1,35 @@
+#ifndef FAILLISTWIDGET_H
+#define FAILLISTWIDGET_H
+
+#include <QWidget>
+#include <QTableView>
+#include <QComboBox>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QLabel>
+#include "failmodel.h"
+
+// The FAIL list of the newest run on the whole panel: a filter on one
+// column, sorting by a click on the header, Back returns to the main window.
+class FailListWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit FailListWidget(const QString &dir = FAIL_HISTORY_DEFAULT, QWidget *parent = 0);
+
+public slots:
+    void refresh();
+
+private slots:
+    void filter();
+
+private:
+    QString dir;
+    FailModel *model;
+    QTableView *view;
+    QComboBox *column;
+    QLineEdit *text;
+    QLabel *count;
+};
+
+#endif // FAILLISTWIDGET_H
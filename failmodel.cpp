@@ -0,0 +1,231 @@
+#include <QDebug>
+#include <algorithm>
+#include "failmodel.h"
+#include "testplan.h"
+
+static const char *failColumnNames[FAIL_COLUMNS] = {
+    "A-B", "Pins", "Net", "Part", "Verdict", "Ohm",
+};
+
+FailModel::FailModel(QObject *parent) :
+    QAbstractTableModel(parent), hs(NULL), fetched(0), filterColumn(FAIL_COLUMN_NET),
+    sortColumn(-1), sortOrder(Qt::AscendingOrder)
+{
+}
+
+FailModel::~FailModel()
+{
+    HSClose(hs);
+}
+
+// map the history again, the rows written since are seen from now on
+bool FailModel::open(const QString &dir)
+{
+    HSClose(hs);
+    hs = HSOpen(dir.toLocal8Bit().constData(), 0);
+    if ((NULL == hs) || (0 == HSRuns(hs))) {
+        qDebug() << "no result history in" << dir;
+        beginResetModel();
+        all.clear();
+        shown.clear();
+        fetched = 0;
+        endResetModel();
+        return false;
+    }
+    return setRun(HSRuns(hs) - 1);
+}
+
+unsigned int FailModel::runs() const
+{
+    return (NULL == hs) ? 0 : HSRuns(hs);
+}
+
+int FailModel::fails() const
+{
+    return all.size();
+}
+
+int FailModel::matches() const
+{
+    return shown.size();
+}
+
+bool FailModel::setRun(unsigned int run)
+{
+    const struct sthsrun *r = (NULL == hs) ? NULL : HSGetRun(hs, run);
+    const char *pinName, *netName;
+    struct sthsrow row;
+    unsigned int end;
+
+    if (NULL == r) {
+        return false;
+    }
+    plan = r->plan;
+    parts.clear();
+    for (int point = 0; point < HS_POINTS; point++) {
+        if (HSPointName(hs, r->plan, point, &pinName, &netName)) {
+            pin[point] = pinName;
+            net[point] = netName;
+        } else {
+            pin[point] = QString::number(point);
+            net[point] = "-";
+        }
+    }
+
+    all.clear();
+    all.reserve(r->fails);
+    end = qMin(r->first + r->count, HSRows(hs));
+    for (unsigned int index = r->first; index < end; index++) {
+        HSGetRow(hs, index, &row);
+        if (!row.pass) {
+            all.append(index);
+        }
+    }
+    select();
+    return true;
+}
+
+QString FailModel::text(unsigned int index, int column) const
+{
+    struct sthsrow row;
+    const char *label;
+    unsigned int key;
+
+    HSGetRow(hs, index, &row);
+    switch (column) {
+    case FAIL_COLUMN_PAIR:
+        return QString("%1-%2").arg(row.pointA).arg(row.pointB);
+    case FAIL_COLUMN_PINS:
+        return pin[row.pointA] + " " + pin[row.pointB];
+    case FAIL_COLUMN_NET:
+        return net[row.pointA] + " " + net[row.pointB];
+    case FAIL_COLUMN_PART:
+        key = row.pointA * HS_POINTS + row.pointB;
+        if (!parts.contains(key)) {
+            label = HSPairLabel(hs, plan.toLocal8Bit().constData(), row.pointA, row.pointB);
+            parts.insert(key, (NULL == label) ? QString("-") : QString(label));
+        }
+        return parts.value(key);
+    case FAIL_COLUMN_VERDICT:
+        return TPVerdictName(row.verdict);
+    case FAIL_COLUMN_RESIST:
+        return QString::number(row.resist, 'g', 4);
+    }
+    return QString();
+}
+
+void FailModel::setFilter(int column, const QString &text)
+{
+    filterColumn = column;
+    filterText = text;
+    select();
+}
+
+// filter and sort all the FAILs, the view starts over with the first rows
+void FailModel::select()
+{
+    QVector<QString> keys;
+    QVector<double> values;
+    QVector<int> order;
+    QVector<unsigned int> sorted;
+    struct sthsrow row;
+
+    beginResetModel();
+    shown.clear();
+    for (int i = 0; i < all.size(); i++) {
+        if (filterText.isEmpty()
+            || text(all[i], filterColumn).contains(filterText, Qt::CaseInsensitive)) {
+            shown.append(all[i]);
+        }
+    }
+
+    if (sortColumn >= 0) {
+        keys.resize(shown.size());
+        values.resize(shown.size());
+        order.resize(shown.size());
+        for (int i = 0; i < shown.size(); i++) {
+            HSGetRow(hs, shown[i], &row);
+            if (FAIL_COLUMN_PAIR == sortColumn) {
+                values[i] = row.pointA * HS_POINTS + row.pointB;
+            } else if (FAIL_COLUMN_RESIST == sortColumn) {
+                values[i] = row.resist;
+            } else {
+                keys[i] = text(shown[i], sortColumn);
+            }
+            order[i] = i;
+        }
+        if ((FAIL_COLUMN_PAIR == sortColumn) || (FAIL_COLUMN_RESIST == sortColumn)) {
+            std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+                return values[a] < values[b];
+            });
+        } else {
+            std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+                return keys[a] < keys[b];
+            });
+        }
+        sorted.resize(shown.size());
+        for (int i = 0; i < shown.size(); i++) {
+            sorted[(Qt::AscendingOrder == sortOrder) ? i : shown.size() - 1 - i] = shown[order[i]];
+        }
+        shown = sorted;
+    }
+    fetched = qMin(shown.size(), FAIL_FETCH);
+    endResetModel();
+}
+
+void FailModel::sort(int column, Qt::SortOrder order)
+{
+    sortColumn = column;
+    sortOrder = order;
+    select();
+}
+
+int FailModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : fetched;
+}
+
+int FailModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : FAIL_COLUMNS;
+}
+
+bool FailModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && (fetched < shown.size());
+}
+
+void FailModel::fetchMore(const QModelIndex &parent)
+{
+    int count = qMin(shown.size() - fetched, FAIL_FETCH);
+
+    if (parent.isValid() || (count <= 0)) {
+        return;
+    }
+    beginInsertRows(QModelIndex(), fetched, fetched + count - 1);
+    fetched += count;
+    endInsertRows();
+}
+
+QVariant FailModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || (index.row() >= fetched)) {
+        return QVariant();
+    }
+    if (Qt::DisplayRole == role) {
+        return text(shown[index.row()], index.column());
+    }
+    if ((Qt::TextAlignmentRole == role) && (FAIL_COLUMN_RESIST == index.column())) {
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    }
+    return QVariant();
+}
+
+QVariant FailModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if ((Qt::DisplayRole != role) || (Qt::Horizontal != orientation)
+        || (section < 0) || (section >= FAIL_COLUMNS)) {
+        return QVariant();
+    }
+    return QString(failColumnNames[section]);
+}
@@ -0,0 +1,65 @@
+#ifndef FAILMODEL_H
+#define FAILMODEL_H
+
+#include <QAbstractTableModel>
+#include <QVector>
+#include <QHash>
+#include <QString>
+#include "history.h"
+
+#define FAIL_HISTORY_DEFAULT "history" // xmltest -H history
+#define FAIL_FETCH (64)                 // rows handed to the view at a time
+
+#define FAIL_COLUMN_PAIR (0)
+#define FAIL_COLUMN_PINS (1)
+#define FAIL_COLUMN_NET (2)
+#define FAIL_COLUMN_PART (3)
+#define FAIL_COLUMN_VERDICT (4)
+#define FAIL_COLUMN_RESIST (5)
+#define FAIL_COLUMNS (6)
+
+// The FAIL rows of one run of the result history, read-only. Only the row
+// indexes of the fails are kept, filtered and sorted in place; the view
+// gets FAIL_FETCH rows at a time as it scrolls, and a cell is formatted
+// from the mapped columns when the view paints it.
+class FailModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    explicit FailModel(QObject *parent = 0);
+    ~FailModel();
+
+    bool open(const QString &dir);
+    bool setRun(unsigned int run);
+    unsigned int runs() const;
+    int fails() const;
+    int matches() const;
+    void setFilter(int column, const QString &text);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+    bool canFetchMore(const QModelIndex &parent) const;
+    void fetchMore(const QModelIndex &parent);
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+
+private:
+    QString text(unsigned int index, int column) const;
+    void select();
+
+    struct sthistory *hs;
+    QString plan;
+    QVector<unsigned int> all;   // history rows of the FAILs of the run
+    QVector<unsigned int> shown; // the filtered ones, in view order
+    int fetched;
+    int filterColumn;
+    QString filterText;
+    int sortColumn;
+    Qt::SortOrder sortOrder;
+    QString pin[HS_POINTS];
+    QString net[HS_POINTS];
+    mutable QHash<unsigned int, QString> parts; // labels of the pairs seen
+};
+
+#endif // FAILMODEL_H
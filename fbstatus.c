@@ -0,0 +1,450 @@
+/*
+ * fbstatus.c: status screen of the CLI drawn straight into the framebuffer
+ *
+ *  +--------------------------+
+ *  |      TEST / PASS / FAIL   |  verdict band, 2/5 of the height
+ *  | [#########.............]  |  progress bar
+ *  | 12345/28457  FAIL 2       |  counters
+ *  | 12-57 X1-P3 X2-P1 OPEN    |  the first FAIL pairs,
+ *  | ...            +7 MORE    |  the count of the others
+ *  +--------------------------+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/fb.h>
+#include "fbstatus.h"
+
+#define FB_DAMAGE_MAX (16)
+#define FB_LINE_SIZE (64)
+
+#define FB_BLACK (0x000000)
+#define FB_WHITE (0xffffff)
+#define FB_GREY (0x404040)
+#define FB_BLUE (0x2050c0)
+#define FB_GREEN (0x00a000)
+#define FB_RED (0xe00000)
+
+struct stfbrect {
+	int x, y, w, h;
+};
+
+struct stfb {
+	int fd;
+	int width, height, bpp;   // bpp in bytes
+	int stride;               // bytes per line of the framebuffer
+	unsigned char *map;       // first visible pixel
+	void *mapbase;
+	size_t mapsize;
+	unsigned char *shadow;    // width * height * bpp, drawn into
+	struct fb_bitfield red, green, blue;
+	struct stfbrect damage[FB_DAMAGE_MAX];
+	int damages;
+
+	// layout
+	int scale;                // of the small text
+	struct stfbrect band, bar, counter;
+	int listy;
+	unsigned int lines;       // of the fail list
+
+	// the run
+	unsigned int pairs, tested, fails;
+	int barpx;                // bar pixels drawn
+	unsigned int moredrawn;   // fails counted in the "+N MORE" line
+};
+
+// 5x7 glyphs, a row per byte, 0x10 the left column
+static const char fbchars[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ-/.:+_%?";
+static const unsigned char fbfont[][7] = {
+	{0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e}, // 0
+	{0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e},
+	{0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f},
+	{0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e},
+	{0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02},
+	{0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e},
+	{0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e},
+	{0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08},
+	{0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e},
+	{0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c}, // 9
+	{0x0e, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11}, // A
+	{0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e},
+	{0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e},
+	{0x1c, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1c},
+	{0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f},
+	{0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x10},
+	{0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f},
+	{0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11},
+	{0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e},
+	{0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0c},
+	{0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11},
+	{0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f},
+	{0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11},
+	{0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11},
+	{0x0e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e},
+	{0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10},
+	{0x0e, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0d},
+	{0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11},
+	{0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e},
+	{0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04},
+	{0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e},
+	{0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04},
+	{0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0a},
+	{0x11, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x11},
+	{0x11, 0x11, 0x11, 0x0a, 0x04, 0x04, 0x04},
+	{0x1f, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1f}, // Z
+	{0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00}, // -
+	{0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}, // /
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c}, // .
+	{0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x0c, 0x00}, // :
+	{0x00, 0x04, 0x04, 0x1f, 0x04, 0x04, 0x00}, // +
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1f}, // _
+	{0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}, // %
+	{0x0e, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04}, // ?
+};
+#define FB_GLYPH_W (6) // with the space after it
+#define FB_GLYPH_H (9) // with the line spacing
+
+// a plain file of the geometry in "file:WxHxBPP"
+static int FBOpenFile(struct stfb *fb, const char *device) {
+	char path[256];
+	const char *geometry = strrchr(device, ':');
+	int bits;
+
+	if ((NULL == geometry) || (3 != sscanf(geometry + 1, "%dx%dx%d", &fb->width, &fb->height, &bits))
+		|| (fb->width <= 0) || (fb->height <= 0) || ((16 != bits) && (32 != bits))) {
+		printf("framebuffer %s: no device, and no :WxHx16 or :WxHx32 for a file\n", device);
+		return -1;
+	}
+	snprintf(path, sizeof(path), "%.*s", (int)(geometry - device), device);
+	fb->fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (fb->fd < 0) {
+		printf("Open framebuffer %s fail! %s\n", path, strerror(errno));
+		return -1;
+	}
+	fb->bpp = bits / 8;
+	fb->stride = fb->width * fb->bpp;
+	fb->mapsize = (size_t)fb->stride * fb->height;
+	if (ftruncate(fb->fd, fb->mapsize) < 0) {
+		printf("Size framebuffer %s fail! %s\n", path, strerror(errno));
+		return -1;
+	}
+	if (2 == fb->bpp) {
+		fb->red.offset = 11, fb->red.length = 5;
+		fb->green.offset = 5, fb->green.length = 6;
+		fb->blue.offset = 0, fb->blue.length = 5;
+	} else {
+		fb->red.offset = 16, fb->red.length = 8;
+		fb->green.offset = 8, fb->green.length = 8;
+		fb->blue.offset = 0, fb->blue.length = 8;
+	}
+	fb->mapbase = mmap(NULL, fb->mapsize, PROT_READ | PROT_WRITE, MAP_SHARED, fb->fd, 0);
+	fb->map = fb->mapbase;
+	return 0;
+}
+
+static int FBOpenDevice(struct stfb *fb, const char *device) {
+	struct fb_var_screeninfo var;
+	struct fb_fix_screeninfo fix;
+
+	fb->fd = open(device, O_RDWR);
+	if (fb->fd < 0) {
+		return -1;
+	}
+	if ((ioctl(fb->fd, FBIOGET_VSCREENINFO, &var) < 0) || (ioctl(fb->fd, FBIOGET_FSCREENINFO, &fix) < 0)) {
+		close(fb->fd);
+		fb->fd = -1;
+		return -1;
+	}
+	if ((16 != var.bits_per_pixel) && (32 != var.bits_per_pixel)) {
+		printf("framebuffer %s: %d bpp not supported\n", device, var.bits_per_pixel);
+		return -1;
+	}
+	fb->width = var.xres;
+	fb->height = var.yres;
+	fb->bpp = var.bits_per_pixel / 8;
+	fb->stride = fix.line_length;
+	fb->red = var.red;
+	fb->green = var.green;
+	fb->blue = var.blue;
+	fb->mapsize = fix.smem_len;
+	fb->mapbase = mmap(NULL, fb->mapsize, PROT_READ | PROT_WRITE, MAP_SHARED, fb->fd, 0);
+	fb->map = (unsigned char *)fb->mapbase + var.yoffset * fb->stride + var.xoffset * fb->bpp;
+	return 0;
+}
+
+static unsigned int FBPixel(const struct stfb *fb, unsigned int rgb) {
+	unsigned int r = (rgb >> 16) & 0xff, g = (rgb >> 8) & 0xff, b = rgb & 0xff;
+
+	return ((r >> (8 - fb->red.length)) << fb->red.offset)
+		| ((g >> (8 - fb->green.length)) << fb->green.offset)
+		| ((b >> (8 - fb->blue.length)) << fb->blue.offset);
+}
+
+static void FBDamage(struct stfb *fb, int x, int y, int w, int h) {
+	struct stfbrect *r;
+	int x1, y1, i;
+
+	if (fb->damages == FB_DAMAGE_MAX) {
+		// too many, one rectangle around them all
+		r = &fb->damage[0];
+		for (i = 1; i < fb->damages; i++) {
+			x1 = (r->x + r->w > fb->damage[i].x + fb->damage[i].w) ? r->x + r->w : fb->damage[i].x + fb->damage[i].w;
+			y1 = (r->y + r->h > fb->damage[i].y + fb->damage[i].h) ? r->y + r->h : fb->damage[i].y + fb->damage[i].h;
+			r->x = (r->x < fb->damage[i].x) ? r->x : fb->damage[i].x;
+			r->y = (r->y < fb->damage[i].y) ? r->y : fb->damage[i].y;
+			r->w = x1 - r->x;
+			r->h = y1 - r->y;
+		}
+		fb->damages = 1;
+	}
+	r = &fb->damage[fb->damages++];
+	r->x = x;
+	r->y = y;
+	r->w = w;
+	r->h = h;
+}
+
+// copy the damaged rectangles of the shadow buffer to the framebuffer
+static void FBFlush(struct stfb *fb) {
+	const struct stfbrect *r;
+	int i, y;
+
+	for (i = 0; i < fb->damages; i++) {
+		r = &fb->damage[i];
+		for (y = r->y; y < r->y + r->h; y++) {
+			memcpy(fb->map + y * fb->stride + r->x * fb->bpp,
+				fb->shadow + (y * fb->width + r->x) * fb->bpp, r->w * fb->bpp);
+		}
+	}
+	fb->damages = 0;
+}
+
+// to the screen, 0 when nothing is left
+static int FBClip(const struct stfb *fb, int *x, int *y, int *w, int *h) {
+	if (*x < 0) {
+		*w += *x;
+		*x = 0;
+	}
+	if (*y < 0) {
+		*h += *y;
+		*y = 0;
+	}
+	*w = (*x + *w > fb->width) ? fb->width - *x : *w;
+	*h = (*y + *h > fb->height) ? fb->height - *y : *h;
+	return (*w > 0) && (*h > 0);
+}
+
+// shadow buffer only, the caller damages the area
+static void FBPaint(struct stfb *fb, int x, int y, int w, int h, unsigned int rgb) {
+	unsigned int pixel = FBPixel(fb, rgb);
+	unsigned char *line;
+	int i, j;
+
+	if (!FBClip(fb, &x, &y, &w, &h)) {
+		return;
+	}
+
+	for (j = y; j < y + h; j++) {
+		line = fb->shadow + (j * fb->width + x) * fb->bpp;
+		if (2 == fb->bpp) {
+			for (i = 0; i < w; i++) {
+				((unsigned short *)line)[i] = pixel;
+			}
+		} else {
+			for (i = 0; i < w; i++) {
+				((unsigned int *)line)[i] = pixel;
+			}
+		}
+	}
+}
+
+static void FBFill(struct stfb *fb, int x, int y, int w, int h, unsigned int rgb) {
+	if (!FBClip(fb, &x, &y, &w, &h)) {
+		return;
+	}
+	FBPaint(fb, x, y, w, h, rgb);
+	FBDamage(fb, x, y, w, h);
+}
+
+// text at scale, on a background box as wide as width; the box is the damage
+static void FBText(struct stfb *fb, int x, int y, int width, int scale, unsigned int rgb,
+	unsigned int bg, const char *text) {
+	const char *glyph;
+	int row, col, n;
+
+	FBFill(fb, x, y, width, FB_GLYPH_H * scale, bg);
+	for (n = 0; text[n] && ((n + 1) * FB_GLYPH_W * scale <= width); n++) {
+		if (' ' == text[n]) {
+			continue;
+		}
+		glyph = strchr(fbchars, toupper((unsigned char)text[n]));
+		glyph = (NULL == glyph) ? strchr(fbchars, '?') : glyph;
+		for (row = 0; row < 7; row++) {
+			for (col = 0; col < 5; col++) {
+				if (fbfont[glyph - fbchars][row] & (0x10 >> col)) {
+					FBPaint(fb, x + (n * FB_GLYPH_W + col) * scale, y + (row + 1) * scale,
+						scale, scale, rgb);
+				}
+			}
+		}
+	}
+}
+
+struct stfb *FBOpen(const char *device) {
+	struct stfb *fb;
+
+	fb = calloc(1, sizeof(*fb));
+	if (NULL == fb) {
+		printf("framebuffer alloc fail!\n");
+		return NULL;
+	}
+	fb->fd = -1;
+	fb->mapbase = MAP_FAILED;
+	if ((FBOpenDevice(fb, device) < 0) && ((fb->fd >= 0) || (FBOpenFile(fb, device) < 0))) {
+		FBClose(fb);
+		return NULL;
+	}
+	if (MAP_FAILED == fb->mapbase) {
+		printf("Map framebuffer %s fail! %s\n", device, strerror(errno));
+		FBClose(fb);
+		return NULL;
+	}
+	fb->shadow = calloc((size_t)fb->width * fb->height, fb->bpp);
+	if (NULL == fb->shadow) {
+		printf("framebuffer alloc fail!\n");
+		FBClose(fb);
+		return NULL;
+	}
+
+	fb->scale = (fb->height >= 480) ? 3 : (fb->height >= 200) ? 2 : 1;
+	fb->band.x = 0;
+	fb->band.y = 0;
+	fb->band.w = fb->width;
+	fb->band.h = fb->height * 2 / 5;
+	fb->bar.x = 4;
+	fb->bar.y = fb->band.h + 4;
+	fb->bar.w = fb->width - 8;
+	fb->bar.h = fb->height / 12;
+	fb->counter.x = 4;
+	fb->counter.y = fb->bar.y + fb->bar.h + 2;
+	fb->counter.w = fb->width - 8;
+	fb->counter.h = FB_GLYPH_H * fb->scale;
+	fb->listy = fb->counter.y + fb->counter.h + 2;
+	fb->lines = (fb->height > fb->listy) ? (fb->height - fb->listy) / (FB_GLYPH_H * fb->scale) : 0;
+	printf("framebuffer %s: %dx%d %d bpp\n", device, fb->width, fb->height, fb->bpp * 8);
+	return fb;
+}
+
+void FBClose(struct stfb *fb) {
+	if (NULL == fb) {
+		return;
+	}
+	if (MAP_FAILED != fb->mapbase) {
+		munmap(fb->mapbase, fb->mapsize);
+	}
+	if (fb->fd >= 0) {
+		close(fb->fd);
+	}
+	free(fb->shadow);
+	free(fb);
+}
+
+// the word as large as the band allows, centered
+static void FBVerdict(struct stfb *fb, const char *word, unsigned int bg) {
+	int len = strlen(word);
+	int scale, sw, sh;
+
+	sw = (fb->band.w - 8) / (len * FB_GLYPH_W);
+	sh = (fb->band.h - 4) / FB_GLYPH_H;
+	scale = (sw < sh) ? sw : sh;
+	scale = (scale < 1) ? 1 : scale;
+	FBFill(fb, fb->band.x, fb->band.y, fb->band.w, fb->band.h, bg);
+	FBText(fb, (fb->band.w - len * FB_GLYPH_W * scale) / 2, (fb->band.h - FB_GLYPH_H * scale) / 2,
+		len * FB_GLYPH_W * scale, scale, FB_WHITE, bg, word);
+}
+
+static void FBCounter(struct stfb *fb) {
+	char line[FB_LINE_SIZE];
+
+	snprintf(line, sizeof(line), "%u/%u  FAIL %u", fb->tested, fb->pairs, fb->fails);
+	FBText(fb, fb->counter.x, fb->counter.y, fb->counter.w, fb->scale, FB_WHITE, FB_BLACK, line);
+}
+
+static void FBMore(struct stfb *fb) {
+	char line[FB_LINE_SIZE];
+	unsigned int more = fb->fails - (fb->lines - 1);
+
+	snprintf(line, sizeof(line), "+%u MORE", more);
+	FBText(fb, 4, fb->listy + (fb->lines - 1) * FB_GLYPH_H * fb->scale, fb->width - 8,
+		fb->scale, FB_RED, FB_BLACK, line);
+	fb->moredrawn = fb->fails;
+}
+
+void FBBegin(struct stfb *fb, unsigned int pairs) {
+	fb->pairs = pairs;
+	fb->tested = 0;
+	fb->fails = 0;
+	fb->barpx = 0;
+	fb->moredrawn = 0;
+
+	FBFill(fb, 0, 0, fb->width, fb->height, FB_BLACK);
+	FBVerdict(fb, "TEST", FB_BLUE);
+	FBFill(fb, fb->bar.x, fb->bar.y, fb->bar.w, fb->bar.h, FB_GREY);
+	FBCounter(fb);
+	FBFlush(fb);
+}
+
+void FBPair(struct stfb *fb, int pointA, int pointB, const char *nameA, const char *nameB,
+	const char *verdict, int pass) {
+	char line[FB_LINE_SIZE];
+	int px;
+
+	fb->tested++;
+	if (!pass) {
+		fb->fails++;
+		if (1 == fb->fails) {
+			FBVerdict(fb, "TEST", FB_RED);
+		}
+		if (fb->fails < fb->lines) { // the last line is for "+N MORE"
+			snprintf(line, sizeof(line), "%d-%d %s %s %s", pointA, pointB,
+				nameA[0] ? nameA : "-", nameB[0] ? nameB : "-", verdict);
+			FBText(fb, 4, fb->listy + (fb->fails - 1) * FB_GLYPH_H * fb->scale, fb->width - 8,
+				fb->scale, FB_WHITE, FB_BLACK, line);
+		}
+	}
+
+	// the bar and the counters move a pixel at a time
+	px = (fb->pairs > 0) ? (unsigned long long)fb->tested * fb->bar.w / fb->pairs : 0;
+	px = (px > fb->bar.w) ? fb->bar.w : px;
+	if ((px > fb->barpx) || (!pass && (fb->damages > 0))) {
+		FBFill(fb, fb->bar.x + fb->barpx, fb->bar.y, px - fb->barpx, fb->bar.h,
+			fb->fails ? FB_RED : FB_GREEN);
+		fb->barpx = px;
+		FBCounter(fb);
+		if ((fb->lines > 1) && (fb->fails >= fb->lines) && (fb->fails != fb->moredrawn)) {
+			FBMore(fb);
+		}
+		FBFlush(fb);
+	}
+}
+
+// no pair tested is no PASS
+void FBEnd(struct stfb *fb) {
+	int fail = fb->fails || !fb->tested;
+
+	FBVerdict(fb, fail ? "FAIL" : "PASS", fail ? FB_RED : FB_GREEN);
+	FBFill(fb, fb->bar.x + fb->barpx, fb->bar.y, fb->bar.w - fb->barpx, fb->bar.h,
+		fail ? FB_RED : FB_GREEN);
+	fb->barpx = fb->bar.w;
+	FBCounter(fb);
+	if ((fb->lines > 1) && (fb->fails >= fb->lines)) {
+		FBMore(fb);
+	}
+	FBFlush(fb);
+}
@@ -0,0 +1,28 @@
+#ifndef FBSTATUS_H
+#define FBSTATUS_H
+
+/*
+ * Operator status on the framebuffer for the CLI, without Qt: a large
+ * TEST/PASS/FAIL, a progress bar with the pair count and the first FAIL
+ * pairs. Everything is drawn into a shadow buffer; only the rectangles
+ * drawn since the last flush are copied to the mapped framebuffer, and the
+ * progress bar is only drawn again when it grows by a pixel, so a scan
+ * costs a compare per pair and a few hundred small copies per run.
+ *
+ * The device is /dev/fb0 or any file: "file:WxHxBPP", e.g.
+ * "/tmp/fb.raw:320x240x16", maps a plain file as a framebuffer of that
+ * geometry (16 bpp RGB565 or 32 bpp XRGB8888) to test without a display.
+ */
+
+#define FB_DEVICE_DEFAULT "/dev/fb0"
+
+struct stfb;
+
+struct stfb *FBOpen(const char *device);
+void FBClose(struct stfb *fb);
+void FBBegin(struct stfb *fb, unsigned int pairs);
+void FBPair(struct stfb *fb, int pointA, int pointB, const char *nameA, const char *nameB,
+	const char *verdict, int pass);
+void FBEnd(struct stfb *fb);
+
+#endif // FBSTATUS_H
@@ -0,0 +1,145 @@
+#include <QPainter>
+#include <QPaintEvent>
+#include <QTimer>
+#include <QGuiApplication>
+#include <QScreen>
+#include "heatmapwidget.h"
+
+static const QRgb heatmapColors[HEATMAP_STATES] = {
+    qRgb(64, 64, 64),   // untested
+    qRgb(0, 0, 0),      // open
+    qRgb(0, 160, 0),    // connected
+    qRgb(255, 0, 0),    // FAIL
+};
+
+HeatmapWidget::HeatmapWidget(QWidget *parent) :
+    QWidget(parent), points(HEATMAP_POINTS), frameMs(16), pending(0)
+{
+    QScreen *screen = QGuiApplication::primaryScreen();
+
+    if ((NULL != screen) && (screen->refreshRate() > 1)) {
+        frameMs = 1000 / screen->refreshRate();
+    }
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    lastFrame.start();
+    clear();
+}
+
+// the points of the plan, the image is points x points; the cells set
+// so far stay, the scan may already be running
+void HeatmapWidget::setPoints(int count)
+{
+    count = (count < 1) ? HEATMAP_POINTS : (count > HEATMAP_POINTS) ? HEATMAP_POINTS : count;
+    if (count == points) {
+        return;
+    }
+    points = count;
+    image = QImage(points, points, QImage::Format_RGB32);
+    for (int a = 0; a < points; a++) {
+        for (int b = 0; b < points; b++) {
+            image.setPixel(b, a, heatmapColors[cells[a][b].load(std::memory_order_relaxed)]);
+        }
+    }
+    update();
+}
+
+void HeatmapWidget::clear()
+{
+    for (int a = 0; a < HEATMAP_POINTS; a++) {
+        for (int w = 0; w < HEATMAP_WORDS; w++) {
+            dirty[a][w].store(0, std::memory_order_relaxed);
+        }
+        for (int b = 0; b < HEATMAP_POINTS; b++) {
+            cells[a][b].store(HEATMAP_UNTESTED, std::memory_order_relaxed);
+        }
+    }
+    for (int w = 0; w < HEATMAP_WORDS; w++) {
+        dirtyRows[w].store(0, std::memory_order_relaxed);
+    }
+    image = QImage(points, points, QImage::Format_RGB32);
+    image.fill(heatmapColors[HEATMAP_UNTESTED]);
+    update();
+}
+
+// any thread: a few relaxed stores, one queued call per frame at most
+void HeatmapWidget::setCell(int pointA, int pointB, int state)
+{
+    if ((pointA < 0) || (pointA >= HEATMAP_POINTS) || (pointB < 0) || (pointB >= HEATMAP_POINTS)
+        || (state < 0) || (state >= HEATMAP_STATES)) {
+        return;
+    }
+    cells[pointA][pointB].store(state, std::memory_order_relaxed);
+    dirty[pointA][pointB / 32].fetch_or(1u << (pointB % 32), std::memory_order_release);
+    dirtyRows[pointA / 32].fetch_or(1u << (pointA % 32), std::memory_order_release);
+
+    if (pending.testAndSetOrdered(0, 1)) {
+        QMetaObject::invokeMethod(this, "scheduleFrame", Qt::QueuedConnection);
+    }
+}
+
+// run the frame on the next display refresh after the last one
+void HeatmapWidget::scheduleFrame()
+{
+    qint64 wait = frameMs - lastFrame.elapsed();
+
+    QTimer::singleShot((wait > 0) ? wait : 0, this, SLOT(frame()));
+}
+
+// widget area of the cells firstB..lastB of row pointA
+QRect HeatmapWidget::cellRect(int pointA, int firstB, int lastB) const
+{
+    int x0 = firstB * width() / points;
+    int x1 = (lastB + 1) * width() / points;
+    int y0 = pointA * height() / points;
+    int y1 = (pointA + 1) * height() / points;
+
+    return QRect(x0, y0, qMax(x1 - x0, 1), qMax(y1 - y0, 1));
+}
+
+void HeatmapWidget::frame()
+{
+    QRegion region;
+    quint32 rows, bits;
+    int a, b, first, last;
+
+    lastFrame.restart();
+    pending.storeRelease(0); // cells set from now on ask for the next frame
+
+    for (int rw = 0; rw < HEATMAP_WORDS; rw++) {
+        rows = dirtyRows[rw].exchange(0, std::memory_order_acquire);
+        while (rows) {
+            a = rw * 32 + __builtin_ctz(rows);
+            rows &= rows - 1;
+            first = -1;
+            last = -1;
+            for (int w = 0; w < HEATMAP_WORDS; w++) {
+                bits = dirty[a][w].exchange(0, std::memory_order_acquire);
+                while (bits) {
+                    b = w * 32 + __builtin_ctz(bits);
+                    bits &= bits - 1;
+                    if ((a >= points) || (b >= points)) {
+                        continue; // outside the plan, kept in the cells
+                    }
+                    image.setPixel(b, a, heatmapColors[cells[a][b].load(std::memory_order_relaxed)]);
+                    first = (first < 0) ? b : first;
+                    last = b;
+                }
+            }
+            if (first >= 0) {
+                region += cellRect(a, first, last);
+            }
+        }
+    }
+    if (!region.isEmpty()) {
+        update(region);
+    }
+}
+
+// only the dirty region is clipped in, the scaled image is drawn there
+void HeatmapWidget::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(this);
+
+    painter.setClipRegion(event->region());
+    painter.drawImage(rect(), image);
+}
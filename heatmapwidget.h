@@ -0,0 +1,55 @@
+#ifndef HEATMAPWIDGET_H
+#define HEATMAPWIDGET_H
+
+#include <QWidget>
+#include <QImage>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <atomic>
+
+#define HEATMAP_POINTS (256) // MAXCHANNEL of the mux
+#define HEATMAP_WORDS (HEATMAP_POINTS / 32)
+
+#define HEATMAP_UNTESTED (0)
+#define HEATMAP_OPEN (1)      // PASS, no connection expected
+#define HEATMAP_CONNECTED (2) // PASS, wire, resistor or diode
+#define HEATMAP_FAIL (3)
+#define HEATMAP_STATES (4)
+
+// The A x B verdict matrix of the scan, one pixel per pair in an image
+// scaled to the widget. setCell() may be called from the scan thread: it
+// stores the cell and marks it dirty, and at most one queued frame request
+// is outstanding. A frame runs at the display refresh rate at most and
+// repaints the rows spanned by the cells changed since the last one; with
+// no new verdicts the widget does nothing. setPoints() and clear() run on
+// the GUI thread.
+class HeatmapWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit HeatmapWidget(QWidget *parent = 0);
+    void setPoints(int points);
+    void setCell(int pointA, int pointB, int state);
+    void clear();
+
+protected:
+    void paintEvent(QPaintEvent *event);
+
+private slots:
+    void scheduleFrame();
+    void frame();
+
+private:
+    QRect cellRect(int pointA, int firstB, int lastB) const;
+
+    int points;
+    int frameMs;
+    QImage image;
+    QElapsedTimer lastFrame;
+    QAtomicInt pending;
+    std::atomic<unsigned char> cells[HEATMAP_POINTS][HEATMAP_POINTS];
+    std::atomic<quint32> dirty[HEATMAP_POINTS][HEATMAP_WORDS];
+    std::atomic<quint32> dirtyRows[HEATMAP_WORDS];
+};
+
+#endif // HEATMAPWIDGET_H
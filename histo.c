@@ -0,0 +1,108 @@
+/*
+ * histo.c: log-linear latency histogram, values in ns
+ */
+#include <string.h>
+#include <time.h>
+#include "histo.h"
+
+unsigned long long NowNs(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int HistoIndex(unsigned long long value) {
+	int shift;
+
+	if (value < HISTO_SUB) {
+		return value;
+	}
+	shift = (63 - __builtin_clzll(value)) - HISTO_SUBBITS;
+	return (shift + 1) * HISTO_SUB + ((value >> shift) & (HISTO_SUB - 1));
+}
+
+// lowest value of a bucket
+static unsigned long long HistoValue(int index) {
+	int shift;
+
+	if (index < HISTO_SUB) {
+		return index;
+	}
+	shift = index / HISTO_SUB - 1;
+	return (unsigned long long)(HISTO_SUB + index % HISTO_SUB) << shift;
+}
+
+void HistoReset(struct sthisto *histo) {
+	memset(histo, 0, sizeof(*histo));
+}
+
+void HistoAdd(struct sthisto *histo, unsigned long long value) {
+	if ((0 == histo->count) || (value < histo->min)) {
+		histo->min = value;
+	}
+	if (value > histo->max) {
+		histo->max = value;
+	}
+	histo->count++;
+	histo->sum += value;
+	histo->bucket[HistoIndex(value)]++;
+}
+
+void HistoMerge(struct sthisto *histo, const struct sthisto *other) {
+	int i;
+
+	if (0 == other->count) {
+		return;
+	}
+	if ((0 == histo->count) || (other->min < histo->min)) {
+		histo->min = other->min;
+	}
+	if (other->max > histo->max) {
+		histo->max = other->max;
+	}
+	histo->count += other->count;
+	histo->sum += other->sum;
+	for (i = 0; i < HISTO_BUCKETS; i++) {
+		histo->bucket[i] += other->bucket[i];
+	}
+}
+
+// highest value of the bucket holding the percentile
+unsigned long long HistoPercentile(const struct sthisto *histo, double percent) {
+	unsigned long long rank;
+	unsigned long long seen = 0;
+	unsigned long long value;
+	int i;
+
+	if (0 == histo->count) {
+		return 0;
+	}
+	rank = (unsigned long long)(percent / 100 * histo->count + 0.5);
+	if (rank < 1) {
+		rank = 1;
+	}
+
+	for (i = 0; i < HISTO_BUCKETS; i++) {
+		seen += histo->bucket[i];
+		if (seen >= rank) {
+			value = (i + 1 < HISTO_BUCKETS) ? HistoValue(i + 1) - 1 : histo->max;
+			return (value > histo->max) ? histo->max : value;
+		}
+	}
+	return histo->max;
+}
+
+void HistoPrint(const struct sthisto *histo, const char *name, FILE *fp) {
+	if (0 == histo->count) {
+		fprintf(fp, "%-16s n=0\n", name);
+		return;
+	}
+	fprintf(fp, "%-16s n=%llu min=%.1f p50=%.1f p90=%.1f p99=%.1f p99.9=%.1f max=%.1f mean=%.1f us\n",
+		name, histo->count, histo->min / 1000.0,
+		HistoPercentile(histo, 50) / 1000.0,
+		HistoPercentile(histo, 90) / 1000.0,
+		HistoPercentile(histo, 99) / 1000.0,
+		HistoPercentile(histo, 99.9) / 1000.0,
+		histo->max / 1000.0, (double)histo->sum / histo->count / 1000.0);
+}
@@ -0,0 +1,33 @@
+#ifndef HISTO_H
+#define HISTO_H
+
+#include <stdio.h>
+
+/*
+ * Log-linear (HDR style) latency histogram: values below HISTO_SUB are
+ * exact, above that every power of two is split in HISTO_SUB buckets, so
+ * the value of a bucket is known to about 3% over the whole 64 bit range.
+ * Adding a value is a few instructions, no allocation, no lock.
+ */
+
+#define HISTO_SUBBITS (5)
+#define HISTO_SUB (1 << HISTO_SUBBITS)
+#define HISTO_BUCKETS ((64 - HISTO_SUBBITS + 1) * HISTO_SUB)
+
+struct sthisto {
+	unsigned long long count;
+	unsigned long long min;
+	unsigned long long max;
+	unsigned long long sum;
+	unsigned int bucket[HISTO_BUCKETS];
+};
+
+unsigned long long NowNs(void);
+
+void HistoReset(struct sthisto *histo);
+void HistoAdd(struct sthisto *histo, unsigned long long value);
+void HistoMerge(struct sthisto *histo, const struct sthisto *other);
+unsigned long long HistoPercentile(const struct sthisto *histo, double percent);
+void HistoPrint(const struct sthisto *histo, const char *name, FILE *fp);
+
+#endif // HISTO_H
@@ -0,0 +1,552 @@
+/*
+ * history.c: append-only memory mapped result store
+ *
+ * <dir>/meta        struct sthsmeta, row and run counts
+ * <dir>/<name>.col  one column, capacity rows, grown by doubling
+ * <dir>/head.idx    newest row of each pair, HS_POINTS * HS_POINTS
+ * <dir>/runs        struct sthsrun per run
+ * <dir>/labels      "plan label pointA pointB" lines, e.g. "a.nxf R1 12 57"
+ * <dir>/names       "plan point name net" lines, e.g. "a.nxf 12 X1-P3 W7"
+ *
+ * The row count in meta is raised after the row is written, a reader never
+ * sees a half written row. One writer at a time.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "history.h"
+
+#define HS_MAGIC "XTHIST1"
+#define HS_VERSION (1)
+#define HS_ROWS_MIN (64 * 1024)
+#define HS_RUNS_MIN (1024)
+#define HS_LABELS_MAX (4096)
+#define HS_NAMES_MAX (8192)
+
+#define COL_TIME (0)
+#define COL_RUN (1)
+#define COL_PAIR (2)   // pointA << 16 | pointB
+#define COL_PREV (3)   // older row of the same pair
+#define COL_VERDICT (4)
+#define COL_PASS (5)
+#define COL_EXPECT (6)
+#define COL_ADC0 (7)
+#define COL_ADC2 (8)
+#define COL_RESIST (9)
+#define COL_MAX (10)
+
+struct sthsmeta {
+	char magic[8];
+	unsigned int version;
+	unsigned int rows;
+	unsigned int runs;
+	unsigned int rowcap;
+	unsigned int runcap;
+};
+
+struct sthslabel {
+	char plan[HS_PLAN_SIZE];
+	char label[HS_LABEL_SIZE];
+	unsigned short pointA;
+	unsigned short pointB;
+};
+
+struct sthsname {
+	char plan[HS_PLAN_SIZE];
+	char name[HS_LABEL_SIZE];
+	char net[HS_LABEL_SIZE];
+	unsigned short point;
+};
+
+static const struct {
+	const char *name;
+	int size;
+} columns[COL_MAX] = {
+	{"time", 4},
+	{"run", 4},
+	{"pair", 4},
+	{"prev", 4},
+	{"verdict", 1},
+	{"pass", 1},
+	{"expect", 4},
+	{"adc0", 4},
+	{"adc2", 4},
+	{"resist", 4},
+};
+
+struct sthistory {
+	char dir[256];
+	int writable;
+	int fd[COL_MAX];
+	void *col[COL_MAX];
+	unsigned int rowcap;  // rows mapped
+	int metafd;
+	struct sthsmeta *meta;
+	int headfd;
+	unsigned int *head;
+	int runfd;
+	struct sthsrun *runs;
+	unsigned int runcap;  // runs mapped
+	unsigned int run;     // run being written
+	struct sthslabel *labels;
+	int totallabel;
+	struct sthsname *names;
+	int totalname;
+};
+
+static void *HSMap(struct sthistory *hs, const char *name, size_t size, int *pfd) {
+	char path[512];
+	struct stat st;
+	void *map;
+	int fd;
+
+	snprintf(path, sizeof(path), "%s/%s", hs->dir, name);
+	fd = open(path, hs->writable ? (O_RDWR | O_CREAT) : O_RDONLY, 0644);
+	if (fd < 0) {
+		printf("Open %s fail! %s\n", path, strerror(errno));
+		return NULL;
+	}
+	if (fstat(fd, &st) < 0) {
+		close(fd);
+		return NULL;
+	}
+	if (st.st_size < size) {
+		if (!hs->writable || (ftruncate(fd, size) < 0)) {
+			printf("history %s too short!\n", path);
+			close(fd);
+			return NULL;
+		}
+	}
+
+	map = mmap(NULL, size, PROT_READ | (hs->writable ? PROT_WRITE : 0), MAP_SHARED, fd, 0);
+	if (MAP_FAILED == map) {
+		printf("mmap %s fail! %s\n", path, strerror(errno));
+		close(fd);
+		return NULL;
+	}
+	*pfd = fd;
+	return map;
+}
+
+static int HSMapColumns(struct sthistory *hs, unsigned int rowcap) {
+	char name[64];
+	int i;
+
+	for (i = 0; i < COL_MAX; i++) {
+		if (NULL != hs->col[i]) {
+			munmap(hs->col[i], (size_t)hs->rowcap * columns[i].size);
+			close(hs->fd[i]);
+			hs->col[i] = NULL;
+		}
+		snprintf(name, sizeof(name), "%s.col", columns[i].name);
+		hs->col[i] = HSMap(hs, name, (size_t)rowcap * columns[i].size, &hs->fd[i]);
+		if (NULL == hs->col[i]) {
+			return -1;
+		}
+	}
+	hs->rowcap = rowcap;
+	return 0;
+}
+
+static int HSMapRuns(struct sthistory *hs, unsigned int runcap) {
+	if (NULL != hs->runs) {
+		munmap(hs->runs, (size_t)hs->runcap * sizeof(struct sthsrun));
+		close(hs->runfd);
+	}
+	hs->runs = HSMap(hs, "runs", (size_t)runcap * sizeof(struct sthsrun), &hs->runfd);
+	if (NULL == hs->runs) {
+		return -1;
+	}
+	hs->runcap = runcap;
+	return 0;
+}
+
+static void HSLoadLabels(struct sthistory *hs) {
+	char path[512];
+	char line[128];
+	struct sthslabel *l;
+	unsigned int pointA, pointB;
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/labels", hs->dir);
+	fp = fopen(path, "r");
+	if (NULL == fp) {
+		return;
+	}
+	while (fgets(line, sizeof(line), fp) && (hs->totallabel < HS_LABELS_MAX)) {
+		l = &hs->labels[hs->totallabel];
+		if (4 == sscanf(line, "%63s %31s %u %u", l->plan, l->label, &pointA, &pointB)) {
+			l->pointA = pointA;
+			l->pointB = pointB;
+			hs->totallabel++;
+		}
+	}
+	fclose(fp);
+}
+
+static void HSLoadNames(struct sthistory *hs) {
+	char path[512];
+	char line[192];
+	struct sthsname *n;
+	unsigned int point;
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/names", hs->dir);
+	fp = fopen(path, "r");
+	if (NULL == fp) {
+		return;
+	}
+	while (fgets(line, sizeof(line), fp) && (hs->totalname < HS_NAMES_MAX)) {
+		n = &hs->names[hs->totalname];
+		if ((4 == sscanf(line, "%63s %u %31s %31s", n->plan, &point, n->name, n->net))
+			&& (point < HS_POINTS)) {
+			n->point = point;
+			hs->totalname++;
+		}
+	}
+	fclose(fp);
+}
+
+struct sthistory *HSOpen(const char *dir, int writable) {
+	struct sthistory *hs;
+
+	hs = calloc(1, sizeof(*hs));
+	if (NULL == hs) {
+		printf("history alloc fail!\n");
+		return NULL;
+	}
+	snprintf(hs->dir, sizeof(hs->dir), "%s", dir);
+	hs->writable = writable;
+	hs->run = HS_NONE;
+	hs->labels = calloc(HS_LABELS_MAX, sizeof(struct sthslabel));
+	hs->names = calloc(HS_NAMES_MAX, sizeof(struct sthsname));
+	if ((NULL == hs->labels) || (NULL == hs->names)) {
+		printf("history alloc fail!\n");
+		free(hs->labels);
+		free(hs->names);
+		free(hs);
+		return NULL;
+	}
+
+	if (writable && (mkdir(dir, 0755) < 0) && (EEXIST != errno)) {
+		printf("Create history %s fail! %s\n", dir, strerror(errno));
+		goto fail;
+	}
+
+	hs->meta = HSMap(hs, "meta", sizeof(struct sthsmeta), &hs->metafd);
+	if (NULL == hs->meta) {
+		goto fail;
+	}
+	if (0 == hs->meta->magic[0]) {
+		if (!writable) {
+			goto fail;
+		}
+		memcpy(hs->meta->magic, HS_MAGIC, sizeof(HS_MAGIC));
+		hs->meta->version = HS_VERSION;
+		hs->meta->rowcap = HS_ROWS_MIN;
+		hs->meta->runcap = HS_RUNS_MIN;
+	}
+	if ((0 != memcmp(hs->meta->magic, HS_MAGIC, sizeof(HS_MAGIC)))
+		|| (HS_VERSION != hs->meta->version)) {
+		printf("history %s format fail!\n", dir);
+		goto fail;
+	}
+
+	hs->head = HSMap(hs, "head.idx", (size_t)HS_POINTS * HS_POINTS * sizeof(unsigned int), &hs->headfd);
+	if (NULL == hs->head) {
+		goto fail;
+	}
+	if (writable && (0 == hs->meta->rows)) {
+		memset(hs->head, 0xff, (size_t)HS_POINTS * HS_POINTS * sizeof(unsigned int));
+	}
+	if ((HSMapColumns(hs, hs->meta->rowcap) < 0) || (HSMapRuns(hs, hs->meta->runcap) < 0)) {
+		goto fail;
+	}
+	HSLoadLabels(hs);
+	HSLoadNames(hs);
+	return hs;
+
+fail:
+	HSClose(hs);
+	return NULL;
+}
+
+void HSClose(struct sthistory *hs) {
+	int i;
+
+	if (NULL == hs) {
+		return;
+	}
+	for (i = 0; i < COL_MAX; i++) {
+		if (NULL != hs->col[i]) {
+			munmap(hs->col[i], (size_t)hs->rowcap * columns[i].size);
+			close(hs->fd[i]);
+		}
+	}
+	if (NULL != hs->runs) {
+		munmap(hs->runs, (size_t)hs->runcap * sizeof(struct sthsrun));
+		close(hs->runfd);
+	}
+	if (NULL != hs->head) {
+		munmap(hs->head, (size_t)HS_POINTS * HS_POINTS * sizeof(unsigned int));
+		close(hs->headfd);
+	}
+	if (NULL != hs->meta) {
+		munmap(hs->meta, sizeof(struct sthsmeta));
+		close(hs->metafd);
+	}
+	free(hs->labels);
+	free(hs->names);
+	free(hs);
+}
+
+// a reader only sees the rows and runs mapped when it opened the store
+unsigned int HSRows(const struct sthistory *hs) {
+	return (hs->meta->rows < hs->rowcap) ? hs->meta->rows : hs->rowcap;
+}
+
+unsigned int HSRuns(const struct sthistory *hs) {
+	return (hs->meta->runs < hs->runcap) ? hs->meta->runs : hs->runcap;
+}
+
+int HSBeginRun(struct sthistory *hs, const char *serial, const char *plan) {
+	struct sthsrun *run;
+
+	if (hs->meta->runs == hs->runcap) {
+		if (HSMapRuns(hs, hs->runcap * 2) < 0) {
+			return -1;
+		}
+		hs->meta->runcap = hs->runcap;
+	}
+
+	run = &hs->runs[hs->meta->runs];
+	memset(run, 0, sizeof(*run));
+	run->time = time(NULL);
+	run->first = hs->meta->rows;
+	snprintf(run->serial, sizeof(run->serial), "%s", serial);
+	snprintf(run->plan, sizeof(run->plan), "%s", plan);
+	hs->run = hs->meta->runs++;
+	return hs->run;
+}
+
+int HSAppend(struct sthistory *hs, const struct sthsrow *row) {
+	unsigned int index = hs->meta->rows;
+	unsigned int key;
+
+	if ((HS_NONE == hs->run) || (row->pointA >= HS_POINTS) || (row->pointB >= HS_POINTS)) {
+		return -1;
+	}
+	if (index == hs->rowcap) {
+		if (HSMapColumns(hs, hs->rowcap * 2) < 0) {
+			return -1;
+		}
+		hs->meta->rowcap = hs->rowcap;
+	}
+
+	key = row->pointA * HS_POINTS + row->pointB;
+	((unsigned int *)hs->col[COL_TIME])[index] = hs->runs[hs->run].time;
+	((unsigned int *)hs->col[COL_RUN])[index] = hs->run;
+	((unsigned int *)hs->col[COL_PAIR])[index] = (row->pointA << 16) | row->pointB;
+	((unsigned int *)hs->col[COL_PREV])[index] = hs->head[key];
+	((unsigned char *)hs->col[COL_VERDICT])[index] = row->verdict;
+	((unsigned char *)hs->col[COL_PASS])[index] = row->pass;
+	((float *)hs->col[COL_EXPECT])[index] = row->expect;
+	((float *)hs->col[COL_ADC0])[index] = row->adc0;
+	((float *)hs->col[COL_ADC2])[index] = row->adc2;
+	((float *)hs->col[COL_RESIST])[index] = row->resist;
+	__sync_synchronize(); // the row before the index that points to it
+	hs->head[key] = index;
+	__sync_synchronize();
+	hs->meta->rows = index + 1;
+
+	hs->runs[hs->run].count++;
+	hs->runs[hs->run].fails += !row->pass;
+	return 0;
+}
+
+void HSEndRun(struct sthistory *hs) {
+	msync(hs->meta, sizeof(struct sthsmeta), MS_ASYNC);
+	hs->run = HS_NONE;
+}
+
+// name a pair of the plan of the current run, e.g. the two ends of
+// resistor R1, once per store
+int HSLabel(struct sthistory *hs, const char *label, int pointA, int pointB) {
+	struct sthslabel *l;
+	const char *plan;
+	char path[512];
+	FILE *fp;
+	int i;
+
+	if (HS_NONE == hs->run) {
+		return -1;
+	}
+	plan = hs->runs[hs->run].plan;
+	for (i = 0; i < hs->totallabel; i++) {
+		l = &hs->labels[i];
+		if ((l->pointA == pointA) && (l->pointB == pointB) && (0 == strcmp(l->label, label))
+			&& (0 == strcmp(l->plan, plan))) {
+			return 0;
+		}
+	}
+	if ((hs->totallabel == HS_LABELS_MAX) || strpbrk(plan, " \t\n")) {
+		return -1;
+	}
+
+	snprintf(path, sizeof(path), "%s/labels", hs->dir);
+	fp = fopen(path, "a");
+	if (NULL == fp) {
+		return -1;
+	}
+	fprintf(fp, "%s %s %d %d\n", plan, label, pointA, pointB);
+	fclose(fp);
+
+	l = &hs->labels[hs->totallabel++];
+	snprintf(l->plan, sizeof(l->plan), "%s", plan);
+	snprintf(l->label, sizeof(l->label), "%s", label);
+	l->pointA = pointA;
+	l->pointB = pointB;
+	return 0;
+}
+
+// name a point of the plan of the current run, its fixture pin and the
+// wire on it, once per store
+int HSName(struct sthistory *hs, int point, const char *name, const char *net) {
+	struct sthsname *n;
+	const char *plan;
+	char path[512];
+	FILE *fp;
+	int i;
+
+	if ((HS_NONE == hs->run) || (point < 0) || (point >= HS_POINTS)) {
+		return -1;
+	}
+	name = name[0] ? name : "-";
+	net = net[0] ? net : "-";
+	plan = hs->runs[hs->run].plan;
+	for (i = hs->totalname - 1; i >= 0; i--) {
+		n = &hs->names[i];
+		if ((n->point == point) && (0 == strcmp(n->plan, plan))) {
+			if ((0 == strcmp(n->name, name)) && (0 == strcmp(n->net, net))) {
+				return 0;
+			}
+			break; // renamed, the newest line wins
+		}
+	}
+	if ((hs->totalname == HS_NAMES_MAX) || strpbrk(plan, " \t\n")
+		|| strpbrk(name, " \t\n") || strpbrk(net, " \t\n")) {
+		return -1;
+	}
+
+	snprintf(path, sizeof(path), "%s/names", hs->dir);
+	fp = fopen(path, "a");
+	if (NULL == fp) {
+		return -1;
+	}
+	fprintf(fp, "%s %d %s %s\n", plan, point, name, net);
+	fclose(fp);
+
+	n = &hs->names[hs->totalname++];
+	snprintf(n->plan, sizeof(n->plan), "%s", plan);
+	snprintf(n->name, sizeof(n->name), "%s", name);
+	snprintf(n->net, sizeof(n->net), "%s", net);
+	n->point = point;
+	return 0;
+}
+
+void HSGetRow(const struct sthistory *hs, unsigned int index, struct sthsrow *row) {
+	unsigned int pair = ((unsigned int *)hs->col[COL_PAIR])[index];
+
+	row->time = ((unsigned int *)hs->col[COL_TIME])[index];
+	row->run = ((unsigned int *)hs->col[COL_RUN])[index];
+	row->pointA = pair >> 16;
+	row->pointB = pair & 0xffff;
+	row->verdict = ((unsigned char *)hs->col[COL_VERDICT])[index];
+	row->pass = ((unsigned char *)hs->col[COL_PASS])[index];
+	row->expect = ((float *)hs->col[COL_EXPECT])[index];
+	row->adc0 = ((float *)hs->col[COL_ADC0])[index];
+	row->adc2 = ((float *)hs->col[COL_ADC2])[index];
+	row->resist = ((float *)hs->col[COL_RESIST])[index];
+}
+
+const struct sthsrun *HSGetRun(const struct sthistory *hs, unsigned int run) {
+	if (run >= HSRuns(hs)) {
+		return NULL;
+	}
+	return &hs->runs[run];
+}
+
+// newest row of the pair, or HS_NONE
+unsigned int HSNewest(const struct sthistory *hs, int pointA, int pointB) {
+	unsigned int index;
+
+	if ((pointA < 0) || (pointA >= HS_POINTS) || (pointB < 0) || (pointB >= HS_POINTS)) {
+		return HS_NONE;
+	}
+	index = hs->head[pointA * HS_POINTS + pointB];
+	// skip a row the writer is adding right now
+	while ((HS_NONE != index) && (index >= HSRows(hs))) {
+		if (index >= hs->rowcap) {
+			return HS_NONE; // grown since this reader opened the store
+		}
+		index = ((unsigned int *)hs->col[COL_PREV])[index];
+	}
+	return index;
+}
+
+unsigned int HSOlder(const struct sthistory *hs, unsigned int index) {
+	return ((unsigned int *)hs->col[COL_PREV])[index];
+}
+
+// the pairs named label and the plan each one belongs to, returns how many
+int HSFindLabel(const struct sthistory *hs, const char *label, int *pointA, int *pointB,
+	const char **plan, int max) {
+	int found = 0;
+	int i;
+
+	for (i = 0; (i < hs->totallabel) && (found < max); i++) {
+		if (0 == strcmp(hs->labels[i].label, label)) {
+			pointA[found] = hs->labels[i].pointA;
+			pointB[found] = hs->labels[i].pointB;
+			plan[found] = hs->labels[i].plan;
+			found++;
+		}
+	}
+	return found;
+}
+
+// the label of a pair of the plan, e.g. the resistor between them, or NULL
+const char *HSPairLabel(const struct sthistory *hs, const char *plan, int pointA, int pointB) {
+	int i;
+
+	for (i = 0; i < hs->totallabel; i++) {
+		if ((hs->labels[i].pointA == pointA) && (hs->labels[i].pointB == pointB)
+			&& (0 == strcmp(hs->labels[i].plan, plan))) {
+			return hs->labels[i].label;
+		}
+	}
+	return NULL;
+}
+
+// the fixture pin and the wire of a point of the plan, 0 when unnamed
+int HSPointName(const struct sthistory *hs, const char *plan, int point,
+	const char **name, const char **net) {
+	int i;
+
+	// the newest line of the point counts
+	for (i = hs->totalname - 1; i >= 0; i--) {
+		if ((hs->names[i].point == point) && (0 == strcmp(hs->names[i].plan, plan))) {
+			*name = hs->names[i].name;
+			*net = hs->names[i].net;
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,73 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+/*
+ * Result history: an append-only columnar store in a directory, one file
+ * per column, all memory mapped. Every checked pair of every run is one
+ * row. Rows of the same pair are chained newest to oldest (the prev
+ * column, head.idx holds the newest row of each pair), so the history of
+ * one pair is read without touching the rows of the others.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HS_POINTS (1024)
+#define HS_NONE (0xffffffffu)
+#define HS_SERIAL_SIZE (32)
+#define HS_PLAN_SIZE (64)
+#define HS_LABEL_SIZE (32)
+
+struct sthsrow {
+	unsigned int time;    // seconds since the epoch
+	unsigned int run;
+	unsigned short pointA;
+	unsigned short pointB;
+	unsigned char verdict; // expected class, TP_VERDICT_*
+	unsigned char pass;
+	float expect;
+	float adc0;
+	float adc2;
+	float resist;
+};
+
+struct sthsrun {
+	unsigned int time;
+	unsigned int first;   // first row
+	unsigned int count;
+	unsigned int fails;
+	char serial[HS_SERIAL_SIZE];
+	char plan[HS_PLAN_SIZE];
+};
+
+struct sthistory;
+
+struct sthistory *HSOpen(const char *dir, int writable);
+void HSClose(struct sthistory *hs);
+unsigned int HSRows(const struct sthistory *hs);
+unsigned int HSRuns(const struct sthistory *hs);
+
+// writer
+int HSBeginRun(struct sthistory *hs, const char *serial, const char *plan);
+int HSAppend(struct sthistory *hs, const struct sthsrow *row);
+void HSEndRun(struct sthistory *hs);
+int HSLabel(struct sthistory *hs, const char *label, int pointA, int pointB);
+int HSName(struct sthistory *hs, int point, const char *name, const char *net);
+
+// readers
+void HSGetRow(const struct sthistory *hs, unsigned int index, struct sthsrow *row);
+const struct sthsrun *HSGetRun(const struct sthistory *hs, unsigned int run);
+unsigned int HSNewest(const struct sthistory *hs, int pointA, int pointB);
+unsigned int HSOlder(const struct sthistory *hs, unsigned int index);
+int HSFindLabel(const struct sthistory *hs, const char *label, int *pointA, int *pointB,
+	const char **plan, int max);
+const char *HSPairLabel(const struct sthistory *hs, const char *plan, int pointA, int pointB);
+int HSPointName(const struct sthistory *hs, const char *plan, int point,
+	const char **name, const char **net);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HISTORY_H
@@ -0,0 +1,163 @@
+/*
+ * hwsim.c: simulated mux/ADC backend for xmltest
+ *
+ * The node seen by ADC2 moves exponentially from its value at the last mux
+ * switch to the value set by the selected resistance, so a conversion taken
+ * too early after a switch still carries part of the previous pair.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "hwsim.h"
+
+static int simchannels = 0;
+static float *simresist = NULL;
+static struct stsimlatency simlatency;
+static struct stsimcounter simcounter;
+static unsigned int simseed = 1;
+static double simclock = 0; // us
+
+static int simselected[2] = {-1, -1};
+static double simswitchtime = 0;
+static float simswitchvalue = 0; // ADC2 at the last switch
+
+static double SimRandom() {
+	simseed = simseed * 1103515245 + 12345;
+	return (((simseed >> 1) & 0x7fffffff) + 1.0) / 2147483649.0;
+}
+
+static double SimGauss() {
+	return sqrt(-2 * log(SimRandom())) * cos(2 * M_PI * SimRandom());
+}
+
+void SimInit(int maxchannel, const struct stsimlatency *latency, unsigned int seed) {
+	int i;
+
+	SimFree();
+	simchannels = maxchannel;
+	simresist = malloc(sizeof(float) * maxchannel * maxchannel);
+	if (NULL == simresist) {
+		printf("sim alloc fail!\n");
+		exit(-1);
+	}
+	for (i = 0; i < maxchannel * maxchannel; i++) {
+		simresist[i] = SIM_OPEN;
+	}
+
+	simlatency = *latency;
+	simseed = seed;
+	simclock = 0;
+	simselected[0] = simselected[1] = -1;
+	simswitchtime = 0;
+	simswitchvalue = 0;
+	SimResetCounter();
+}
+
+void SimFree(void) {
+	free(simresist);
+	simresist = NULL;
+	simchannels = 0;
+}
+
+void SimSetResist(unsigned int pointA, unsigned int pointB, float resist) {
+	if ((pointA >= simchannels) || (pointB >= simchannels)) {
+		return;
+	}
+	simresist[pointA * simchannels + pointB] = resist;
+}
+
+float SimGetResist(unsigned int pointA, unsigned int pointB) {
+	if ((pointA >= simchannels) || (pointB >= simchannels)) {
+		return SIM_OPEN;
+	}
+	return simresist[pointA * simchannels + pointB];
+}
+
+// ADC2 once the node has settled on the selected pair
+static float SimTarget() {
+	float resist = SimGetResist(simselected[0], simselected[1]);
+
+	if (resist < 0) {
+		return 0;
+	}
+	return (SIM_ADC0 * SIM_R2) / (resist + SIM_R2 + SIM_RSWITCH * 4);
+}
+
+static float SimNode() {
+	float target = SimTarget();
+
+	if (simlatency.settle_tau_us <= 0) {
+		return target;
+	}
+	return target + (simswitchvalue - target) *
+		exp(-(simclock - simswitchtime) / simlatency.settle_tau_us);
+}
+
+void SimSelect(int domain, unsigned int num, int addrbits) {
+	simclock += simlatency.gpio_us * addrbits;
+	simcounter.gpiowrites += addrbits;
+
+	if ((domain < 0) || (domain > 1) || (simselected[domain] == num)) {
+		return;
+	}
+
+	simswitchvalue = SimNode();
+	simselected[domain] = num;
+	simswitchtime = simclock;
+	simcounter.switches++;
+}
+
+float SimReadADC(int channel, int samples) {
+	float value;
+	float sample;
+	float sum = 0;
+	char driven;
+	int i;
+
+	if (samples < 1) {
+		samples = 1;
+	}
+
+	simclock += simlatency.convert_us;
+	simcounter.converts++;
+
+	if (0 == channel) {
+		value = SIM_ADC0;
+		driven = 1;
+	} else {
+		value = SimNode();
+		driven = (SimTarget() > 0);
+	}
+
+	for (i = 0; i < samples; i++) {
+		sample = value;
+		if (driven) {
+			sample += simlatency.noise * SimGauss();
+		}
+		sample = floorf(sample + 0.5);
+		if (sample < 0) {
+			sample = 0;
+		} else if (sample > 4095) {
+			sample = 4095;
+		}
+		sum += sample;
+	}
+	return sum / samples;
+}
+
+void SimDelay(float us) {
+	simclock += us;
+}
+
+double SimClock(void) {
+	return simclock;
+}
+
+void SimGetCounter(struct stsimcounter *counter) {
+	*counter = simcounter;
+}
+
+void SimResetCounter(void) {
+	memset(&simcounter, 0, sizeof(simcounter));
+}
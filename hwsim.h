@@ -0,0 +1,41 @@
+#ifndef HWSIM_H
+#define HWSIM_H
+
+/*
+ * Simulated mux/ADC backend, used to run a scan without the fixture.
+ * The harness is a table of resistances from a point on mux A to a point
+ * on mux B. Time is a virtual clock advanced by the latency model, so a
+ * simulated scan runs at full speed and reports the time it would take.
+ */
+
+#define SIM_OPEN (-1)
+
+#define SIM_ADC0 (3900)   // ADC0 reading of the source side
+#define SIM_R2 (2000)     // sense resistor, see GetResist()
+#define SIM_RSWITCH (5.75)
+
+struct stsimlatency {
+	float gpio_us;       // one sysfs write to a mux address line
+	float convert_us;    // one IMX_ADC_CONVERT ioctl
+	float settle_tau_us; // time constant of the node after a mux switch
+	float noise;         // ADC noise in counts (1 sigma) of a driven node
+};
+
+struct stsimcounter {
+	unsigned long gpiowrites;
+	unsigned long switches;
+	unsigned long converts;
+};
+
+void SimInit(int maxchannel, const struct stsimlatency *latency, unsigned int seed);
+void SimFree(void);
+void SimSetResist(unsigned int pointA, unsigned int pointB, float resist);
+float SimGetResist(unsigned int pointA, unsigned int pointB);
+void SimSelect(int domain, unsigned int num, int addrbits);
+float SimReadADC(int channel, int samples);
+void SimDelay(float us);
+double SimClock(void);
+void SimGetCounter(struct stsimcounter *counter);
+void SimResetCounter(void);
+
+#endif // HWSIM_H
@@ -0,0 +1,435 @@
+/*
+ * liveshm.c: the live result segment of the engine
+ *
+ * One writer, the scan; the seqlocks only cost the writer two stores per
+ * row update. Everything is in host byte order, the readers run on the
+ * same station.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "liveshm.h"
+
+struct stlsshm {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int size;
+	unsigned int points;
+	unsigned int seq;      // seqlock of the summary and the names
+	struct stlssummary summary;
+	char names[LS_POINTS][LS_POINT_NAME_SIZE];
+	unsigned int tested;
+	unsigned int fails;
+	unsigned int changes;  // row updates
+	unsigned int rowseq[LS_POINTS];
+	struct stlscell cells[LS_POINTS][LS_POINTS];
+};
+
+// the wakeups, written by the readers too
+struct stlswait {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int armed;    // bit per reader slot, the next change writes its FIFO
+	unsigned int reserved;
+	struct {
+		int pid;           // 0 free
+		unsigned int gen;  // counts the readers of the slot
+	} readers[LS_READERS];
+};
+
+struct stlive {
+	struct stlsshm *shm;
+	int writable;
+	struct stlswait *wait;
+	int fifofd[LS_READERS];
+	unsigned int fifogen[LS_READERS];
+	char name[64];
+};
+
+struct stlsnotify {
+	struct stlswait *wait;
+	int slot;
+	int fd;
+};
+
+static void LSFifoPath(char *path, int size, const char *name, int slot) {
+	snprintf(path, size, "%s/%s.%d.fifo", LS_FIFO_DIR, ('/' == name[0]) ? name + 1 : name, slot);
+}
+
+// the wait segment, whichever side comes first sets it up
+static struct stlswait *LSWaitMap(const char *name) {
+	char path[80];
+	struct stlswait *wait;
+	struct stat st;
+	int fd;
+
+	snprintf(path, sizeof(path), "%s.wait", name);
+	fd = shm_open(path, O_RDWR | O_CREAT, 0644);
+	if (fd < 0) {
+		printf("Open live %s fail! %s\n", path, strerror(errno));
+		return NULL;
+	}
+	if ((fstat(fd, &st) < 0) || ((st.st_size < (off_t)sizeof(struct stlswait))
+		&& (ftruncate(fd, sizeof(struct stlswait)) < 0))) {
+		printf("Size live %s fail! %s\n", path, strerror(errno));
+		close(fd);
+		return NULL;
+	}
+	wait = mmap(NULL, sizeof(struct stlswait), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (MAP_FAILED == wait) {
+		printf("Map live %s fail! %s\n", path, strerror(errno));
+		return NULL;
+	}
+	if ((LS_MAGIC != wait->magic) || (LS_VERSION != wait->version)) {
+		memset(wait, 0, sizeof(*wait)); // new, or of an older engine
+		wait->version = LS_VERSION;
+		__atomic_store_n(&wait->magic, LS_MAGIC, __ATOMIC_RELEASE);
+	}
+	return wait;
+}
+
+// a reader slot and its FIFO, opened read-write: it never blocks, and the
+// reader never sees the end of file when an engine goes away
+struct stlsnotify *LSNotifyOpen(const char *name) {
+	struct stlsnotify *notify;
+	char path[256];
+	int pid;
+	int i;
+
+	notify = calloc(1, sizeof(*notify));
+	if (NULL == notify) {
+		printf("live alloc fail!\n");
+		return NULL;
+	}
+	notify->wait = LSWaitMap(name);
+	if (NULL == notify->wait) {
+		free(notify);
+		return NULL;
+	}
+
+	// a free slot, or one of a reader gone without closing it
+	notify->slot = -1;
+	for (i = 0; (i < LS_READERS) && (notify->slot < 0); i++) {
+		pid = __atomic_load_n(&notify->wait->readers[i].pid, __ATOMIC_ACQUIRE);
+		if (((0 == pid) || ((kill(pid, 0) < 0) && (ESRCH == errno)))
+			&& __atomic_compare_exchange_n(&notify->wait->readers[i].pid, &pid, getpid(),
+				0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			notify->slot = i;
+		}
+	}
+	if (notify->slot < 0) {
+		printf("live %s: %d readers, no slot left\n", name, LS_READERS);
+		munmap(notify->wait, sizeof(struct stlswait));
+		free(notify);
+		return NULL;
+	}
+	__atomic_and_fetch(&notify->wait->armed, ~(1u << notify->slot), __ATOMIC_SEQ_CST);
+	__atomic_add_fetch(&notify->wait->readers[notify->slot].gen, 1, __ATOMIC_RELEASE);
+
+	LSFifoPath(path, sizeof(path), name, notify->slot);
+	if ((mkfifo(path, 0644) < 0) && (EEXIST != errno)) {
+		printf("Create live FIFO %s fail! %s\n", path, strerror(errno));
+		notify->fd = -1;
+	} else {
+		notify->fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+		if (notify->fd < 0) {
+			printf("Open live FIFO %s fail! %s\n", path, strerror(errno));
+		}
+	}
+	if (notify->fd < 0) {
+		LSNotifyClose(notify);
+		return NULL;
+	}
+	return notify;
+}
+
+void LSNotifyClose(struct stlsnotify *notify) {
+	if (NULL == notify) {
+		return;
+	}
+	__atomic_and_fetch(&notify->wait->armed, ~(1u << notify->slot), __ATOMIC_SEQ_CST);
+	__atomic_store_n(&notify->wait->readers[notify->slot].pid, 0, __ATOMIC_RELEASE);
+	if (notify->fd >= 0) {
+		close(notify->fd);
+	}
+	munmap(notify->wait, sizeof(struct stlswait));
+	free(notify);
+}
+
+int LSNotifyFd(const struct stlsnotify *notify) {
+	return notify->fd;
+}
+
+// writer: one byte to every armed reader; the FIFO of a slot is opened
+// again when another reader took it over
+static void LSNotify(struct stlive *live) {
+	char path[256];
+	unsigned int armed;
+	unsigned int gen;
+	char c = 0;
+	int i;
+
+	if ((NULL == live->wait) || (0 == __atomic_load_n(&live->wait->armed, __ATOMIC_SEQ_CST))) {
+		return;
+	}
+	armed = __atomic_exchange_n(&live->wait->armed, 0, __ATOMIC_SEQ_CST);
+	while (armed) {
+		i = __builtin_ctz(armed);
+		armed &= armed - 1;
+		gen = __atomic_load_n(&live->wait->readers[i].gen, __ATOMIC_ACQUIRE);
+		if ((live->fifofd[i] < 0) || (live->fifogen[i] != gen)) {
+			if (live->fifofd[i] >= 0) {
+				close(live->fifofd[i]);
+			}
+			// read-write too, a reader going away is no SIGPIPE
+			LSFifoPath(path, sizeof(path), live->name, i);
+			live->fifofd[i] = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+			live->fifogen[i] = gen;
+		}
+		if ((live->fifofd[i] >= 0) && (write(live->fifofd[i], &c, 1) < 0)) {
+			// full, the reader has a wakeup pending anyway
+		}
+	}
+}
+
+// reader: forget the wakeups so far, the next change of the engine writes
+// the FIFO again; check LSChanges() after arming, a change may have come
+// in just before
+void LSArm(struct stlsnotify *notify) {
+	char buf[64];
+
+	while (read(notify->fd, buf, sizeof(buf)) > 0) {
+	}
+	__atomic_or_fetch(&notify->wait->armed, 1u << notify->slot, __ATOMIC_SEQ_CST);
+}
+
+struct stlive *LSOpen(const char *name, int writable) {
+	struct stlive *live;
+	struct stat st;
+	int fd, a;
+
+	live = calloc(1, sizeof(*live));
+	if (NULL == live) {
+		printf("live alloc fail!\n");
+		return NULL;
+	}
+	live->writable = writable;
+	for (a = 0; a < LS_READERS; a++) {
+		live->fifofd[a] = -1;
+	}
+	snprintf(live->name, sizeof(live->name), "%s", name);
+
+	fd = shm_open(name, writable ? (O_RDWR | O_CREAT) : O_RDONLY, 0644);
+	if (fd < 0) {
+		if (writable) {
+			printf("Open live %s fail! %s\n", name, strerror(errno));
+		}
+		free(live);
+		return NULL;
+	}
+	if (writable && (ftruncate(fd, sizeof(struct stlsshm)) < 0)) {
+		printf("Size live %s fail! %s\n", name, strerror(errno));
+		close(fd);
+		free(live);
+		return NULL;
+	}
+	if (!writable && ((fstat(fd, &st) < 0) || (st.st_size < (off_t)sizeof(struct stlsshm)))) {
+		close(fd); // the engine did not set it up yet
+		free(live);
+		return NULL;
+	}
+
+	live->shm = mmap(NULL, sizeof(struct stlsshm), writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+		MAP_SHARED, fd, 0);
+	close(fd);
+	if (MAP_FAILED == live->shm) {
+		printf("Map live %s fail! %s\n", name, strerror(errno));
+		free(live);
+		return NULL;
+	}
+
+	if (writable) {
+		// an old segment of a crashed engine may be left odd
+		__atomic_store_n(&live->shm->seq, 0, __ATOMIC_RELEASE);
+		for (a = 0; a < LS_POINTS; a++) {
+			__atomic_store_n(&live->shm->rowseq[a], live->shm->rowseq[a] & ~1u, __ATOMIC_RELEASE);
+		}
+		live->shm->magic = LS_MAGIC;
+		live->shm->version = LS_VERSION;
+		live->shm->size = sizeof(struct stlsshm);
+		live->shm->points = LS_POINTS;
+		live->wait = LSWaitMap(name);
+		LSNotify(live); // announce the engine to the readers waiting for it
+	} else if ((LS_MAGIC != live->shm->magic) || (LS_VERSION != live->shm->version)
+		|| (sizeof(struct stlsshm) != live->shm->size)) {
+		munmap(live->shm, sizeof(struct stlsshm));
+		free(live);
+		return NULL;
+	}
+	return live;
+}
+
+void LSClose(struct stlive *live) {
+	int a;
+
+	if (NULL == live) {
+		return;
+	}
+	for (a = 0; a < LS_READERS; a++) {
+		if (live->fifofd[a] >= 0) {
+			close(live->fifofd[a]);
+		}
+	}
+	if (NULL != live->wait) {
+		munmap(live->wait, sizeof(struct stlswait));
+	}
+	munmap(live->shm, sizeof(struct stlsshm));
+	free(live);
+}
+
+static void LSWriteBegin(unsigned int *seq) {
+	__atomic_store_n(seq, *seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void LSWriteEnd(unsigned int *seq) {
+	__atomic_store_n(seq, *seq + 1, __ATOMIC_RELEASE);
+}
+
+// the sequence to read under, 0 bit clear
+static unsigned int LSReadBegin(const unsigned int *seq) {
+	unsigned int s;
+
+	while ((s = __atomic_load_n(seq, __ATOMIC_ACQUIRE)) & 1) {
+		sched_yield();
+	}
+	return s;
+}
+
+static int LSReadRetry(const unsigned int *seq, unsigned int s) {
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(seq, __ATOMIC_RELAXED) != s;
+}
+
+void LSBeginRun(struct stlive *live, const char *plan, const char *serial, unsigned int pairs,
+		unsigned int points) {
+	struct stlsshm *shm = live->shm;
+	int a;
+
+	LSWriteBegin(&shm->seq);
+	shm->summary.run++;
+	shm->summary.state = LS_RUNNING;
+	shm->summary.pairs = pairs;
+	shm->summary.points = (points > LS_POINTS) ? LS_POINTS : points;
+	shm->summary.start = time(NULL);
+	snprintf(shm->summary.plan, sizeof(shm->summary.plan), "%s", plan);
+	snprintf(shm->summary.serial, sizeof(shm->summary.serial), "%s", serial);
+	memset(shm->names, 0, sizeof(shm->names));
+	__atomic_store_n(&shm->tested, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&shm->fails, 0, __ATOMIC_RELAXED);
+	LSWriteEnd(&shm->seq);
+
+	for (a = 0; a < LS_POINTS; a++) {
+		LSWriteBegin(&shm->rowseq[a]);
+		memset(shm->cells[a], 0, sizeof(shm->cells[a]));
+		LSWriteEnd(&shm->rowseq[a]);
+	}
+	__atomic_add_fetch(&shm->changes, 1, __ATOMIC_RELEASE);
+	LSNotify(live);
+}
+
+void LSName(struct stlive *live, int point, const char *name) {
+	struct stlsshm *shm = live->shm;
+
+	if ((point < 0) || (point >= LS_POINTS)) {
+		return;
+	}
+	LSWriteBegin(&shm->seq);
+	snprintf(shm->names[point], sizeof(shm->names[point]), "%s", name);
+	LSWriteEnd(&shm->seq);
+}
+
+void LSPair(struct stlive *live, int pointA, int pointB, int verdict, int pass,
+	float expect, float resist) {
+	struct stlsshm *shm = live->shm;
+	struct stlscell *cell;
+
+	if ((pointA < 0) || (pointA >= LS_POINTS) || (pointB < 0) || (pointB >= LS_POINTS)) {
+		return;
+	}
+	cell = &shm->cells[pointA][pointB];
+	LSWriteBegin(&shm->rowseq[pointA]);
+	cell->expect = expect;
+	cell->resist = resist;
+	cell->verdict = verdict;
+	cell->state = pass ? LS_PASS : LS_FAIL;
+	LSWriteEnd(&shm->rowseq[pointA]);
+
+	__atomic_store_n(&shm->tested, shm->tested + 1, __ATOMIC_RELAXED);
+	if (!pass) {
+		__atomic_store_n(&shm->fails, shm->fails + 1, __ATOMIC_RELAXED);
+	}
+	__atomic_store_n(&shm->changes, shm->changes + 1, __ATOMIC_RELEASE);
+	LSNotify(live);
+}
+
+void LSEndRun(struct stlive *live) {
+	struct stlsshm *shm = live->shm;
+
+	LSWriteBegin(&shm->seq);
+	shm->summary.state = LS_DONE;
+	LSWriteEnd(&shm->seq);
+	__atomic_add_fetch(&shm->changes, 1, __ATOMIC_RELEASE);
+	LSNotify(live);
+}
+
+void LSGetSummary(const struct stlive *live, struct stlssummary *summary) {
+	unsigned int s;
+
+	do {
+		s = LSReadBegin(&live->shm->seq);
+		*summary = live->shm->summary;
+	} while (LSReadRetry(&live->shm->seq, s));
+}
+
+void LSGetProgress(const struct stlive *live, unsigned int *tested, unsigned int *fails) {
+	*tested = __atomic_load_n(&live->shm->tested, __ATOMIC_RELAXED);
+	*fails = __atomic_load_n(&live->shm->fails, __ATOMIC_RELAXED);
+}
+
+unsigned int LSChanges(const struct stlive *live) {
+	return __atomic_load_n(&live->shm->changes, __ATOMIC_ACQUIRE);
+}
+
+unsigned int LSRowSeq(const struct stlive *live, int pointA) {
+	return __atomic_load_n(&live->shm->rowseq[pointA], __ATOMIC_ACQUIRE);
+}
+
+// copy the row, returns its sequence: unchanged rows need not be read again
+unsigned int LSGetRow(const struct stlive *live, int pointA, struct stlscell *cells) {
+	unsigned int s;
+
+	do {
+		s = LSReadBegin(&live->shm->rowseq[pointA]);
+		memcpy(cells, live->shm->cells[pointA], sizeof(live->shm->cells[pointA]));
+	} while (LSReadRetry(&live->shm->rowseq[pointA], s));
+	return s;
+}
+
+void LSGetName(const struct stlive *live, int point, char *name, int size) {
+	unsigned int s;
+
+	do {
+		s = LSReadBegin(&live->shm->seq);
+		snprintf(name, size, "%.*s", LS_POINT_NAME_SIZE - 1, live->shm->names[point]);
+	} while (LSReadRetry(&live->shm->seq, s));
+}
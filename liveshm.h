@@ -0,0 +1,92 @@
+#ifndef LIVESHM_H
+#define LIVESHM_H
+
+/*
+ * Live results: the engine publishes the run in progress in a POSIX shared
+ * memory segment, the GUI and other local tools map it read-only. The run
+ * summary and every row of the verdict matrix are seqlocked: the writer
+ * makes the sequence odd, writes, makes it even again; a reader copies and
+ * retries when the sequence was odd or changed meanwhile. changes counts
+ * the rows written, so an idle reader only loads one word per poll, and
+ * the row sequences tell which rows to copy.
+ *
+ * A reader need not poll at all: LSNotifyOpen() takes one of LS_READERS
+ * slots in a second, small segment (name.wait), the only one readers
+ * write, and gives the reader a FIFO of its own. After LSArm() sets the
+ * bit of its slot, the engine writes one byte to that FIFO on its next
+ * change, and once when it opens the segment, so a reader waiting for the
+ * engine to come up learns about that too. With no reader armed the
+ * engine loads one word per change.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LS_NAME_DEFAULT "/xmltest"
+#define LS_FIFO_DIR "/dev/shm" // reader 0 of /xmltest waits on /dev/shm/xmltest.0.fifo
+#define LS_MAGIC (0x534c5458) // "XTLS"
+#define LS_VERSION (3)
+#define LS_READERS (16)
+#define LS_POINTS (256)
+#define LS_PLAN_SIZE (64)
+#define LS_SERIAL_SIZE (32)
+#define LS_POINT_NAME_SIZE (32)
+
+#define LS_IDLE (0)
+#define LS_RUNNING (1)
+#define LS_DONE (2)
+
+#define LS_UNTESTED (0)
+#define LS_PASS (1)
+#define LS_FAIL (2)
+
+struct stlssummary {
+	unsigned int run;      // counts the runs of the engine
+	unsigned int state;    // LS_IDLE, LS_RUNNING, LS_DONE
+	unsigned int pairs;    // checks of the run, 0 unknown
+	unsigned int points;   // of the verdict matrix, 0 unknown: LS_POINTS
+	unsigned long long start; // time() of the run
+	char plan[LS_PLAN_SIZE];
+	char serial[LS_SERIAL_SIZE];
+};
+
+struct stlscell {
+	float expect;          // adcarray value
+	float resist;
+	unsigned char verdict; // expected class, TP_VERDICT_*
+	unsigned char state;   // LS_UNTESTED, LS_PASS, LS_FAIL
+	unsigned short reserved;
+};
+
+struct stlive;
+struct stlsnotify;
+
+struct stlive *LSOpen(const char *name, int writable);
+void LSClose(struct stlive *live);
+
+// writer, the engine
+void LSBeginRun(struct stlive *live, const char *plan, const char *serial, unsigned int pairs,
+	unsigned int points);
+void LSName(struct stlive *live, int point, const char *name);
+void LSPair(struct stlive *live, int pointA, int pointB, int verdict, int pass,
+	float expect, float resist);
+void LSEndRun(struct stlive *live);
+
+// readers
+void LSGetSummary(const struct stlive *live, struct stlssummary *summary);
+void LSGetProgress(const struct stlive *live, unsigned int *tested, unsigned int *fails);
+unsigned int LSChanges(const struct stlive *live);
+unsigned int LSRowSeq(const struct stlive *live, int pointA);
+unsigned int LSGetRow(const struct stlive *live, int pointA, struct stlscell *cells);
+void LSGetName(const struct stlive *live, int point, char *name, int size);
+struct stlsnotify *LSNotifyOpen(const char *name);
+void LSNotifyClose(struct stlsnotify *notify);
+int LSNotifyFd(const struct stlsnotify *notify);
+void LSArm(struct stlsnotify *notify);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIVESHM_H
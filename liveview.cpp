@@ -0,0 +1,134 @@
+#include <string.h>
+#include <QDebug>
+#include "liveview.h"
+#include "testplan.h"
+
+LiveView::LiveView(HeatmapWidget *heatmap, const char *name, int intervalMs, QObject *parent) :
+    QObject(parent), heatmap(heatmap), name(name), notifier(NULL), timer(NULL),
+    intervalMs(intervalMs), live(NULL), changes(0), run(0)
+{
+    memset(state, HEATMAP_UNTESTED, sizeof(state));
+    memset(rowSeq, 0xff, sizeof(rowSeq));
+    notify = LSNotifyOpen(name);
+    if (NULL == notify) {
+        timer = new QTimer(this);
+        connect(timer, SIGNAL(timeout()), this, SLOT(poll()));
+        timer->start(intervalMs);
+    } else {
+        notifier = new QSocketNotifier(LSNotifyFd(notify), QSocketNotifier::Read, this);
+        connect(notifier, SIGNAL(activated(int)), this, SLOT(wake()));
+    }
+    arm();
+}
+
+LiveView::~LiveView()
+{
+    LSClose(live);
+    LSNotifyClose(notify);
+}
+
+bool LiveView::attach()
+{
+    live = LSOpen(name.toLocal8Bit().constData(), 0);
+    if (NULL == live) {
+        return false;
+    }
+    qDebug() << "live results" << name;
+    changes = LSChanges(live) - 1; // read it all on the first poll
+    run = 0;
+    return true;
+}
+
+// the engine has news: read them, listen again after the interval
+void LiveView::wake()
+{
+    notifier->setEnabled(false);
+    poll();
+    QTimer::singleShot(intervalMs, this, SLOT(arm()));
+}
+
+void LiveView::arm()
+{
+    if (NULL == notify) {
+        poll();
+        return;
+    }
+    LSArm(notify);
+    if (NULL == live) {
+        attach();
+    }
+    if ((NULL != live) && (LSChanges(live) != changes)) {
+        wake(); // changed before it was armed
+        return;
+    }
+    notifier->setEnabled(true);
+}
+
+static int heatmapState(const struct stlscell *cell)
+{
+    if (LS_FAIL == cell->state) {
+        return HEATMAP_FAIL;
+    }
+    if (LS_PASS != cell->state) {
+        return HEATMAP_UNTESTED;
+    }
+    switch (cell->verdict) {
+    case TP_VERDICT_OPEN:
+    case TP_VERDICT_DISCONNECT:
+    case TP_VERDICT_NONE:
+        return HEATMAP_OPEN;
+    default:
+        return HEATMAP_CONNECTED;
+    }
+}
+
+void LiveView::updateRow(int pointA)
+{
+    struct stlscell cells[LS_POINTS];
+    int s;
+
+    rowSeq[pointA] = LSGetRow(live, pointA, cells);
+    for (int b = 0; b < LS_POINTS; b++) {
+        s = heatmapState(&cells[b]);
+        if (s != state[pointA][b]) {
+            state[pointA][b] = s;
+            heatmap->setCell(pointA, b, s);
+        }
+    }
+}
+
+void LiveView::poll()
+{
+    struct stlssummary summary;
+    unsigned int now, tested, fails;
+
+    if ((NULL == live) && !attach()) {
+        return;
+    }
+    now = LSChanges(live);
+    if (now == changes) {
+        return;
+    }
+    changes = now;
+
+    LSGetSummary(live, &summary);
+    if (summary.run != run) {
+        // a new run starts from an untested matrix
+        run = summary.run;
+        heatmap->clear();
+        heatmap->setPoints(summary.points); // 0 from an older engine: all
+        memset(state, HEATMAP_UNTESTED, sizeof(state));
+        memset(rowSeq, 0xff, sizeof(rowSeq));
+    }
+    for (int a = 0; a < LS_POINTS; a++) {
+        if (LSRowSeq(live, a) != rowSeq[a]) {
+            updateRow(a);
+        }
+    }
+
+    LSGetProgress(live, &tested, &fails);
+    emit progress(QString("%1 %2: %3/%4 pairs, %5 FAIL%6")
+                  .arg(summary.plan).arg(summary.serial)
+                  .arg(tested).arg(summary.pairs).arg(fails)
+                  .arg((LS_DONE == summary.state) ? ", done" : ""));
+}
@@ -0,0 +1,48 @@
+#ifndef LIVEVIEW_H
+#define LIVEVIEW_H
+
+#include <QObject>
+#include <QTimer>
+#include <QSocketNotifier>
+#include "liveshm.h"
+#include "heatmapwidget.h"
+
+// Follows the run of the engine in its live segment (xmltest -M). The
+// engine wakes it through a FIFO of its own, an idle GUI does not run at
+// all. On a wakeup the rows whose sequence moved are copied and
+// their changed cells go to the heatmap; the next wakeup is armed one
+// interval later, so a running scan updates the GUI at that rate at most.
+class LiveView : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LiveView(HeatmapWidget *heatmap, const char *name = LS_NAME_DEFAULT,
+                      int intervalMs = 50, QObject *parent = 0);
+    ~LiveView();
+
+signals:
+    void progress(const QString &text);
+
+private slots:
+    void wake();
+    void arm();
+    void poll();
+
+private:
+    bool attach();
+    void updateRow(int pointA);
+
+    HeatmapWidget *heatmap;
+    QString name;
+    QSocketNotifier *notifier;
+    QTimer *timer; // without the FIFO only
+    int intervalMs;
+    struct stlsnotify *notify;
+    struct stlive *live;
+    unsigned int changes;
+    unsigned int run;
+    unsigned int rowSeq[LS_POINTS];
+    unsigned char state[LS_POINTS][LS_POINTS]; // HEATMAP_* shown
+};
+
+#endif // LIVEVIEW_H
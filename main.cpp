@@ -1,27 +1,100 @@
 #include "mainwindow.h"
 #include <QApplication>
-#include <QtGui>
-//#include <QtWebKitWidgets>
-#include <QWebView>
-#include <QtWebKit>
+#include <QPluginLoader>
+#include <QElapsedTimer>
+#include <QEvent>
 #include <QDebug>
 #include <QUrl>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "webviewinterface.h"
+
+// ms since the kernel started the process, the dynamic linking included
+static qint64 msSinceExec()
+{
+    char stat[512];
+    char *p;
+    unsigned long long start = 0;
+    struct timespec now;
+    FILE *fp = fopen("/proc/self/stat", "r");
+    int i;
+
+    if (NULL == fp) {
+        return -1;
+    }
+    p = fgets(stat, sizeof(stat), fp);
+    fclose(fp);
+    // field 22, after the command in parentheses
+    p = (NULL == p) ? NULL : strrchr(stat, ')');
+    for (i = 2; (NULL != p) && (i < 22); i++) {
+        p = strchr(p + 1, ' ');
+    }
+    if ((NULL == p) || (1 != sscanf(p, " %llu", &start))) {
+        return -1;
+    }
+    clock_gettime(CLOCK_BOOTTIME, &now);
+    return now.tv_sec * 1000LL + now.tv_nsec / 1000000 - start * 1000 / sysconf(_SC_CLK_TCK);
+}
+
+// prints the start-to-first-frame time once the window has been painted
+class FirstFrame : public QObject
+{
+public:
+    explicit FirstFrame(QObject *parent = 0) : QObject(parent) { sinceMain.start(); }
+    bool eventFilter(QObject *watched, QEvent *event)
+    {
+        if (QEvent::Paint == event->type()) {
+            watched->removeEventFilter(this);
+            qDebug("first frame %lld ms after main, %lld ms after exec",
+                   sinceMain.elapsed(), msSinceExec());
+        }
+        return false;
+    }
+
+private:
+    QElapsedTimer sinceMain;
+};
+
+// the web view plugin, loaded on the first page shown
+static QWidget *createWebView(const QUrl &url)
+{
+    QPluginLoader loader(QCoreApplication::applicationDirPath() + "/plugins/webview");
+    WebViewInterface *web = qobject_cast<WebViewInterface *>(loader.instance());
+
+    if (NULL == web) {
+        qDebug() << "web view:" << loader.errorString();
+        return NULL;
+    }
+    return web->createView(url);
+}
 
 int main(int argc, char *argv[])
 {
     int i = 0;
     char ch = 'a';
     QApplication a(argc, argv);
-#if 0
-    QWebView view;
-    view.move(QPoint(0,0));
-    view.setFixedSize(320,240);
-    view.show();
-    view.setUrl(QUrl("http://www.12306.cn/"));
-#else
+    FirstFrame firstFrame;
+
+    // test1 -web <url>: only the page, WebKit is loaded for it
+    if ((argc > 2) && (0 == strcmp(argv[1], "-web"))) {
+        QWidget *view = createWebView(QUrl(argv[2]));
+
+        if (NULL == view) {
+            return -1;
+        }
+        view->installEventFilter(&firstFrame);
+        view->move(QPoint(0,0));
+        view->setFixedSize(320,240);
+        view->show();
+        return a.exec();
+    }
+
     MainWindow w;
 
     qDebug() <<__FUNCTION__<<endl;
+    w.installEventFilter(&firstFrame);
     w.setFixedSize(320,240);
     w.move(QPoint(0,0));
     //w.setWindowFlags(Qt::SplashScreen);
@@ -29,6 +102,5 @@ int main(int argc, char *argv[])
     w.show();
     w.SetFocus();
 
-#endif
     return a.exec();
 }
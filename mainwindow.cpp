@@ -3,6 +3,8 @@
 #include <QTimer>
 #include <QTime>
 #include <QDateTime>
+#include <QStringList>
+#include <QCoreApplication>
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 
@@ -22,13 +24,38 @@ MainWindow::MainWindow(QWidget *parent) :
     ui->labelappVersion->setText(appVersion);
     ui->labelsysVersion->setText(LinuxVersion);
     count = 0;
+    // the clock shows minutes, it wakes the GUI once a minute on the minute
     timer = new QTimer(this);
-
-    timer->setInterval(1000);
-
+    timer->setSingleShot(true);
+    timer->setTimerType(Qt::PreciseTimer);
     connect(timer, SIGNAL(timeout()), this, SLOT(updateTime()));
-    timer->start();
     updateTime();
+
+    heatmap = new HeatmapWidget(ui->centralWidget);
+    heatmap->setGeometry(232, 76, 80, 80);
+    live = new LiveView(heatmap, LS_NAME_DEFAULT, 50, this);
+    connect(live, SIGNAL(progress(QString)), this, SLOT(updateLive(QString)));
+    failList = NULL;
+
+    // test1 [-s] [plan.nxf]: the plan of the Start button, -s simulated
+    QStringList args = QCoreApplication::arguments();
+    planFile = "test.nxf";
+    for (int i = 1; i < args.size(); i++) {
+        if (args[i] != "-s") {
+            planFile = args[i];
+        }
+    }
+    engine = new TestEngine(heatmap, args.contains("-s"), this);
+    connect(engine, SIGNAL(progress(QString)), this, SLOT(updateLive(QString)));
+    connect(engine, SIGNAL(finished(int,int)), this, SLOT(scanFinished(int,int)));
+
+    // the ADC is only read on its own thread, the GUI gets the snapshots
+    adc = new AdcWorker(&tool);
+    adc->moveToThread(&adcThread);
+    connect(&adcThread, SIGNAL(started()), adc, SLOT(start()));
+    connect(&adcThread, SIGNAL(finished()), adc, SLOT(deleteLater()));
+    connect(adc, SIGNAL(sampled()), this, SLOT(updateADC()), Qt::QueuedConnection);
+    adcThread.start();
 }
 
 void MainWindow::SetFocus()
@@ -38,7 +65,13 @@ void MainWindow::SetFocus()
 
 MainWindow::~MainWindow()
 {
+    QMetaObject::invokeMethod(adc, "stop", Qt::BlockingQueuedConnection);
+    adcThread.quit();
+    adcThread.wait();
     qDebug("del ui...");
+    delete engine; // stops a scan before the window goes
+    engine = NULL;
+    delete failList;
     delete ui;
 }
 
@@ -64,24 +97,77 @@ void MainWindow::updateTime()
 {
      //;
     QDateTime dateTime = QDateTime::currentDateTime();
-    QString dateTimeString = dateTime.toString("yyyy-MM-dd HH:mm:ss");
+    QString dateTimeString = dateTime.toString("yyyy-MM-dd HH:mm");
 
     ui->labelStatus->setText(dateTimeString);
+    timer->start(60000 - dateTime.time().second() * 1000 - dateTime.time().msec());
+}
+
+void MainWindow::updateADC()
+{
+    AdcSnapshot snap;
+
+    if (!adc->latest(&snap)) {
+        return;
+    }
 
-   QString a0 = QString::number(tool.GetADC(0), 10);
-   QString a1 = QString::number(tool.GetADC(1), 10);
-   QString a2 = QString::number(tool.GetADC(2), 10);
+   QString a0 = QString::number(snap.value[0], 10);
+   QString a1 = QString::number(snap.value[1], 10);
+   QString a2 = QString::number(snap.value[2], 10);
 
-    ui->labelResult->setText(a0 + "/" + a2 + "/" + a2);
+    ui->labelResult->setText(a0 + "/" + a1 + "/" + a2);
+}
+
+void MainWindow::updateLive(const QString &text)
+{
+    ui->statusBar->showMessage(text);
 }
+
 void MainWindow::on_pushButton_destroyed()
 {
 
 }
 
+// Start, or stop the scan running
 void MainWindow::on_pushButton_2_clicked()
 {
+    if (engine->isRunning()) {
+        engine->cancel();
+        return;
+    }
     count++;
     qDebug() << count;
-    ui->labelResult->setText("Result: " + QString::number(count, 10));
+    if (engine->start(planFile)) {
+        ui->pushButton_2->setText("Stop");
+        ui->labelResult->setText("Scan " + QString::number(count, 10) + "...");
+    } else {
+        ui->labelResult->setText("Start " + planFile + " FAIL");
+    }
+}
+
+void MainWindow::scanFinished(int status, int fails)
+{
+    ui->pushButton_2->setText("Start");
+    if (XT_CANCELLED == status) {
+        ui->labelResult->setText("Result: stopped");
+    } else if (XT_OK != status) {
+        ui->labelResult->setText("Result: " + planFile + " FAIL");
+    } else {
+        ui->labelResult->setText(fails ? "Result: " + QString::number(fails) + " FAIL" : QString("Result: PASS"));
+    }
+    if (NULL != failList) {
+        failList->refresh();
+    }
+}
+
+void MainWindow::on_pushButton_3_clicked()
+{
+    if (NULL == failList) {
+        failList = new FailListWidget();
+        failList->setFixedSize(320, 240);
+        failList->move(QPoint(0, 0));
+    } else {
+        failList->refresh();
+    }
+    failList->show();
 }
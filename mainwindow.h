@@ -4,7 +4,13 @@
 #include <QMainWindow>
 #include <QMessageBox>
 #include <QPushButton>
+#include <QThread>
 #include "ctools.h"
+#include "adcworker.h"
+#include "heatmapwidget.h"
+#include "liveview.h"
+#include "faillistwidget.h"
+#include "testengine.h"
 
 namespace Ui {
 class MainWindow;
@@ -21,6 +27,13 @@ public:
     int count;
     QTimer *timer;
     CTools tool;
+    QThread adcThread;
+    AdcWorker *adc;
+    HeatmapWidget *heatmap; // A x B verdicts of the scan
+    LiveView *live;         // fed from the engine, xmltest -M
+    FailListWidget *failList;
+    TestEngine *engine;     // runs the scan in this process
+    QString planFile;
 
 private slots:
     void on_MainWindow_windowIconChanged(const QIcon &icon);
@@ -29,9 +42,14 @@ private slots:
 
     void on_pushButton_destroyed();
     void updateTime();
+    void updateADC();
+    void updateLive(const QString &text);
+    void scanFinished(int status, int fails);
 
     void on_pushButton_2_clicked();
 
+    void on_pushButton_3_clicked();
+
 private:
     Ui::MainWindow *ui;
 };
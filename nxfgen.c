@@ -0,0 +1,374 @@
+/*
+ * nxfgen.c: synthetic NXF generator for scale and stress tests of xmltest
+ *
+ * Writes a harness of point-to-point wires, splices, resistors, diodes and
+ * capacitors in the NXF format read by xmltest (Cont, Short, Fixture,
+ * Splices, Components, GroupInfo), and the verdicts a good harness gives,
+ * as the truth for the simulated ADC (xmltest -x -e file.expect file.nxf).
+ * The same options and seed always give the same files.
+ *
+ * gcc -o nxfgen /nxfgen.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define MAXPOINTS (1024)
+#define MAXCONNECTIONS (100000)
+
+#define SPLICE_BASE (65636)
+#define COMP_BASE (81920)
+
+// what the xmltest tables hold today, bigger files are for the parser only
+#define XMLTEST_POINTS (256)
+#define XMLTEST_CONNECTIONS (999)
+#define XMLTEST_SPLICES (99)
+#define XMLTEST_COMPOMENTS (99)
+
+#define NET_WIRE (0)
+#define NET_SPLICE (1)
+#define NET_R (2)
+#define NET_D (3)
+#define NET_C (4)
+#define NET_KINDS (5)
+
+struct stgenconn {
+	unsigned int pointA;
+	unsigned int pointB;
+};
+
+struct stgennet {
+	int kind;
+	unsigned int first; // first point
+	int points;
+	unsigned int id;    // splice or compoment id
+	float value;        // resistor
+	char row[48];       // Components row
+};
+
+int g_points = 50;
+int g_connections = 0;     // 0: as many as the nets need
+int g_depth = 3;           // wires on one splice
+int g_mix[NET_KINDS] = {4, 2, 1, 1, 1};
+unsigned int g_seed = 1;
+char g_fixture[32] = "X1-";
+char g_nxfname[256] = "";
+char g_expectname[256] = "";
+
+struct stgenconn *conns = NULL;
+int totalconn = 0;
+struct stgennet *nets = NULL;
+int totalnet = 0;
+int totalsplice = 0;
+int totalcomp = 0;
+unsigned int genseed = 1;
+
+// same generator on every libc, the files must not depend on the host
+static unsigned int GenRandom(unsigned int range) {
+	genseed = genseed * 1103515245 + 12345;
+	return ((genseed >> 16) & 0x7fff) % range;
+}
+
+static void AddConn(unsigned int pointA, unsigned int pointB) {
+	// both orders are valid NXF, the parser has a branch for each
+	if (GenRandom(2)) {
+		conns[totalconn].pointA = pointA;
+		conns[totalconn].pointB = pointB;
+	} else {
+		conns[totalconn].pointA = pointB;
+		conns[totalconn].pointB = pointA;
+	}
+	totalconn++;
+}
+
+static int PickKind() {
+	int sum = 0;
+	int pick;
+	int i;
+
+	for (i = 0; i < NET_KINDS; i++) {
+		sum += g_mix[i];
+	}
+	pick = GenRandom(sum);
+	for (i = 0; i < NET_KINDS; i++) {
+		if (pick < g_mix[i]) {
+			break;
+		}
+		pick -= g_mix[i];
+	}
+	return i;
+}
+
+// resistor row value: mantissa * 10^exp * unit, 10 ohm up to 47k, inside
+// the PASS bands of xmltest
+static float GenResist(char *row, size_t size, int comp) {
+	int mantissa = 10 + GenRandom(90);
+	int exp = GenRandom(3);
+	int tolerance = GenRandom(2) ? 5 : 10;
+	float value;
+	int i;
+
+	if (GenRandom(2)) {
+		mantissa = 1 + GenRandom(47);
+		snprintf(row, size, "%u,r,R%d,%d,0,%d,k", COMP_BASE + 2 * comp, comp + 1,
+			mantissa, tolerance);
+		return mantissa * 1000.0f;
+	}
+	snprintf(row, size, "%u,r,R%d,%d,%d,%d,o", COMP_BASE + 2 * comp, comp + 1,
+		mantissa, exp, tolerance);
+	value = mantissa;
+	for (i = 0; i < exp; i++) {
+		value *= 10;
+	}
+	return value;
+}
+
+static int BuildHarness() {
+	struct stgennet *net;
+	unsigned int point = 0;
+	int kind;
+	int need;
+	int i;
+
+	while (point < g_points) {
+		kind = PickKind();
+		need = (NET_SPLICE == kind) ? g_depth : 2;
+		if (point + need > g_points) {
+			break; // the rest stay unused, an open to everything
+		}
+
+		net = &nets[totalnet++];
+		net->kind = kind;
+		net->first = point;
+		net->points = need;
+		switch (kind) {
+		case NET_WIRE:
+			AddConn(point, point + 1);
+			break;
+		case NET_SPLICE:
+			net->id = SPLICE_BASE + totalsplice++;
+			for (i = 0; i < need; i++) {
+				AddConn(point + i, net->id);
+			}
+			break;
+		default: // compoment, input pin even, output pin odd
+			net->id = COMP_BASE + 2 * totalcomp;
+			if (NET_R == kind) {
+				net->value = GenResist(net->row, sizeof(net->row), totalcomp);
+			} else if (NET_D == kind) {
+				snprintf(net->row, sizeof(net->row), "%u,d,D%d,26,-1,90,0", net->id, totalcomp + 1);
+			} else {
+				snprintf(net->row, sizeof(net->row), "%u,c,C%d,10,-9,20,0", net->id, totalcomp + 1);
+			}
+			totalcomp++;
+			AddConn(point, net->id);
+			AddConn(net->id + 1, point + 1);
+			break;
+		}
+		point += need;
+	}
+
+	// fill up with redundant wires, they do not change any verdict
+	while (totalconn < g_connections) {
+		net = &nets[GenRandom(totalnet)];
+		for (i = 0; (i < totalnet) && (NET_WIRE != net->kind) && (NET_SPLICE != net->kind); i++) {
+			net = &nets[(net - nets + 1) % totalnet];
+		}
+		if ((NET_WIRE != net->kind) && (NET_SPLICE != net->kind)) {
+			fprintf(stderr, "no wire or splice to add %d connections\n", g_connections);
+			return -1;
+		}
+		if (NET_WIRE == net->kind) {
+			AddConn(net->first, net->first + 1);
+		} else {
+			AddConn(net->first + GenRandom(net->points), net->id);
+		}
+	}
+	return 0;
+}
+
+static int WriteNXF(FILE *fp) {
+	int i;
+
+	fprintf(fp, "<?xml version=\"1.0\"?>\n");
+	fprintf(fp, "<!-- nxfgen seed %u points %d connections %d -->\n", g_seed, g_points, totalconn);
+	fprintf(fp, "<NXF>\n");
+	fprintf(fp, "<Cont opts=\"eo\" val=\"10\"/>\n");
+	fprintf(fp, "<Short opts=\"ek\" val=\"100\"/>\n");
+
+	// rows end with CR LF, the CR as a reference so XML keeps it
+	fprintf(fp, "<Fixture name=\"%s\">&#13;\n", g_fixture);
+	for (i = 0; i < g_points; i++) {
+		fprintf(fp, "\t\t%d,P%d&#13;\n", i, i + 1);
+	}
+	fprintf(fp, "\t</Fixture>\n");
+
+	fprintf(fp, "<Splices>&#13;\n");
+	for (i = 0; i < totalsplice; i++) {
+		fprintf(fp, "\t\t%d,S%d&#13;\n", SPLICE_BASE + i, i + 1);
+	}
+	fprintf(fp, "\t</Splices>\n");
+
+	fprintf(fp, "<Components>&#13;\n");
+	for (i = 0; i < totalnet; i++) {
+		if (nets[i].row[0]) {
+			fprintf(fp, "\t\t%s&#13;\n", nets[i].row);
+		}
+	}
+	fprintf(fp, "\t</Components>\n");
+
+	fprintf(fp, "<GroupInfo>&#13;\n");
+	for (i = 0; i < totalconn; i++) {
+		fprintf(fp, "\t\t%u,%u,W%d,%d&#13;\n", conns[i].pointA, conns[i].pointB,
+			i + 1, i % 20);
+	}
+	fprintf(fp, "\t</GroupInfo>\n");
+	fprintf(fp, "</NXF>\n");
+	return ferror(fp) ? -1 : 0;
+}
+
+// the verdict of every connected pair, measured from A to B; pairs not
+// listed are disconnects
+static int WriteExpect(FILE *fp) {
+	struct stgennet *net;
+	int i, a, b;
+
+	fprintf(fp, "# nxfgen expect v1 seed %u points %d\n", g_seed, g_points);
+	fprintf(fp, "# pointA pointB verdict value\n");
+	for (i = 0; i < totalnet; i++) {
+		net = &nets[i];
+		switch (net->kind) {
+		case NET_WIRE:
+		case NET_SPLICE:
+			for (a = 0; a < net->points; a++) {
+				for (b = 0; b < net->points; b++) {
+					if (a != b) {
+						fprintf(fp, "%u %u directconnection 0\n", net->first + a, net->first + b);
+					}
+				}
+			}
+			break;
+		case NET_R:
+			fprintf(fp, "%u %u resist %g\n", net->first, net->first + 1, net->value);
+			fprintf(fp, "%u %u resist %g\n", net->first + 1, net->first, net->value);
+			break;
+		case NET_D: // input pin is the anode
+			fprintf(fp, "%u %u DIOD 0\n", net->first, net->first + 1);
+			fprintf(fp, "%u %u open 0\n", net->first + 1, net->first);
+			break;
+		default: // capacitor, open at DC
+			break;
+		}
+	}
+	return ferror(fp) ? -1 : 0;
+}
+
+static void usage() {
+	printf("nxfgen [options] out.nxf\n");
+	printf("  -p num   points (default 50, max %d)\n", MAXPOINTS);
+	printf("  -w num   connections, the nets are filled up with redundant wires\n");
+	printf("           (default as needed, max %d)\n", MAXCONNECTIONS);
+	printf("  -d num   wires on one splice (default 3)\n");
+	printf("  -m wire,splice,r,d,c  weights of the net kinds (default 4,2,1,1,1)\n");
+	printf("  -s seed  random seed (default 1)\n");
+	printf("  -n name  fixture name (default X1-)\n");
+	printf("  -e file  write the expected verdicts for the simulator\n");
+}
+
+int main(int argc, char **argv) {
+	FILE *fp;
+	int ret = 0;
+	int c;
+
+	while ((c = getopt(argc, argv, "hp:w:d:m:s:n:e:")) > 0) {
+		switch (c) {
+		case 'p':
+			g_points = atoi(optarg);
+			break;
+		case 'w':
+			g_connections = atoi(optarg);
+			break;
+		case 'd':
+			g_depth = atoi(optarg);
+			break;
+		case 'm':
+			if (NET_KINDS != sscanf(optarg, "%d,%d,%d,%d,%d", &g_mix[NET_WIRE],
+				&g_mix[NET_SPLICE], &g_mix[NET_R], &g_mix[NET_D], &g_mix[NET_C])) {
+				usage();
+				return -1;
+			}
+			break;
+		case 's':
+			g_seed = strtoul(optarg, NULL, 10);
+			break;
+		case 'n':
+			snprintf(g_fixture, sizeof(g_fixture), "%s", optarg);
+			break;
+		case 'e':
+			snprintf(g_expectname, sizeof(g_expectname), "%s", optarg);
+			break;
+		case 'h':
+		default:
+			usage();
+			return -1;
+		}
+	}
+
+	if (argc - optind != 1) {
+		usage();
+		return -1;
+	}
+	snprintf(g_nxfname, sizeof(g_nxfname), "%s", argv[optind]);
+
+	if ((g_points < 2) || (g_points > MAXPOINTS) || (g_connections > MAXCONNECTIONS)
+		|| (g_depth < 2) || (g_mix[NET_WIRE] + g_mix[NET_SPLICE] + g_mix[NET_R]
+		+ g_mix[NET_D] + g_mix[NET_C] <= 0)) {
+		usage();
+		return -1;
+	}
+
+	conns = calloc((g_connections > g_points ? g_connections : g_points) + 1, sizeof(*conns));
+	nets = calloc(g_points, sizeof(*nets));
+	if ((NULL == conns) || (NULL == nets)) {
+		printf("alloc fail!\n");
+		return -1;
+	}
+
+	genseed = g_seed;
+	if (BuildHarness() < 0) {
+		return -1;
+	}
+
+	fp = fopen(g_nxfname, "w");
+	if (NULL == fp) {
+		printf("Open %s fail! %s\n", g_nxfname, strerror(errno));
+		return -1;
+	}
+	ret |= WriteNXF(fp);
+	fclose(fp);
+
+	if (g_expectname[0]) {
+		fp = fopen(g_expectname, "w");
+		if (NULL == fp) {
+			printf("Open %s fail! %s\n", g_expectname, strerror(errno));
+			return -1;
+		}
+		ret |= WriteExpect(fp);
+		fclose(fp);
+	}
+
+	printf("%s: %d points, %d nets, %d connections, %d splices, %d compoments\n",
+		g_nxfname, g_points, totalnet, totalconn, totalsplice, totalcomp);
+	if ((g_points > XMLTEST_POINTS) || (totalconn > XMLTEST_CONNECTIONS)
+		|| (totalsplice > XMLTEST_SPLICES) || (totalcomp > XMLTEST_COMPOMENTS)) {
+		printf("warning: bigger than the xmltest tables (%d points, %d connections, "
+			"%d splices, %d compoments)\n", XMLTEST_POINTS, XMLTEST_CONNECTIONS,
+			XMLTEST_SPLICES, XMLTEST_COMPOMENTS);
+	}
+
+	free(conns);
+	free(nets);
+	return ret;
+}
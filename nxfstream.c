@@ -0,0 +1,164 @@
+/*
+ * nxfstream.c: streaming gzip / xz decompression of NXF files
+ *
+ * The reader asks for a few kB at a time; gzip is read through zlib's gz
+ * file with a fixed buffer, xz through liblzma with our own input buffer.
+ * Only the decoder state and the buffers are allocated, whatever the size
+ * of the document.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <zlib.h>
+#include <lzma.h>
+#include "nxfstream.h"
+
+#define NS_BUFFER (64 * 1024)
+#define NS_XZ_MEMLIMIT (64ULL * 1024 * 1024) // dictionary of xz -9 and below
+
+struct stnxfstream {
+	int format;
+	unsigned long long bytes; // decompressed bytes handed to the reader
+	gzFile gz;
+	FILE *fp;
+	lzma_stream xz;
+	int eof;
+	unsigned char *in;
+};
+
+// NS_GZIP or NS_XZ from the magic bytes, NS_PLAIN otherwise
+int NSFormat(const char *filename) {
+	static const unsigned char xzmagic[6] = {0xfd, '7', 'z', 'X', 'Z', 0x00};
+	unsigned char magic[6];
+	size_t len;
+	FILE *fp;
+
+	fp = fopen(filename, "rb");
+	if (NULL == fp) {
+		return NS_PLAIN; // the reader reports the open error
+	}
+	len = fread(magic, 1, sizeof(magic), fp);
+	fclose(fp);
+
+	if ((len >= 2) && (0x1f == magic[0]) && (0x8b == magic[1])) {
+		return NS_GZIP;
+	}
+	if ((len == sizeof(magic)) && (0 == memcmp(magic, xzmagic, sizeof(magic)))) {
+		return NS_XZ;
+	}
+	return NS_PLAIN;
+}
+
+struct stnxfstream *NSOpen(const char *filename, int format) {
+	struct stnxfstream *stream;
+	lzma_stream init = LZMA_STREAM_INIT;
+
+	stream = calloc(1, sizeof(*stream));
+	if (NULL == stream) {
+		printf("nxf stream alloc fail!\n");
+		return NULL;
+	}
+	stream->format = format;
+
+	if (NS_GZIP == format) {
+		stream->gz = gzopen(filename, "rb");
+		if (NULL == stream->gz) {
+			printf("Open %s fail! %s\n", filename, strerror(errno));
+			free(stream);
+			return NULL;
+		}
+		gzbuffer(stream->gz, NS_BUFFER);
+		return stream;
+	}
+
+	if (NS_XZ == format) {
+		stream->xz = init;
+		stream->in = malloc(NS_BUFFER);
+		stream->fp = fopen(filename, "rb");
+		if ((NULL == stream->in) || (NULL == stream->fp)) {
+			printf("Open %s fail! %s\n", filename, strerror(errno));
+			NSClose(stream);
+			return NULL;
+		}
+		if (LZMA_OK != lzma_stream_decoder(&stream->xz, NS_XZ_MEMLIMIT, LZMA_CONCATENATED)) {
+			printf("xz decoder init fail!\n");
+			NSClose(stream);
+			return NULL;
+		}
+		return stream;
+	}
+
+	printf("%s: not a compressed NXF\n", filename);
+	free(stream);
+	return NULL;
+}
+
+static int NSReadXz(struct stnxfstream *stream, char *buffer, int len) {
+	lzma_ret ret;
+
+	stream->xz.next_out = (unsigned char *)buffer;
+	stream->xz.avail_out = len;
+	while (stream->xz.avail_out > 0) {
+		if ((0 == stream->xz.avail_in) && !stream->eof) {
+			stream->xz.next_in = stream->in;
+			stream->xz.avail_in = fread(stream->in, 1, NS_BUFFER, stream->fp);
+			if (ferror(stream->fp)) {
+				printf("xz read fail! %s\n", strerror(errno));
+				return -1;
+			}
+			stream->eof = feof(stream->fp);
+		}
+		ret = lzma_code(&stream->xz, stream->eof ? LZMA_FINISH : LZMA_RUN);
+		if (LZMA_STREAM_END == ret) {
+			break;
+		}
+		if (LZMA_OK != ret) {
+			printf("xz decode fail! %d\n", ret);
+			return -1;
+		}
+	}
+	return len - stream->xz.avail_out;
+}
+
+// xmlInputReadCallback: up to len decompressed bytes, 0 at the end, -1 on error
+int NSRead(void *context, char *buffer, int len) {
+	struct stnxfstream *stream = context;
+	int count;
+	int errnum;
+
+	if (NS_GZIP == stream->format) {
+		count = gzread(stream->gz, buffer, len);
+		if (count < 0) {
+			printf("gzip decode fail! %s\n", gzerror(stream->gz, &errnum));
+		}
+	} else {
+		count = NSReadXz(stream, buffer, len);
+	}
+	if (count > 0) {
+		stream->bytes += count;
+	}
+	return count;
+}
+
+// xmlInputCloseCallback, frees the stream
+int NSClose(void *context) {
+	struct stnxfstream *stream = context;
+
+	if (stream->gz) {
+		gzclose(stream->gz);
+	}
+	if (stream->fp) {
+		fclose(stream->fp);
+	}
+	if (NS_XZ == stream->format) {
+		lzma_end(&stream->xz);
+	}
+	free(stream->in);
+	free(stream);
+	return 0;
+}
+
+unsigned long long NSBytes(const struct stnxfstream *stream) {
+	return stream->bytes;
+}
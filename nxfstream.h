@@ -0,0 +1,24 @@
+#ifndef NXFSTREAM_H
+#define NXFSTREAM_H
+
+/*
+ * Compressed NXF input: .nxf.gz and .nxf.xz plans are decompressed while
+ * the XML reader pulls them, through a fixed input buffer, so the whole
+ * document is never in memory. The format is told by the magic bytes,
+ * not the file name. NSRead() and NSClose() are the xmlInputReadCallback
+ * and xmlInputCloseCallback of xmlReaderForIO().
+ */
+
+#define NS_PLAIN (0)
+#define NS_GZIP (1)
+#define NS_XZ (2)
+
+struct stnxfstream;
+
+int NSFormat(const char *filename);
+struct stnxfstream *NSOpen(const char *filename, int format);
+int NSRead(void *context, char *buffer, int len);
+int NSClose(void *context);
+unsigned long long NSBytes(const struct stnxfstream *stream);
+
+#endif // NXFSTREAM_H
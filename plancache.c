@@ -0,0 +1,183 @@
+/*
+ * plancache.c: LRU of compiled plans under a count and memory budget
+ *
+ * A handful of harness types per shift, so the entries are a plain doubly
+ * linked list, most recently used first, searched by name.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "plancache.h"
+
+struct stpcentry {
+	char filename[PC_NAME_SIZE];
+	off_t size;
+	time_t mtime;
+	void *plan;
+	unsigned long long bytes;
+	unsigned long uses;
+	struct stpcentry *prev;
+	struct stpcentry *next;
+};
+
+struct stplancache {
+	int maxplans;
+	unsigned long long budget;
+	pcfree freeplan;
+	struct stpcentry *head; // most recently used
+	struct stpcentry *tail;
+	struct stpcstats stats;
+};
+
+struct stplancache *PCOpen(int maxplans, unsigned long long budget, pcfree freeplan) {
+	struct stplancache *cache;
+
+	cache = calloc(1, sizeof(*cache));
+	if (NULL == cache) {
+		printf("plan cache alloc fail!\n");
+		return NULL;
+	}
+	cache->maxplans = (maxplans < 1) ? 1 : maxplans;
+	cache->budget = budget;
+	cache->freeplan = freeplan;
+	return cache;
+}
+
+static void PCUnlink(struct stplancache *cache, struct stpcentry *entry) {
+	if (entry->prev) {
+		entry->prev->next = entry->next;
+	} else {
+		cache->head = entry->next;
+	}
+	if (entry->next) {
+		entry->next->prev = entry->prev;
+	} else {
+		cache->tail = entry->prev;
+	}
+	entry->prev = entry->next = NULL;
+}
+
+static void PCPushFront(struct stplancache *cache, struct stpcentry *entry) {
+	entry->prev = NULL;
+	entry->next = cache->head;
+	if (cache->head) {
+		cache->head->prev = entry;
+	} else {
+		cache->tail = entry;
+	}
+	cache->head = entry;
+}
+
+static void PCDrop(struct stplancache *cache, struct stpcentry *entry) {
+	PCUnlink(cache, entry);
+	cache->stats.plans--;
+	cache->stats.bytes -= entry->bytes;
+	if (cache->freeplan) {
+		cache->freeplan(entry->plan);
+	}
+	free(entry);
+}
+
+static struct stpcentry *PCFind(struct stplancache *cache, const char *filename) {
+	struct stpcentry *entry;
+
+	for (entry = cache->head; entry; entry = entry->next) {
+		if (0 == strcmp(entry->filename, filename)) {
+			break;
+		}
+	}
+	return entry;
+}
+
+void PCClose(struct stplancache *cache) {
+	if (NULL == cache) {
+		return;
+	}
+	while (cache->head) {
+		PCDrop(cache, cache->head);
+	}
+	free(cache);
+}
+
+// The cached plan of this file, NULL when not cached. When the file
+// changed since, stale is set and the old plan is returned to build the
+// new one from; it stays cached until PCPut() replaces it.
+void *PCGet(struct stplancache *cache, const char *filename, int *stale) {
+	struct stpcentry *entry;
+	struct stat st;
+
+	*stale = 0;
+	entry = PCFind(cache, filename);
+	if (NULL == entry) {
+		cache->stats.misses++;
+		return NULL;
+	}
+	if ((stat(filename, &st) < 0) || (st.st_size != entry->size) || (st.st_mtime != entry->mtime)) {
+		cache->stats.stale++;
+		cache->stats.misses++;
+		*stale = 1;
+		return entry->plan;
+	}
+
+	cache->stats.hits++;
+	entry->uses++;
+	if (entry != cache->head) {
+		PCUnlink(cache, entry);
+		PCPushFront(cache, entry);
+	}
+	return entry->plan;
+}
+
+// add the plan as the most recent one, in place of the stale plan of the
+// same file, and evict the oldest over the budget
+int PCPut(struct stplancache *cache, const char *filename, void *plan, unsigned long long bytes) {
+	struct stpcentry *entry;
+	struct stat st;
+
+	entry = PCFind(cache, filename);
+	if (NULL != entry) {
+		PCDrop(cache, entry);
+	}
+
+	entry = calloc(1, sizeof(*entry));
+	if (NULL == entry) {
+		printf("plan cache alloc fail!\n");
+		return -1;
+	}
+	snprintf(entry->filename, sizeof(entry->filename), "%s", filename);
+	if (0 == stat(filename, &st)) {
+		entry->size = st.st_size;
+		entry->mtime = st.st_mtime;
+	}
+	entry->plan = plan;
+	entry->bytes = bytes;
+	entry->uses = 1;
+	PCPushFront(cache, entry);
+	cache->stats.plans++;
+	cache->stats.bytes += bytes;
+
+	while ((cache->tail != cache->head) && ((cache->stats.plans > cache->maxplans)
+		|| (cache->budget && (cache->stats.bytes > cache->budget)))) {
+		cache->stats.evictions++;
+		PCDrop(cache, cache->tail);
+	}
+	return 0;
+}
+
+void PCGetStats(const struct stplancache *cache, struct stpcstats *stats) {
+	*stats = cache->stats;
+}
+
+void PCPrint(const struct stplancache *cache, FILE *fp) {
+	const struct stpcentry *entry;
+
+	fprintf(fp, "plan cache: %d/%d plans, %.1f/%.1f MB, %lu hits, %lu misses, %lu stale, %lu evictions\n",
+		cache->stats.plans, cache->maxplans, cache->stats.bytes / 1048576.0,
+		cache->budget / 1048576.0, cache->stats.hits, cache->stats.misses,
+		cache->stats.stale, cache->stats.evictions);
+	for (entry = cache->head; entry; entry = entry->next) {
+		fprintf(fp, "  %s %.1f MB, %lu uses\n", entry->filename, entry->bytes / 1048576.0,
+			entry->uses);
+	}
+}
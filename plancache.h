@@ -0,0 +1,38 @@
+#ifndef PLANCACHE_H
+#define PLANCACHE_H
+
+/*
+ * Plan cache of the station mode: the most recently used compiled plans
+ * stay resident, keyed by the file name and checked against the size and
+ * modification time of the file; the stale plan of a changed file is
+ * handed back so the new one can be built from it. The least recently used
+ * plan is evicted when there are more than maxplans or more than budget
+ * bytes; the plan in use (the most recent one) is never evicted. The cache does not know what
+ * a plan is, it frees them through the callback.
+ */
+
+#include <stdio.h>
+
+#define PC_NAME_SIZE (256)
+
+typedef void (*pcfree)(void *plan);
+
+struct stpcstats {
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long stale;     // file changed since it was compiled
+	unsigned long evictions;
+	unsigned long long bytes;
+	int plans;
+};
+
+struct stplancache;
+
+struct stplancache *PCOpen(int maxplans, unsigned long long budget, pcfree freeplan);
+void PCClose(struct stplancache *cache);
+void *PCGet(struct stplancache *cache, const char *filename, int *stale);
+int PCPut(struct stplancache *cache, const char *filename, void *plan, unsigned long long bytes);
+void PCGetStats(const struct stplancache *cache, struct stpcstats *stats);
+void PCPrint(const struct stplancache *cache, FILE *fp);
+
+#endif // PLANCACHE_H
@@ -0,0 +1,300 @@
+/*
+ * resultsink.c: buffered CSV / JSON Lines / binary result writer
+ *
+ * Two record buffers: the scan fills one while the sink thread formats and
+ * writes the other. RSWrite() blocks only when the sink thread is still
+ * busy with the other buffer.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "testplan.h"
+#include "resultsink.h"
+
+#define RS_BUFFER_RECORDS (32 * 1024)
+#define RS_FILE_BUFFER (1024 * 1024)
+#define RS_NAME_SIZE (32)
+
+struct stresultsink {
+	FILE *fp;
+	int format;
+	int points;
+	char (*names)[RS_NAME_SIZE];
+	struct stresult *buffer[2];
+	int count[2];
+	int active;   // buffer filled by RSWrite()
+	int pending;  // the other buffer waits for the sink thread
+	int closing;
+	int header;
+	int error;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+};
+
+// format from the file name: .csv, .jsonl/.json, anything else binary
+int RSFormat(const char *filename) {
+	const char *ext = strrchr(filename, '.');
+
+	if (NULL == ext) {
+		return RS_BINARY;
+	}
+	if (0 == strcmp(ext, ".csv")) {
+		return RS_CSV;
+	}
+	if ((0 == strcmp(ext, ".jsonl")) || (0 == strcmp(ext, ".json"))) {
+		return RS_JSON;
+	}
+	return RS_BINARY;
+}
+
+static const char *RSPointName(struct stresultsink *sink, int point) {
+	if ((point < 0) || (point >= sink->points)) {
+		return "";
+	}
+	return sink->names[point];
+}
+
+static void RSCsvString(FILE *fp, const char *str) {
+	if (NULL == strpbrk(str, ",\"\n")) {
+		fputs(str, fp);
+		return;
+	}
+	fputc('"', fp);
+	for (; *str; str++) {
+		if ('"' == *str) {
+			fputc('"', fp);
+		}
+		fputc(*str, fp);
+	}
+	fputc('"', fp);
+}
+
+// a quoted JSON string, also for the perf output of xmltest
+void RSJsonString(FILE *fp, const char *str) {
+	fputc('"', fp);
+	for (; *str; str++) {
+		if (('"' == *str) || ('\\' == *str)) {
+			fputc('\\', fp);
+			fputc(*str, fp);
+		} else if ((unsigned char)*str < 0x20) {
+			fprintf(fp, "\\u%04x", (unsigned char)*str);
+		} else {
+			fputc(*str, fp);
+		}
+	}
+	fputc('"', fp);
+}
+
+static void RSHeader(struct stresultsink *sink) {
+	unsigned int value;
+	unsigned short point;
+	unsigned char len;
+	int names = 0;
+	int i;
+
+	sink->header = 1;
+	switch (sink->format) {
+	case RS_CSV:
+		fprintf(sink->fp, "pointA,pointB,nameA,nameB,class,expect,adc0,adc2,resist,verdict\n");
+		break;
+	case RS_BINARY:
+		for (i = 0; i < sink->points; i++) {
+			names += (0 != sink->names[i][0]);
+		}
+		fwrite(RS_MAGIC, 4, 1, sink->fp);
+		value = RS_VERSION;
+		fwrite(&value, sizeof(value), 1, sink->fp);
+		value = sizeof(struct stresult);
+		fwrite(&value, sizeof(value), 1, sink->fp);
+		value = names;
+		fwrite(&value, sizeof(value), 1, sink->fp);
+		for (i = 0; i < sink->points; i++) {
+			if (0 == sink->names[i][0]) {
+				continue;
+			}
+			point = i;
+			len = strlen(sink->names[i]);
+			fwrite(&point, sizeof(point), 1, sink->fp);
+			fwrite(&len, sizeof(len), 1, sink->fp);
+			fwrite(sink->names[i], len, 1, sink->fp);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+// runs on the sink thread
+static void RSFlush(struct stresultsink *sink, const struct stresult *records, int count) {
+	const struct stresult *r;
+	int i;
+
+	if (!sink->header) {
+		RSHeader(sink);
+	}
+
+	switch (sink->format) {
+	case RS_CSV:
+		for (i = 0; i < count; i++) {
+			r = &records[i];
+			fprintf(sink->fp, "%u,%u,", r->pointA, r->pointB);
+			RSCsvString(sink->fp, RSPointName(sink, r->pointA));
+			fputc(',', sink->fp);
+			RSCsvString(sink->fp, RSPointName(sink, r->pointB));
+			fprintf(sink->fp, ",%s,%g,%.2f,%.2f,%.3f,%s\n", TPVerdictName(r->verdict),
+				r->expect, r->adc0, r->adc2, r->resist, r->pass ? "PASS" : "FAIL");
+		}
+		break;
+	case RS_JSON:
+		for (i = 0; i < count; i++) {
+			r = &records[i];
+			fprintf(sink->fp, "{\"pointA\":%u,\"pointB\":%u,\"nameA\":", r->pointA, r->pointB);
+			RSJsonString(sink->fp, RSPointName(sink, r->pointA));
+			fprintf(sink->fp, ",\"nameB\":");
+			RSJsonString(sink->fp, RSPointName(sink, r->pointB));
+			fprintf(sink->fp, ",\"class\":\"%s\",\"expect\":%g,\"adc0\":%.2f,\"adc2\":%.2f,"
+				"\"resist\":%.3f,\"verdict\":\"%s\"}\n", TPVerdictName(r->verdict),
+				r->expect, r->adc0, r->adc2, r->resist, r->pass ? "PASS" : "FAIL");
+		}
+		break;
+	default:
+		fwrite(records, sizeof(struct stresult), count, sink->fp);
+		break;
+	}
+	if (ferror(sink->fp)) {
+		sink->error = -1;
+	}
+}
+
+static void *RSThread(void *arg) {
+	struct stresultsink *sink = arg;
+	int buf;
+
+	pthread_mutex_lock(&sink->lock);
+	while (1) {
+		if (sink->pending) {
+			buf = 1 - sink->active;
+			pthread_mutex_unlock(&sink->lock);
+			RSFlush(sink, sink->buffer[buf], sink->count[buf]);
+			pthread_mutex_lock(&sink->lock);
+			sink->count[buf] = 0;
+			sink->pending = 0;
+			pthread_cond_broadcast(&sink->cond);
+			continue;
+		}
+		if (sink->closing) {
+			break;
+		}
+		pthread_cond_wait(&sink->cond, &sink->lock);
+	}
+	pthread_mutex_unlock(&sink->lock);
+
+	if (!sink->header) {
+		RSHeader(sink);
+	}
+	return NULL;
+}
+
+struct stresultsink *RSOpen(const char *filename, int format, int points) {
+	struct stresultsink *sink;
+
+	sink = calloc(1, sizeof(*sink));
+	if (NULL == sink) {
+		printf("result sink alloc fail!\n");
+		return NULL;
+	}
+	sink->format = format;
+	sink->points = points;
+	sink->names = calloc(points, RS_NAME_SIZE);
+	sink->buffer[0] = malloc(RS_BUFFER_RECORDS * sizeof(struct stresult));
+	sink->buffer[1] = malloc(RS_BUFFER_RECORDS * sizeof(struct stresult));
+	if ((NULL == sink->names) || (NULL == sink->buffer[0]) || (NULL == sink->buffer[1])) {
+		printf("result sink alloc fail!\n");
+		goto fail;
+	}
+
+	sink->fp = fopen(filename, (RS_BINARY == format) ? "wb" : "w");
+	if (NULL == sink->fp) {
+		printf("Open result %s fail! %s\n", filename, strerror(errno));
+		goto fail;
+	}
+	setvbuf(sink->fp, NULL, _IOFBF, RS_FILE_BUFFER);
+
+	pthread_mutex_init(&sink->lock, NULL);
+	pthread_cond_init(&sink->cond, NULL);
+	if (pthread_create(&sink->thread, NULL, RSThread, sink)) {
+		printf("result sink thread fail!\n");
+		fclose(sink->fp);
+		goto fail;
+	}
+	return sink;
+
+fail:
+	free(sink->buffer[0]);
+	free(sink->buffer[1]);
+	free(sink->names);
+	free(sink);
+	return NULL;
+}
+
+// names go into the file header, set them before the first RSWrite()
+void RSName(struct stresultsink *sink, int point, const char *name) {
+	if ((point < 0) || (point >= sink->points)) {
+		return;
+	}
+	snprintf(sink->names[point], RS_NAME_SIZE, "%s", name);
+}
+
+void RSWrite(struct stresultsink *sink, const struct stresult *result) {
+	int buf = sink->active;
+
+	sink->buffer[buf][sink->count[buf]++] = *result;
+	if (sink->count[buf] < RS_BUFFER_RECORDS) {
+		return;
+	}
+
+	pthread_mutex_lock(&sink->lock);
+	while (sink->pending) {
+		pthread_cond_wait(&sink->cond, &sink->lock);
+	}
+	sink->active = 1 - buf;
+	sink->pending = 1;
+	pthread_cond_broadcast(&sink->cond);
+	pthread_mutex_unlock(&sink->lock);
+}
+
+int RSClose(struct stresultsink *sink) {
+	int ret;
+
+	if (NULL == sink) {
+		return 0;
+	}
+
+	pthread_mutex_lock(&sink->lock);
+	while (sink->pending) {
+		pthread_cond_wait(&sink->cond, &sink->lock);
+	}
+	if (sink->count[sink->active] > 0) {
+		sink->active = 1 - sink->active;
+		sink->pending = 1;
+	}
+	sink->closing = 1;
+	pthread_cond_broadcast(&sink->cond);
+	pthread_mutex_unlock(&sink->lock);
+	pthread_join(sink->thread, NULL);
+
+	if (fclose(sink->fp)) {
+		sink->error = -1;
+	}
+	ret = sink->error;
+	pthread_mutex_destroy(&sink->lock);
+	pthread_cond_destroy(&sink->cond);
+	free(sink->buffer[0]);
+	free(sink->buffer[1]);
+	free(sink->names);
+	free(sink);
+	return ret;
+}
@@ -0,0 +1,52 @@
+#ifndef RESULTSINK_H
+#define RESULTSINK_H
+
+/*
+ * Result sink: one record per checked pair, written as CSV, JSON Lines or
+ * a compact binary file. RSWrite() only copies the record into a large
+ * buffer; formatting and file writes run on the sink thread, so the scan
+ * never waits for the disk unless both buffers are full.
+ */
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RS_CSV (0)
+#define RS_JSON (1)
+#define RS_BINARY (2)
+
+#define RS_MAGIC "XTRS"
+#define RS_VERSION (1)
+
+// binary file: "XTRS", u32 version, u32 record size, u32 names, then per
+// name u16 point, u8 length and the name bytes, then the records, host
+// byte order
+struct stresult {
+	unsigned short pointA;
+	unsigned short pointB;
+	unsigned char verdict; // expected class, TP_VERDICT_*
+	unsigned char pass;
+	unsigned short reserved;
+	float expect;          // adcarray value
+	float adc0;
+	float adc2;
+	float resist;
+};
+
+struct stresultsink;
+
+int RSFormat(const char *filename);
+struct stresultsink *RSOpen(const char *filename, int format, int points);
+void RSName(struct stresultsink *sink, int point, const char *name);
+void RSWrite(struct stresultsink *sink, const struct stresult *result);
+int RSClose(struct stresultsink *sink);
+void RSJsonString(FILE *fp, const char *str);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RESULTSINK_H
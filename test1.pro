@@ -4,7 +4,8 @@
 #
 #-------------------------------------------------
 
-QT       += core gui webkitwidgets webkit widgets
+# WebKit only in the webview plugin: qmake webview/webview.pro
+QT       += core gui widgets
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -14,10 +15,43 @@ TEMPLATE = app
 
 SOURCES += main.cpp\
         mainwindow.cpp \
-    ctools.cpp
+    ctools.cpp \
+    adcworker.cpp \
+    heatmapwidget.cpp \
+    liveview.cpp \
+    liveshm.c \
+    fbstatus.c \
+    failmodel.cpp \
+    faillistwidget.cpp \
+    history.c \
+    testplan.c \
+    testengine.cpp \
+    xmltest.c \
+    hwsim.c \
+    histo.c \
+    resultsink.c \
+    plancache.c \
+    nxfstream.c
 
 HEADERS  += mainwindow.h \
     ctools.h \
+    adcworker.h \
+    heatmapwidget.h \
+    liveview.h \
+    liveshm.h \
+    fbstatus.h \
+    failmodel.h \
+    faillistwidget.h \
+    history.h \
+    testplan.h \
+    testengine.h \
+    xtengine.h \
+    webviewinterface.h \
     imx_adc.h	
 
 FORMS    += mainwindow.ui
+
+# the engine, xmltest.c without its main()
+DEFINES += XT_LIBRARY
+INCLUDEPATH += /usr/include/libxml2
+LIBS += -lxml2 -lz -llzma -lpthread -lrt
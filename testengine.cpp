@@ -0,0 +1,115 @@
+#include <QDebug>
+#include "testengine.h"
+#include "failmodel.h"
+#include "testplan.h"
+
+TestEngine::TestEngine(HeatmapWidget *heatmap, bool simulate, QObject *parent) :
+    QObject(parent), engine(NULL), heatmap(heatmap), simulate(simulate), running(false), fails(0)
+{
+}
+
+TestEngine::~TestEngine()
+{
+    XTDestroy(engine); // cancels and joins a run
+}
+
+bool TestEngine::start(const QString &filename)
+{
+    struct stxtoptions options;
+    struct stxtcallbacks callbacks;
+
+    if (running) {
+        return false;
+    }
+    if (NULL == engine) {
+        memset(&options, 0, sizeof(options));
+        options.simulate = simulate;
+        options.quiet = 1;
+        options.historydir = FAIL_HISTORY_DEFAULT; // for the fail list
+        callbacks.loaded = onLoaded;
+        callbacks.result = onResult;
+        callbacks.progress = onProgress;
+        callbacks.done = onDone;
+        callbacks.arg = this;
+        engine = XTCreate(&options, &callbacks);
+        if (NULL == engine) {
+            return false;
+        }
+    }
+
+    this->filename = filename;
+    fails = 0;
+    heatmap->clear();
+    if (XTStart(engine, filename.toLocal8Bit().constData()) < 0) {
+        return false;
+    }
+    running = true;
+    return true;
+}
+
+void TestEngine::cancel()
+{
+    if (running) {
+        XTCancel(engine);
+    }
+}
+
+bool TestEngine::isRunning() const
+{
+    return running;
+}
+
+// engine thread, the heatmap takes the size of the plan on the GUI thread
+void TestEngine::onLoaded(void *arg, int points, unsigned int pairs)
+{
+    Q_UNUSED(pairs);
+    QMetaObject::invokeMethod(static_cast<TestEngine *>(arg), "engineLoaded",
+                              Qt::QueuedConnection, Q_ARG(int, points));
+}
+
+void TestEngine::engineLoaded(int points)
+{
+    heatmap->setPoints(points);
+}
+
+// engine thread
+void TestEngine::onResult(void *arg, const struct stresult *result)
+{
+    TestEngine *self = static_cast<TestEngine *>(arg);
+    int state;
+
+    if (!result->pass) {
+        state = HEATMAP_FAIL;
+    } else if ((TP_VERDICT_OPEN == result->verdict) || (TP_VERDICT_DISCONNECT == result->verdict)
+               || (TP_VERDICT_NONE == result->verdict)) {
+        state = HEATMAP_OPEN;
+    } else {
+        state = HEATMAP_CONNECTED;
+    }
+    self->heatmap->setCell(result->pointA, result->pointB, state);
+}
+
+// engine thread, the signal is queued to the receivers in the GUI
+void TestEngine::onProgress(void *arg, unsigned int tested, unsigned int pairs, unsigned int fails)
+{
+    TestEngine *self = static_cast<TestEngine *>(arg);
+
+    self->fails = fails;
+    emit self->progress(QString("%1: %2/%3 pairs, %4 FAIL")
+                        .arg(self->filename).arg(tested).arg(pairs).arg(fails));
+}
+
+// engine thread, the run is joined on the GUI thread
+void TestEngine::onDone(void *arg, int status)
+{
+    QMetaObject::invokeMethod(static_cast<TestEngine *>(arg), "engineDone",
+                              Qt::QueuedConnection, Q_ARG(int, status));
+}
+
+void TestEngine::engineDone(int status)
+{
+    XTWait(engine);
+    running = false;
+    qDebug() << "scan" << filename << "status" << status << "FAIL" << fails;
+    emit finished(status, fails);
+}
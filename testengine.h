@@ -0,0 +1,45 @@
+#ifndef TESTENGINE_H
+#define TESTENGINE_H
+
+#include <QObject>
+#include <QString>
+#include "xtengine.h"
+#include "heatmapwidget.h"
+
+// The xmltest engine in the GUI process. The scan runs on the thread of
+// the engine and sets the heatmap cells from there; progress is a signal,
+// queued to the GUI, and finished comes once the run has been joined.
+// The hardware is opened with the first run, not with the window.
+class TestEngine : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TestEngine(HeatmapWidget *heatmap, bool simulate = false, QObject *parent = 0);
+    ~TestEngine();
+    bool start(const QString &filename);
+    void cancel();
+    bool isRunning() const;
+
+signals:
+    void progress(const QString &text);
+    void finished(int status, int fails);
+
+private slots:
+    void engineLoaded(int points);
+    void engineDone(int status);
+
+private:
+    static void onLoaded(void *arg, int points, unsigned int pairs);
+    static void onResult(void *arg, const struct stresult *result);
+    static void onProgress(void *arg, unsigned int tested, unsigned int pairs, unsigned int fails);
+    static void onDone(void *arg, int status);
+
+    struct stxtengine *engine;
+    HeatmapWidget *heatmap;
+    bool simulate;
+    bool running;
+    QString filename;
+    unsigned int fails;
+};
+
+#endif // TESTENGINE_H
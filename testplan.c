@@ -0,0 +1,389 @@
+/*
+ * testplan.c: compiled test plan storage, text format and executor
+ *
+ * Text format, one instruction per line so two plans can be diffed:
+ *   # comment
+ *   slots <n>
+ *   <M|S> muxA muxB accept samples settle slot expect lower upper verdict
+ *   W slot n mean m2   (learned pair statistics)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "testplan.h"
+
+#define TP_VERSION "xmltest test plan v1"
+
+struct stslot {
+	float adc0;
+	float adc2;
+	unsigned char level;
+};
+
+static const char *verdictnames[TP_VERDICT_MAX] = {
+	"open",
+	"DIOD",
+	"directconnection",
+	"disconnect",
+	"resist",
+	"-",
+};
+
+const char *TPVerdictName(int verdict) {
+	if ((verdict < 0) || (verdict >= TP_VERDICT_MAX)) {
+		return "?";
+	}
+	return verdictnames[verdict];
+}
+
+void TPInit(struct stprogram *prog) {
+	memset(prog, 0, sizeof(*prog));
+}
+
+void TPFree(struct stprogram *prog) {
+	free(prog->code);
+	free(prog->stats);
+	TPInit(prog);
+}
+
+// learn the pair statistics from now on, keeps the loaded ones
+int TPEnableStats(struct stprogram *prog) {
+	if (NULL == prog->stats) {
+		prog->stats = calloc(prog->nslots ? prog->nslots : 1, sizeof(struct stpairstat));
+		if (NULL == prog->stats) {
+			printf("plan stats alloc fail!\n");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static void TPStatAdd(struct stpairstat *stat, float value) {
+	double delta = value - stat->mean;
+
+	stat->n++;
+	stat->mean += delta / stat->n;
+	stat->m2 += delta * (value - stat->mean);
+}
+
+int TPEmit(struct stprogram *prog, const struct stinstr *in) {
+	struct stinstr *code;
+	int size;
+
+	if (prog->count == prog->size) {
+		size = prog->size ? prog->size * 2 : 1024;
+		code = realloc(prog->code, size * sizeof(struct stinstr));
+		if (NULL == code) {
+			printf("plan alloc fail!\n");
+			return -1;
+		}
+		prog->code = code;
+		prog->size = size;
+	}
+	prog->code[prog->count++] = *in;
+	if (in->slot >= prog->nslots) {
+		prog->nslots = in->slot + 1;
+	}
+	return 0;
+}
+
+int TPSave(const struct stprogram *prog, const char *filename) {
+	const struct stinstr *in;
+	FILE *fp;
+	int pc;
+
+	fp = fopen(filename, "w");
+	if (NULL == fp) {
+		printf("Open plan %s fail! %s\n", filename, strerror(errno));
+		return -1;
+	}
+
+	fprintf(fp, "# %s\n", TP_VERSION);
+	fprintf(fp, "# op muxA muxB accept samples settle slot expect lower upper verdict\n");
+	fprintf(fp, "slots %d\n", prog->nslots);
+	for (pc = 0; pc < prog->count; pc++) {
+		in = &prog->code[pc];
+		fprintf(fp, "%c %u %u %u %u %u %u %.9g %.9g %.9g %s\n",
+			(TP_SCREEN == in->op) ? 'S' : 'M', in->muxA, in->muxB,
+			in->accept, in->samples, in->settle_us, in->slot,
+			in->expect, in->lower, in->upper, TPVerdictName(in->verdict));
+	}
+	for (pc = 0; (NULL != prog->stats) && (pc < prog->nslots); pc++) {
+		if (prog->stats[pc].n) {
+			fprintf(fp, "W %d %u %.9g %.9g\n", pc, prog->stats[pc].n,
+				prog->stats[pc].mean, prog->stats[pc].m2);
+		}
+	}
+	fclose(fp);
+	return 0;
+}
+
+int TPLoad(struct stprogram *prog, const char *filename) {
+	struct stinstr in;
+	unsigned int muxA, muxB, accept, samples, settle;
+	char line[256];
+	char verdict[32];
+	char op;
+	FILE *fp;
+	struct stpairstat *stats = NULL;
+	struct stpairstat stat;
+	int statslots = 0;
+	int slot;
+	int slots = 0;
+	int lineno = 0;
+	int i;
+
+	fp = fopen(filename, "r");
+	if (NULL == fp) {
+		printf("Open plan %s fail! %s\n", filename, strerror(errno));
+		return -1;
+	}
+
+	TPInit(prog);
+	while (fgets(line, sizeof(line), fp)) {
+		lineno++;
+		if (('#' == line[0]) || ('\n' == line[0])) {
+			continue;
+		}
+		if (1 == sscanf(line, "slots %d", &slots)) {
+			continue;
+		}
+		if (4 == sscanf(line, "W %d %u %lf %lf", &slot, &stat.n, &stat.mean, &stat.m2)) {
+			if ((slot < 0) || (slot >= slots)) {
+				continue;
+			}
+			if (NULL == stats) {
+				stats = calloc(slots, sizeof(struct stpairstat));
+				statslots = slots;
+				if (NULL == stats) {
+					printf("plan stats alloc fail!\n");
+					fclose(fp);
+					TPFree(prog);
+					return -1;
+				}
+			}
+			if (slot < statslots) {
+				stats[slot] = stat;
+			}
+			continue;
+		}
+
+		memset(&in, 0, sizeof(in));
+		if (11 != sscanf(line, "%c %u %u %u %u %u %u %f %f %f %31s", &op,
+			&muxA, &muxB, &accept, &samples, &settle, &in.slot,
+			&in.expect, &in.lower, &in.upper, verdict)) {
+			printf("plan %s:%d format fail!\n", filename, lineno);
+			fclose(fp);
+			free(stats);
+			TPFree(prog);
+			return -1;
+		}
+		in.op = ('S' == op) ? TP_SCREEN : TP_MEASURE;
+		in.muxA = muxA;
+		in.muxB = muxB;
+		in.accept = accept;
+		in.samples = samples;
+		in.settle_us = settle;
+		in.verdict = TP_VERDICT_NONE;
+		for (i = 0; i < TP_VERDICT_MAX; i++) {
+			if (0 == strcmp(verdict, verdictnames[i])) {
+				in.verdict = i;
+			}
+		}
+		if (TPEmit(prog, &in) < 0) {
+			fclose(fp);
+			free(stats);
+			TPFree(prog);
+			return -1;
+		}
+	}
+	fclose(fp);
+
+	if (slots > prog->nslots) {
+		prog->nslots = slots;
+	}
+	if ((NULL != stats) && (statslots < prog->nslots)) {
+		free(stats); // slots line does not match the plan
+		stats = NULL;
+	}
+	prog->stats = stats;
+	return prog->count;
+}
+
+// the same checks in the same order, the samples and settle of the
+// budget aside
+int TPSameChecks(const struct stprogram *a, const struct stprogram *b) {
+	const struct stinstr *x, *y;
+	int pc;
+
+	if ((a->count != b->count) || (a->nslots != b->nslots)) {
+		return 0;
+	}
+	for (pc = 0; pc < a->count; pc++) {
+		x = &a->code[pc];
+		y = &b->code[pc];
+		if ((x->op != y->op) || (x->muxA != y->muxA) || (x->muxB != y->muxB)
+			|| (x->accept != y->accept) || (x->slot != y->slot) || (x->verdict != y->verdict)
+			|| (x->expect != y->expect) || (x->lower != y->lower) || (x->upper != y->upper)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// Run the plan: the only state kept between instructions is the current
+// mux addresses and the measurement slots.
+int TPExecute(const struct stprogram *prog, const struct sthwops *ops, struct sttpstats *stats) {
+	const struct stinstr *in;
+	struct stslot *slots;
+	struct stslot *slot;
+	float resist;
+	int fresh;
+	int muxA = -1;
+	int muxB = -1;
+	int pass;
+	int pc;
+
+	memset(stats, 0, sizeof(*stats));
+	slots = calloc(prog->nslots ? prog->nslots : 1, sizeof(struct stslot));
+	if (NULL == slots) {
+		printf("plan slots alloc fail!\n");
+		return -1;
+	}
+
+	for (pc = 0; pc < prog->count; pc++) {
+		in = &prog->code[pc];
+		slot = &slots[in->slot];
+		fresh = 0;
+
+		if ((TP_LEVEL_NONE != slot->level) && (slot->level >= in->accept)) {
+			stats->reuses++;
+		} else {
+			if (in->muxA != muxA) {
+				if ((NULL != ops->cancelled) && ops->cancelled()) {
+					free(slots);
+					return TP_CANCELLED;
+				}
+				ops->select(0, in->muxA);
+				muxA = in->muxA;
+			}
+			if (in->muxB != muxB) {
+				ops->select(1, in->muxB);
+				muxB = in->muxB;
+			}
+			ops->settle(in->settle_us);
+
+			if (TP_SCREEN == in->op) {
+				stats->screens++;
+				if (0 == ops->read(2, in->samples)) {
+					slot->adc0 = 0;
+					slot->adc2 = 0;
+					slot->level = TP_LEVEL_SCREEN;
+				}
+				continue;
+			}
+
+			slot->adc0 = ops->read(0, in->samples);
+			slot->adc2 = ops->read(2, in->samples);
+			slot->level = TP_LEVEL_PRECISE;
+			stats->measures++;
+			fresh = 1;
+		}
+
+		if (TP_SCREEN == in->op) {
+			continue;
+		}
+
+		resist = ops->resist(slot->adc0, slot->adc2);
+		pass = (resist > in->lower) && (resist < in->upper);
+		if (fresh && (NULL != prog->stats)) {
+			TPStatAdd(&prog->stats[in->slot], resist);
+		}
+		stats->checks++;
+		stats->fails += !pass;
+		ops->report(in, slot->adc0, slot->adc2, resist, pass);
+	}
+
+	free(slots);
+	return 0;
+}
+
+// Pick the samples and settle of every precision measurement from the
+// statistics of its slot. Averaging s samples divides the variance by s,
+// so the slot needs s = now * (zsafe * sigma / margin)^2 samples; the
+// statistics are rescaled to the new sample count so the next runs add
+// to the same distribution. A slot is budgeted once, from its first
+// measurement, and the result goes to every measurement of the slot.
+// Returns the instructions changed.
+int TPBudget(struct stprogram *prog, const struct stbudget *policy) {
+	struct stinstr *in;
+	struct stpairstat *stat;
+	struct stslotbudget {
+		unsigned char samples; // 0 while the slot is not budgeted
+		unsigned short settle_us;
+	} *budget, *b;
+	double sigma, margin, want;
+	int samples, settle;
+	int changed = 0;
+	int pc;
+
+	if (NULL == prog->stats) {
+		return 0;
+	}
+	budget = calloc(prog->nslots ? prog->nslots : 1, sizeof(*budget));
+	if (NULL == budget) {
+		printf("plan budget alloc fail!\n");
+		return -1;
+	}
+
+	for (pc = 0; pc < prog->count; pc++) {
+		in = &prog->code[pc];
+		stat = &prog->stats[in->slot];
+		b = &budget[in->slot];
+		if ((TP_MEASURE != in->op) || (0 != b->samples) ||
+				(stat->n < policy->minruns) || (stat->n < 2)) {
+			continue;
+		}
+
+		sigma = sqrt(stat->m2 / (stat->n - 1));
+		margin = fmin(stat->mean - in->lower, in->upper - stat->mean);
+		settle = policy->settle_us;
+		if (margin <= 0) {
+			samples = policy->maxsamples; // failing on average
+			settle = policy->marginal_settle_us;
+		} else if (0 == sigma) {
+			samples = policy->minsamples;
+		} else {
+			want = ceil(in->samples * pow(policy->zsafe * sigma / margin, 2));
+			samples = (want > policy->maxsamples) ? policy->maxsamples :
+				(want < policy->minsamples) ? policy->minsamples : want;
+			if (want > policy->maxsamples) {
+				settle = policy->marginal_settle_us;
+			}
+		}
+		if (samples < 1) {
+			samples = 1;
+		}
+
+		stat->m2 = stat->m2 * in->samples / samples;
+		b->samples = samples;
+		b->settle_us = settle;
+	}
+
+	for (pc = 0; pc < prog->count; pc++) {
+		in = &prog->code[pc];
+		b = &budget[in->slot];
+		if ((TP_MEASURE != in->op) || (0 == b->samples)) {
+			continue;
+		}
+		if ((b->samples != in->samples) || (b->settle_us != in->settle_us)) {
+			changed++;
+		}
+		in->samples = b->samples;
+		in->settle_us = b->settle_us;
+	}
+	free(budget);
+	return changed;
+}
@@ -0,0 +1,107 @@
+#ifndef TESTPLAN_H
+#define TESTPLAN_H
+
+/*
+ * Compiled test plan: a flat list of instructions, one per measured pair,
+ * run in order by TPExecute(). All decisions about which pairs to scan, the
+ * reuse of reciprocal readings and the PASS band of every pair are taken by
+ * the compiler, the executor only switches, reads and compares.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TP_MEASURE (0) // precision read of ADC0/ADC2, then check
+#define TP_SCREEN (1)  // one ADC2 conversion, keep it only if clear open
+
+// what a measurement slot holds, an instruction reuses its slot when the
+// level is at least its accept level
+#define TP_LEVEL_NONE (0)
+#define TP_LEVEL_SCREEN (1)
+#define TP_LEVEL_PRECISE (2)
+
+#define TP_VERDICT_OPEN (0)       // reverse diode
+#define TP_VERDICT_DIODE (1)
+#define TP_VERDICT_DIRECT (2)
+#define TP_VERDICT_DISCONNECT (3)
+#define TP_VERDICT_RESIST (4)
+#define TP_VERDICT_NONE (5)       // screen only
+#define TP_VERDICT_MAX (6)
+
+struct stinstr {
+	unsigned short muxA;
+	unsigned short muxB;
+	unsigned char op;
+	unsigned char accept;
+	unsigned char samples;
+	unsigned char verdict;
+	unsigned short settle_us;
+	unsigned int slot;  // reciprocal pairs share a slot
+	float expect;       // adcarray value, for the report
+	float lower;        // PASS if lower < R < upper
+	float upper;
+};
+
+// Welford running mean and variance of the resistance read in one slot,
+// over the past runs, at the sample count the slot is read with now
+struct stpairstat {
+	unsigned int n;
+	double mean;
+	double m2;
+};
+
+struct stprogram {
+	struct stinstr *code;
+	int count;
+	int size;
+	int nslots; // measurement slots, reciprocal pairs share one
+	struct stpairstat *stats; // per slot, NULL when not learned
+};
+
+// sample budget: a pair gets as many samples as keep its nearest limit
+// zsafe sigma away, a pair that cannot also gets the longer settle
+struct stbudget {
+	unsigned int minruns;  // runs before the statistics are used
+	float zsafe;
+	unsigned char minsamples;
+	unsigned char maxsamples;
+	unsigned short settle_us;
+	unsigned short marginal_settle_us;
+};
+
+struct sttpstats {
+	int measures;
+	int screens;
+	int reuses;
+	int checks;
+	int fails;
+};
+
+struct sthwops {
+	void (*select)(int domain, unsigned int num);
+	float (*read)(int channel, int samples);
+	void (*settle)(int us);
+	float (*resist)(float adc0, float adc2);
+	void (*report)(const struct stinstr *in, float adc0, float adc2, float resist, int pass);
+	int (*cancelled)(void); // optional, asked when the A point changes
+};
+
+#define TP_CANCELLED (1) // TPExecute() stopped by ops->cancelled
+
+void TPInit(struct stprogram *prog);
+void TPFree(struct stprogram *prog);
+int TPEmit(struct stprogram *prog, const struct stinstr *in);
+int TPSave(const struct stprogram *prog, const char *filename);
+int TPLoad(struct stprogram *prog, const char *filename);
+int TPExecute(const struct stprogram *prog, const struct sthwops *ops, struct sttpstats *stats);
+const char *TPVerdictName(int verdict);
+int TPEnableStats(struct stprogram *prog);
+int TPBudget(struct stprogram *prog, const struct stbudget *policy);
+int TPSameChecks(const struct stprogram *a, const struct stprogram *b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TESTPLAN_H
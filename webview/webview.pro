@@ -0,0 +1,18 @@
+#-------------------------------------------------
+#
+# The web view of test1 as a plugin: only this links WebKit, test1 loads
+# it from plugins/ next to the binary when a page is first shown.
+#
+#-------------------------------------------------
+
+QT       += core gui webkitwidgets webkit widgets
+
+TARGET = webview
+TEMPLATE = lib
+CONFIG += plugin
+DESTDIR = ../plugins
+
+SOURCES += webviewplugin.cpp
+
+HEADERS  += webviewplugin.h \
+    ../webviewinterface.h
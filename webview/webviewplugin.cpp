@@ -0,0 +1,10 @@
+#include <QWebView>
+#include "webviewplugin.h"
+
+QWidget *WebViewPlugin::createView(const QUrl &url, QWidget *parent)
+{
+    QWebView *view = new QWebView(parent);
+
+    view->setUrl(url);
+    return view;
+}
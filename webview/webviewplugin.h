@@ -0,0 +1,16 @@
+#ifndef WEBVIEWPLUGIN_H
+#define WEBVIEWPLUGIN_H
+
+#include <QObject>
+#include "../webviewinterface.h"
+
+class WebViewPlugin : public QObject, public WebViewInterface
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID WebViewInterface_iid)
+    Q_INTERFACES(WebViewInterface)
+public:
+    QWidget *createView(const QUrl &url, QWidget *parent = 0);
+};
+
+#endif // WEBVIEWPLUGIN_H
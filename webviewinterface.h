@@ -0,0 +1,20 @@
+#ifndef WEBVIEWINTERFACE_H
+#define WEBVIEWINTERFACE_H
+
+#include <QtPlugin>
+#include <QWidget>
+#include <QUrl>
+
+// The web view lives in the webview plugin (webview/webview.pro), so test1
+// itself does not link WebKit; the plugin is loaded on the first use.
+class WebViewInterface
+{
+public:
+    virtual ~WebViewInterface() {}
+    virtual QWidget *createView(const QUrl &url, QWidget *parent = 0) = 0;
+};
+
+#define WebViewInterface_iid "com.sdssly.test1.WebViewInterface/1.0"
+Q_DECLARE_INTERFACE(WebViewInterface, WebViewInterface_iid)
+
+#endif // WEBVIEWINTERFACE_H
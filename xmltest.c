@@ -11,8 +11,11 @@
  * author: Daniel Veillard
  * copy: see Copyright for the status of this software.
  * 
- * gcc --static /xmltest.c -I/usr/include/libxml2  -lxml2   -lm -lz -llzma  
+ * gcc --static /xmltest.c /hwsim.c /testplan.c /histo.c /resultsink.c /history.c /plancache.c /nxfstream.c /liveshm.c /fbstatus.c -I/usr/include/libxml2  -lxml2   -lm -lz -llzma -lpthread -lrt
+ *
+ * -DXT_LIBRARY leaves out main(), the engine is then used through xtengine.h
  */
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
@@ -22,8 +25,25 @@
 #include <fcntl.h>
 #include <math.h>
 #include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <malloc.h>
+#include <sys/mman.h>
+#include <signal.h>
+#include <stdarg.h>
 #include <libxml/xmlreader.h>
 #include "imx_adc.h"
+#include "hwsim.h"
+#include "testplan.h"
+#include "histo.h"
+#include "resultsink.h"
+#include "history.h"
+#include "plancache.h"
+#include "nxfstream.h"
+#include "liveshm.h"
+#include "fbstatus.h"
+#include "xtengine.h"
 
 extern char *optarg;
 extern int optind, opterr, optopt;
@@ -53,36 +73,21 @@ extern int optind, opterr, optopt;
 
 #define MAX_RESIST 	(10000000)
 
-double ShortMin = 0;
-double ShortMax = 0;
-
-double ContMin = 0;
-double ContMax = 0;
-int GetConnection = 0;
-int totalconnectnum = 0;
-
-int GetComp = 0;
-int totalcomp = 0;
-
-int GetSplice = 0;
-int totalsplice = 0;
-
-int GetFixture = 0;
-int totalfixture = 0;
-
-int GetCont = 0;
-int GetShort = 0;
-unsigned int ContisUsed = 0;
-unsigned int ShortisUsed = 0;
-
-char g_fixturename[32];
-
+// time spent in the row parsers of printNode, reported by the perf run
+#define PARSER_FIXTURE (0)
+#define PARSER_SPLICE (1)
+#define PARSER_CONNECTION (2)
+#define PARSER_COMPOMENT (3)
+#define PARSER_MAX (4)
+struct stparserstat {
+	unsigned long calls;
+	unsigned long long bytes;
+	unsigned long long ns;
+};
 struct stfixture { // id must < 999
 	unsigned int id;
 	char name[32];
 };
-// Save these test points
-struct stfixture fixturelist[999] = {0};
 
 struct stswitch {
 	unsigned int pointA;
@@ -99,13 +104,11 @@ struct stcompoment {
 	float value;
 	int tolerance; 	// in percent
 };
-struct stcompoment complist[99] = {0};
 
 struct stsplice {
 	unsigned int id;
 	char name[32];
 };
-struct stsplice splicelist[99] = {0};
 
 
 struct stconnections {
@@ -114,7 +117,6 @@ struct stconnections {
 	char name[32];
 	unsigned int color;
 };
-struct stconnections connlist[999] = {0};
 
 struct sttestconnections {
 	unsigned int pointA;
@@ -129,16 +131,235 @@ int b_domain[] = {98, 100, 44, 45, 89, 46, 87, 88, 5, 4};
 
 int g_gpiofd[MAXCHANNEL];
 
-// save these connection list table
-float adcarray[MAXCHANNEL][MAXCHANNEL] = {};
+// Readings are keyed by the unordered pair (low, high) plus a direction.
+// Wires, resistors and opens read the same both ways and share the
+// MEAS_RECIPROCAL key, diodes keep one key per direction.
+#define MEAS_RECIPROCAL (0) // or measured from the low to the high point
+#define MEAS_REVERSE (1) // measured from the high to the low point
+#define MEAS_KEYS (MAXCHANNEL * (MAXCHANNEL + 1))
+
+// compiled scan of the current plan
+struct stprogram g_program;
+struct sttpstats g_scanstats;
+char g_planfilename[256] = ""; // run this compiled plan instead of an NXF
+char g_savefilename[256] = ""; // save the compiled plan
+int g_adcfd = -1;
+
+// fail list of the current run, read back by the retest mode
+#define FAILLIST_DEFAULT "xmltest.fail"
+char g_failfilename[256] = FAILLIST_DEFAULT;
+char g_retestfilename[256] = "";
+FILE *g_failfile = NULL;
+int g_totalfail = 0;
+int g_totaltested = 0;
+
+// structured results for the MES, format from the file name
+char g_resultfilename[256] = "";
+struct stresultsink *g_resultsink = NULL;
+
+// result history of every run, per harness serial
+char g_historydir[256] = "";
+char g_serial[HS_SERIAL_SIZE] = "-";
+struct sthistory *g_history = NULL;
+
+// live results in shared memory for the GUI, see liveshm.h
+char g_livename[64] = "";
+struct stlive *g_live = NULL;
+
+// operator status on the framebuffer, see fbstatus.h
+char g_fbname[256] = "";
+struct stfb *g_fb = NULL;
+
+// the engine of a library caller, see xtengine.h; g_engine is the one
+// scanning, the scans take turns on g_enginelock
+struct stxtengine {
+	struct stxtoptions options;
+	char serial[HS_SERIAL_SIZE];
+	char faillist[256];
+	char historydir[256];
+	struct stxtcallbacks callbacks;
+	char filename[256];
+	struct stcompiled *compiled;
+	off_t size;   // of the file compiled, a change of either rebuilds
+	time_t mtime;
+	pthread_t thread;
+	int running;
+	int finished;
+	int cancel;
+	int status;
+	unsigned int pairs;
+};
+pthread_mutex_t g_enginelock = PTHREAD_MUTEX_INITIALIZER;
+int g_engines = 0;
+int g_engineadc = -1;
+struct stxtengine *g_engine = NULL;
+
+// retest mode: only the pairs of the fail list and their nets are measured
+int g_retest = 0;
+
+// Everything parsed from one NXF and built from it. The parser, builder
+// and compiler only work on the plan passed in, so several NXF files can
+// be loaded at once, one plan per thread.
+struct stplan {
+	const char *filename;
+	int verbose;  // the parse and build log on stdout
+	int errors;   // rows and connections rejected
+
+	// parser state, set by the element being read
+	int GetConnection;
+	int GetComp;
+	int GetSplice;
+	int GetFixture;
+	int GetCont;
+	int GetShort;
+	char fixturename[32];
+
+	double ShortMin;
+	double ShortMax;
+	double ContMin;
+	double ContMax;
+	unsigned int ContisUsed;
+	unsigned int ShortisUsed;
+
+	// Save these test points
+	struct stfixture fixturelist[999];
+	int totalfixture;
+	struct stcompoment complist[99];
+	int totalcomp;
+	struct stsplice splicelist[99];
+	int totalsplice;
+	struct stconnections connlist[999];
+	int totalconnectnum;
+
+	// save these connection list table
+	float adcarray[MAXCHANNEL][MAXCHANNEL];
+
+	// save these points used in the connection list
+	int testpointsA[MAXCHANNEL];
+	int testpointsB[MAXCHANNEL];
+	int allUsedpoints[MAXCHANNEL];
+
+	// retest: only the pairs marked here are measured again
+	int retest;
+	unsigned char retestpairs[MAXCHANNEL][MAXCHANNEL];
+
+	// nets joined by direct connections, used to expand a fail list
+	int netparent[MAXCHANNEL];
+
+	struct stparserstat parserstat[PARSER_MAX];
+	unsigned long long xmlbytes; // the document, decompressed
+};
+
+// the plan of this run
+struct stplan *g_plan = NULL;
+
+// scan options
+int g_twostage = 0;  // screen the expected opens before the precision pass
+int g_samples = XT_SAMPLES_DEFAULT; // ADC results averaged by a precision measurement
+int g_settleus = 0;  // settle time after a mux switch, precision only
+int g_quiet = 0;     // only print the FAIL lines of the scan
+
+// learn the per-pair resistance statistics in the plan and budget the
+// samples and settle of every pair from them
+int g_budget = 0;
+struct stbudget g_budgetpolicy = {
+	5,    // minruns
+	6,    // zsafe
+	1,    // minsamples
+	16,   // maxsamples
+	0,    // settle_us, -t
+	200,  // marginal_settle_us
+};
+
+// run on the simulated mux/ADC instead of the fixture
+int g_simulate = 0;
+char g_expectfilename[256] = ""; // sim truth from nxfgen, else from adcarray
+struct stsimlatency g_simlatency = {
+	20,   // gpio_us
+	100,  // convert_us
+	20,   // settle_tau_us
+	1.5,  // noise
+};
+
+// real-time scan: locked memory, SCHED_FIFO, pinned to one cpu
+#define RT_STACK_SIZE (512 * 1024)
+#define RT_STACK_PREFAULT (256 * 1024)
+int g_realtime = 0;
+int g_rtcpu = -1;  // -1: the last online cpu
+int g_rtprio = 80;
+
+// time from a mux switch to the next ADC sample, in ns
+struct sthisto g_jitter;
+unsigned long long g_switchns = 0;
+int g_switched = 0;
+
+// scan loop phases, timed on every pair, dumped at exit and on SIGUSR1
+#define PHASE_GPIO (0)    // mux address, 10 sysfs WritePin
+#define PHASE_SETTLE (1)
+#define PHASE_ADC (2)     // IMX_ADC_CONVERT ioctl
+#define PHASE_RESIST (3)  // GetResist
+#define PHASE_REPORT (4)  // scan log printf and fail list
+#define PHASE_MAX (5)
+struct sthisto g_phase[PHASE_MAX];
+static const char *phasenames[PHASE_MAX] = {
+	"gpio write",
+	"settle",
+	"adc convert",
+	"GetResist",
+	"report",
+};
+unsigned long long g_scanns = 0;     // time spent in the scan loop
+unsigned long long g_scanstart = 0;  // 0 when no scan is running
+volatile sig_atomic_t g_phasedump = 0;
+
+// batch: parse, validate and compile many NXF files on a thread pool
+#define BATCH_THREADS_MAX (64)
+int g_batchthreads = 0; // 0: one per online cpu
+
+// station: compiled plans kept resident for the harness type switches
+#define CACHE_PLANS (8)
+#define CACHE_BUDGET_MB (64)
+int g_cacheplans = CACHE_PLANS;
+unsigned long long g_cachebudget = CACHE_BUDGET_MB * 1048576ULL;
+
+// perf run: results as JSON lines on stdout, the scan log goes to /dev/null
+#define PERF_ITERATIONS (10)
+#define PERF_MODELS_MAX (8)
+struct stperfmodel {
+	char name[16];
+	struct stsimlatency latency;
+};
+int g_perfiterations = PERF_ITERATIONS;
+int g_perfmodelnum = 4;
+int g_perfusermodel = 0; // the first -L replaces the built-in models
+struct stperfmodel g_perfmodels[PERF_MODELS_MAX] = {
+	{"ideal", {0, 0, 0, 1.5}},
+	{"default", {20, 100, 20, 1.5}},
+	{"slow-gpio", {100, 100, 20, 1.5}},
+	{"slow-adc", {20, 400, 50, 1.5}},
+};
+
+#define SCANLOG(...) do { if (!g_quiet) printf(__VA_ARGS__); } while (0)
 
-float readADC0value[MAXCHANNEL][MAXCHANNEL] = {};
-float readADC2value[MAXCHANNEL][MAXCHANNEL] = {};
+// the parse and build log of one plan, off when plans load in parallel
+#define PLANLOG(plan, ...) do { if ((plan)->verbose) printf(__VA_ARGS__); } while (0)
 
-// save these points used in the connection list
-int testpointsA[MAXCHANNEL] = {-1};
-int testpointsB[MAXCHANNEL] = {-1};
-int allUsedpoints[MAXCHANNEL] = {-1};
+// a rejected row or connection: always printed, counted in plan->errors
+static void PlanError(struct stplan *plan, const char *format, ...) {
+	char line[256];
+	va_list args;
+
+	plan->errors++;
+	va_start(args, format);
+	vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	// one printf per line, the batch threads share stdout
+	if (plan->verbose || (NULL == plan->filename)) {
+		printf("%s", line);
+	} else {
+		printf("%s: %s", plan->filename, line);
+	}
+}
 
 static float GetResist(float adc0, float adc2) {
 	float R = -1;
@@ -154,27 +375,27 @@ static float GetResist(float adc0, float adc2) {
 	return R;
 }
 
-static char inSpliceList(unsigned int id) {
+static char inSpliceList(struct stplan *plan, unsigned int id) {
 	int i = 0;
-	for (i = 0; i < totalsplice; i++) {
-		if (id == splicelist[i].id) {
+	for (i = 0; i < plan->totalsplice; i++) {
+		if (id == plan->splicelist[i].id) {
 			return 1;
 		}
 	}
 	return 0;
 }
 
-static struct stcompoment* FindCompoment(unsigned int id) {
+static struct stcompoment* FindCompoment(struct stplan *plan, unsigned int id) {
 	int i = 0;
-	for (i = 0; i < totalcomp; i++) {
-		if (id == complist[i].id) {
-			return &complist[i];
+	for (i = 0; i < plan->totalcomp; i++) {
+		if (id == plan->complist[i].id) {
+			return &plan->complist[i];
 		}
 	}
 	return NULL;
 }
 
-static unsigned int tracePoint(unsigned int point) {
+static unsigned int tracePoint(struct stplan *plan, unsigned int point) {
 	struct stcompoment* pcompoment = NULL;
 	int i, j;
 	unsigned int realpoint = point;
@@ -183,24 +404,24 @@ static unsigned int tracePoint(unsigned int point) {
 	}
 
 	if (point < 81920) {
-		if (!inSpliceList(point)) {
-			printf("point fail!\n");
+		if (!inSpliceList(plan, point)) {
+			PlanError(plan, "point fail!\n");
 			return -1;
 		}
 		// find the splice point pair
-		for (i = 0; i < totalconnectnum; i++) {
-			if (connlist[i].pointA == point) {
-				realpoint = connlist[i].pointB;
+		for (i = 0; i < plan->totalconnectnum; i++) {
+			if (plan->connlist[i].pointA == point) {
+				realpoint = plan->connlist[i].pointB;
 				break;
 			} 
-			if (connlist[i].pointB == point) {
-				realpoint = connlist[i].pointA;
+			if (plan->connlist[i].pointB == point) {
+				realpoint = plan->connlist[i].pointA;
 				break;
 			}
 		}
 
 		if (realpoint > 999) {
-			printf("splice pair fail\n");
+			PlanError(plan, "splice pair fail\n");
 			return -1;
 		}
 		return realpoint;
@@ -208,25 +429,25 @@ static unsigned int tracePoint(unsigned int point) {
 
 	// compoment checking
 	if (0 == point % 2) {
-		pcompoment= FindCompoment(point);
+		pcompoment= FindCompoment(plan, point);
 	} else {
-		pcompoment = FindCompoment(point - 1);
+		pcompoment = FindCompoment(plan, point - 1);
 	}
 
 	if (NULL == pcompoment) {
-		printf("Find compoment fail! point=%d\n", point);
+		PlanError(plan, "Find compoment fail! point=%d\n", point);
 		return -1;
 	}
 
 		//printf("compoment type=%d value=%f\n", pcompoment->type, pcompoment->value);
 		// find the compoment point pair
-		for (i = 0; i < totalconnectnum; i++) {
-			if (connlist[i].pointA == point) {
-				realpoint = connlist[i].pointB;
+		for (i = 0; i < plan->totalconnectnum; i++) {
+			if (plan->connlist[i].pointA == point) {
+				realpoint = plan->connlist[i].pointB;
 				break;
 			} 
-			if (connlist[i].pointB == point) {
-				realpoint = connlist[i].pointA;
+			if (plan->connlist[i].pointB == point) {
+				realpoint = plan->connlist[i].pointA;
 				break;
 			}
 		}		
@@ -234,7 +455,7 @@ static unsigned int tracePoint(unsigned int point) {
 }
 
 
-static void printAttribute(xmlTextReaderPtr reader)  
+static void printAttribute(struct stplan *plan, xmlTextReaderPtr reader)  
 {  
     if(1 == xmlTextReaderHasAttributes(reader))  
     {  
@@ -244,65 +465,65 @@ static void printAttribute(xmlTextReaderPtr reader)
         {  
             name=xmlTextReaderConstName(reader);  
             value=xmlTextReaderConstValue(reader);  
-            printf("\tattr=[%s],val=[%s]\n",name,value);
-			if (GetFixture == 1) {
+            PLANLOG(plan, "\tattr=[%s],val=[%s]\n",name,value);
+			if (plan->GetFixture == 1) {
 				if (strcmp(name, "name") == 0) {
-					printf("Fixture %s\n", value);
-					strcpy(g_fixturename, value);
+					PLANLOG(plan, "Fixture %s\n", value);
+					snprintf(plan->fixturename, sizeof(plan->fixturename), "%s", value);
 				}
 			}
 
-			if (GetCont == 1) {
+			if (plan->GetCont == 1) {
 				if (strcmp(name, "opts") == 0) {
 					// check the value, should be eo/ek/em, or o/k/m
-					printf("opts=%s\n", value);
+					PLANLOG(plan, "opts=%s\n", value);
 					if (strcmp(value, "eo") == 0) {
-						ContisUsed = 1;
+						plan->ContisUsed = 1;
 					} else if (strcmp(value, "ek") == 0) {
-						ContisUsed = 1000;
+						plan->ContisUsed = 1000;
 					} else if (strcmp(value, "em") == 0) {
-						ContisUsed = (1000*1000);
+						plan->ContisUsed = (1000*1000);
 					} else {
-						printf("Not used the connect limit...\n");
-						ContisUsed = 0;
+						PLANLOG(plan, "Not used the connect limit...\n");
+						plan->ContisUsed = 0;
 					} 
 				}
 
 				if (strcmp(name, "val") == 0) {
-					printf("val=%s\n", value);
-					if (ContMin >= 0) {
-						printf("Set the min/max using the first Cont element\n");
-						ContMin = -(ContisUsed * atof(value));
-						ContMax = (ContisUsed * atof(value));
+					PLANLOG(plan, "val=%s\n", value);
+					if (plan->ContMin >= 0) {
+						PLANLOG(plan, "Set the min/max using the first Cont element\n");
+						plan->ContMin = -(plan->ContisUsed * atof(value));
+						plan->ContMax = (plan->ContisUsed * atof(value));
 					}
-					printf("Cont range %f-%f\n", ContMin, ContMax);
+					PLANLOG(plan, "Cont range %f-%f\n", plan->ContMin, plan->ContMax);
 				}				
 			}			
 
-			if (GetShort == 1) {
+			if (plan->GetShort == 1) {
 				if (strcmp(name, "opts") == 0) {
 					// check the value, should be eo/ek/em, or o/k/m
-					printf("opts=%s\n", value);
+					PLANLOG(plan, "opts=%s\n", value);
 					if (strcmp(value, "eo") == 0) {
-						ShortisUsed = 1;
+						plan->ShortisUsed = 1;
 					} else if (strcmp(value, "ek") == 0) {
-						ShortisUsed = 1000;
+						plan->ShortisUsed = 1000;
 					} else if (strcmp(value, "em") == 0) {
-						ShortisUsed = (1000*1000);
+						plan->ShortisUsed = (1000*1000);
 					} else {
-						printf("Not used the short limit...\n");
-						ShortisUsed = 0;
+						PLANLOG(plan, "Not used the short limit...\n");
+						plan->ShortisUsed = 0;
 					} 
 				}
 
 				if (strcmp(name, "val") == 0) {
-					printf("val=%s\n", value);
-					if (ShortMin >= 0) {
-						printf("Set the min/max using the first short element\n");
-						ShortMin = -(ShortisUsed * atof(value));
-						ShortMax = (ShortisUsed * atof(value));
+					PLANLOG(plan, "val=%s\n", value);
+					if (plan->ShortMin >= 0) {
+						PLANLOG(plan, "Set the min/max using the first short element\n");
+						plan->ShortMin = -(plan->ShortisUsed * atof(value));
+						plan->ShortMax = (plan->ShortisUsed * atof(value));
 					}
-					printf("Short range %f-%f\n", ShortMin, ShortMax);
+					PLANLOG(plan, "Short range %f-%f\n", plan->ShortMin, plan->ShortMax);
 				}				
 			}
 
@@ -310,11 +531,11 @@ static void printAttribute(xmlTextReaderPtr reader)
         }  
         xmlTextReaderMoveToElement(reader);  
     }  
-	GetCont = 0;
-	GetShort = 0;
+	plan->GetCont = 0;
+	plan->GetShort = 0;
 }
 
-static void GetFixtures(const xmlChar *value) {
+static void GetFixtures(struct stplan *plan, const xmlChar *value) {
 	char id1[32];
 	char id2[32];
 	char id3[32];
@@ -326,7 +547,7 @@ static void GetFixtures(const xmlChar *value) {
 	char *start = (char *) value;
 	char *str = (char *)value;
 	char *values = NULL;
-	printf("%s [%s]\n", __FUNCTION__, str);
+	PLANLOG(plan, "%s [%s]\n", __FUNCTION__, str);
 
 	leftstring = strstr(str, token);
 	while (leftstring) {
@@ -343,24 +564,32 @@ static void GetFixtures(const xmlChar *value) {
 			// get these  list
 			ret = sscanf((char *)values, "%[^,],%[^,],%[^,]", id1, id2, id3);
 			if (ret == 3) { // check the switch 
-				connlist[totalconnectnum].pointA = strtoul(id1, NULL, 10);
-				connlist[totalconnectnum].pointB = strtoul(id3, NULL, 10);
-				sprintf(connlist[totalconnectnum].name, "%s%s", g_fixturename, id2); 
-				connlist[totalconnectnum].color = 0;
-				printf("connection:%d-%d name=%s color=%d\n", connlist[totalconnectnum].pointA,
-					connlist[totalconnectnum].pointB, connlist[totalconnectnum].name, connlist[totalconnectnum].color);				
-				totalconnectnum++;
+				if (plan->totalconnectnum >= ARRAY_SIZE(plan->connlist)) {
+					PlanError(plan, "connection list full! %d\n", plan->totalconnectnum);
+					return;
+				}
+				plan->connlist[plan->totalconnectnum].pointA = strtoul(id1, NULL, 10);
+				plan->connlist[plan->totalconnectnum].pointB = strtoul(id3, NULL, 10);
+				sprintf(plan->connlist[plan->totalconnectnum].name, "%s%s", plan->fixturename, id2); 
+				plan->connlist[plan->totalconnectnum].color = 0;
+				PLANLOG(plan, "connection:%d-%d name=%s color=%d\n", plan->connlist[plan->totalconnectnum].pointA,
+					plan->connlist[plan->totalconnectnum].pointB, plan->connlist[plan->totalconnectnum].name, plan->connlist[plan->totalconnectnum].color);				
+				plan->totalconnectnum++;
 			} else { // fixture
 				ret = sscanf((char *)values, "%[^,],%[^,]", id1, id2);
 				if (ret != 2) {
-					printf("Get fixture list fail!\n");
+					PlanError(plan, "Get fixture list fail!\n");
 					return;
 				}
 				//printf("ret=%d %s-%s\n", ret, id1, id2);
-				fixturelist[strtoul(id1, NULL, 10)].id = strtoul(id1, NULL, 10); 
-				sprintf(fixturelist[strtoul(id1, NULL, 10)].name, "%s%s", g_fixturename, id2);
-				printf("fixture:%d name=%s\n", fixturelist[totalfixture].id, fixturelist[totalfixture].name);
-				totalfixture++;	
+				if (strtoul(id1, NULL, 10) >= ARRAY_SIZE(plan->fixturelist)) {
+					PlanError(plan, "fixture point fail! %s\n", id1);
+					return;
+				}
+				plan->fixturelist[strtoul(id1, NULL, 10)].id = strtoul(id1, NULL, 10); 
+				sprintf(plan->fixturelist[strtoul(id1, NULL, 10)].name, "%s%s", plan->fixturename, id2);
+				PLANLOG(plan, "fixture:%d name=%s\n", plan->fixturelist[plan->totalfixture].id, plan->fixturelist[plan->totalfixture].name);
+				plan->totalfixture++;	
 			}
 		}
 		str = leftstring + strlen(token);
@@ -371,7 +600,7 @@ static void GetFixtures(const xmlChar *value) {
 
 
 // 65636,S1
-static void GetSplices(const xmlChar *value) {
+static void GetSplices(struct stplan *plan, const xmlChar *value) {
 	char id1[32];
 	char id2[32];
 	int ret = 0; 
@@ -382,7 +611,7 @@ static void GetSplices(const xmlChar *value) {
 	char *start = (char *) value;
 	char *str = (char *)value;
 	char *values = NULL;
-	printf("%s [%s]\n", __FUNCTION__, str);
+	PLANLOG(plan, "%s [%s]\n", __FUNCTION__, str);
 
 	leftstring = strstr(str, token);
 	while (leftstring) {
@@ -401,16 +630,20 @@ static void GetSplices(const xmlChar *value) {
 				id2);
 			//printf("ret=%d %s-%s\n", ret, id1, id2);
 			if (ret != 2) {
-				printf("Get splice list fail!\n");
+				PlanError(plan, "Get splice list fail!\n");
 				return ;
 			}
+			if (plan->totalsplice >= ARRAY_SIZE(plan->splicelist)) {
+				PlanError(plan, "splice list full! %d\n", plan->totalsplice);
+				return;
+			}
 
-			splicelist[totalsplice].id = strtoul(id1, NULL, 10);
-			strcpy(splicelist[totalsplice].name, id2);			
+			plan->splicelist[plan->totalsplice].id = strtoul(id1, NULL, 10);
+			strcpy(plan->splicelist[plan->totalsplice].name, id2);			
 
-			printf("splice:%d name=%s\n", splicelist[totalsplice].id, splicelist[totalsplice].name);
+			PLANLOG(plan, "splice:%d name=%s\n", plan->splicelist[plan->totalsplice].id, plan->splicelist[plan->totalsplice].name);
 			
-			totalsplice++;
+			plan->totalsplice++;
 		}
 		str = leftstring + strlen(token);
 		leftstring = strstr((char *)str, token);
@@ -424,7 +657,7 @@ static void GetSplices(const xmlChar *value) {
 //					81923,7,TESTW5,14
 //					2,65636,TESTW6,16
 //					65636,2,TESTW7,0
-static void GetConnections(const xmlChar *value) {
+static void GetConnections(struct stplan *plan, const xmlChar *value) {
 	char id1[32];
 	char id2[32];
 	char id3[32];
@@ -437,7 +670,7 @@ static void GetConnections(const xmlChar *value) {
 	char *start = (char *) value;
 	char *str = (char *)value;
 	char *values = NULL;
-	printf("%s [%s]\n", __FUNCTION__, str);
+	PLANLOG(plan, "%s [%s]\n", __FUNCTION__, str);
 
 	leftstring = strstr(str, token);
 	while (leftstring) {
@@ -450,27 +683,31 @@ static void GetConnections(const xmlChar *value) {
 			while ((*values == ' ') || (*values == '\t')) {
 				++values;
 			}
-			printf("values=[%s] len=%zu\n", values, strlen(values));
+			PLANLOG(plan, "values=[%s] len=%zu\n", values, strlen(values));
 			// get these  list
 			ret = sscanf((char *)values, "%[^,],%[^,],%[^,],%[^,]", id1, 
 				id2, id3, id4);
-			printf("ret=%d %s-%s-%s-%s\n", ret, id1, id2, id3, 
+			PLANLOG(plan, "ret=%d %s-%s-%s-%s\n", ret, id1, id2, id3, 
 			id4);
 			if (ret != 4) {
-				printf("Get connection list fail!\n");
+				PlanError(plan, "Get connection list fail!\n");
 				return ;
 			}
+			if (plan->totalconnectnum >= ARRAY_SIZE(plan->connlist)) {
+				PlanError(plan, "connection list full! %d\n", plan->totalconnectnum);
+				return;
+			}
 
-			connlist[totalconnectnum].pointA = strtoul(id1, NULL, 10);
-			connlist[totalconnectnum].pointB = strtoul(id2, NULL, 10);
-			strcpy(connlist[totalconnectnum].name, id3); 
-			connlist[totalconnectnum].color = strtoul(id4, NULL, 10);
+			plan->connlist[plan->totalconnectnum].pointA = strtoul(id1, NULL, 10);
+			plan->connlist[plan->totalconnectnum].pointB = strtoul(id2, NULL, 10);
+			strcpy(plan->connlist[plan->totalconnectnum].name, id3); 
+			plan->connlist[plan->totalconnectnum].color = strtoul(id4, NULL, 10);
 			
 
-			printf("connection:%d-%d name=%s color=%d\n", connlist[totalconnectnum].pointA,
-				connlist[totalconnectnum].pointB, connlist[totalconnectnum].name, connlist[totalconnectnum].color);
+			PLANLOG(plan, "connection:%d-%d name=%s color=%d\n", plan->connlist[plan->totalconnectnum].pointA,
+				plan->connlist[plan->totalconnectnum].pointB, plan->connlist[plan->totalconnectnum].name, plan->connlist[plan->totalconnectnum].color);
 			
-			totalconnectnum++;
+			plan->totalconnectnum++;
 		}
 		str = leftstring + strlen(token);
 		leftstring = strstr((char *)str, token);
@@ -481,7 +718,7 @@ static void GetConnections(const xmlChar *value) {
 // 81920,d,D1,26,-1,90,0
 // 81922,r,R1,10,0,10,k
 //\r\n\t\t\t81920,d,D1,26,-1,90,0\r\n\t\t\t81922,r,R1,10,0,10,k\r\n\t\t"
-static void GetCompoments(const xmlChar *value) {
+static void GetCompoments(struct stplan *plan, const xmlChar *value) {
 	char id1[32];
 	char id2[32];
 	char id3[32];
@@ -497,7 +734,7 @@ static void GetCompoments(const xmlChar *value) {
 	char *start = (char *) value;
 	char *str = (char *)value;
 	char *values = NULL;
-	printf("GetCompoment=[%s]\n", str);
+	PLANLOG(plan, "GetCompoment=[%s]\n", str);
 
 	leftstring = strstr(str, token);
 	while (leftstring) {
@@ -516,52 +753,56 @@ static void GetCompoments(const xmlChar *value) {
 				id2, id3, id4, id5, id6, id7);
 			//printf("ret=%d %s-%s-%s-%s-%s-%s-[%s]\n", ret, id1, id2, id3, id4, id5, id6, id7);
 			if (ret != 7) {
-				printf("Get compoment list fail!\n");
+				PlanError(plan, "Get compoment list fail!\n");
 				return ;
 			}
+			if (plan->totalcomp >= ARRAY_SIZE(plan->complist)) {
+				PlanError(plan, "compoment list full! %d\n", plan->totalcomp);
+				return;
+			}
 
-			complist[totalcomp].value = 0;
-			complist[totalcomp].id = strtoul(id1, NULL, 10);
-			strcpy(complist[totalcomp].name, id3);
+			plan->complist[plan->totalcomp].value = 0;
+			plan->complist[plan->totalcomp].id = strtoul(id1, NULL, 10);
+			strcpy(plan->complist[plan->totalcomp].name, id3);
 
-			if (complist[totalcomp].id % 2 != 0) {
-				printf("comp ID fail!\n");
+			if (plan->complist[plan->totalcomp].id % 2 != 0) {
+				PlanError(plan, "comp ID fail!\n");
 			}
 			
 			if (0 == strcmp("r", id2)) {
-				complist[totalcomp].type = COMP_R;
-				complist[totalcomp].value = strtol(id4, NULL, 10)*
+				plan->complist[plan->totalcomp].type = COMP_R;
+				plan->complist[plan->totalcomp].value = strtol(id4, NULL, 10)*
 					powf(10, strtol(id5, NULL, 10));
 				if (0 == strcmp("o", id7)) {
-					complist[totalcomp].value *= 1;
+					plan->complist[plan->totalcomp].value *= 1;
 				} else if (0 == strcmp("k", id7)) {
-					complist[totalcomp].value *= 1000;
+					plan->complist[plan->totalcomp].value *= 1000;
 				}
 				else if (0 == strcmp("m", id7)) {
-					complist[totalcomp].value *= 1000000;
+					plan->complist[plan->totalcomp].value *= 1000000;
 				} else if (0 == strcmp("M", id7)) {
-					complist[totalcomp].value /= 1000000;
+					plan->complist[plan->totalcomp].value /= 1000000;
 				} else {
-					printf("R-value fail!\n");
-					complist[totalcomp].value = 9999;
+					PlanError(plan, "R-value fail!\n");
+					plan->complist[plan->totalcomp].value = 9999;
 				}
-				complist[totalcomp].tolerance = strtol(id6, NULL, 10); 
+				plan->complist[plan->totalcomp].tolerance = strtol(id6, NULL, 10); 
 			} 
 			else if (0 == strcmp("d", id2)) {
-				complist[totalcomp].type = COMP_D;
-				complist[totalcomp].tolerance = strtol(id6, NULL, 10);
+				plan->complist[plan->totalcomp].type = COMP_D;
+				plan->complist[plan->totalcomp].tolerance = strtol(id6, NULL, 10);
 			} else if (0 == strcmp("c", id2)) {
-				complist[totalcomp].type = COMP_C;
+				plan->complist[plan->totalcomp].type = COMP_C;
 			}  
 			else {
-				printf("Unknown compoment!\n");
+				PlanError(plan, "Unknown compoment!\n");
 			}
 
-			printf("comp:type=%d id=%d name=%s value=%f tolerance=%d\n", complist[totalcomp].type, 
-				complist[totalcomp].id, complist[totalcomp].name, 
-				complist[totalcomp].value, complist[totalcomp].tolerance);
+			PLANLOG(plan, "comp:type=%d id=%d name=%s value=%f tolerance=%d\n", plan->complist[plan->totalcomp].type, 
+				plan->complist[plan->totalcomp].id, plan->complist[plan->totalcomp].name, 
+				plan->complist[plan->totalcomp].value, plan->complist[plan->totalcomp].tolerance);
 			
-			totalcomp++;
+			plan->totalcomp++;
 		}
 		str = leftstring + strlen(token);
 		//if ((value - start) >=1) {
@@ -582,8 +823,15 @@ static void GetCompoments(const xmlChar *value) {
 	return;
 }
 
-static void printNode(xmlTextReaderPtr reader)  
+static void ParserTime(struct stplan *plan, int parser, unsigned long long start, const xmlChar *value) {
+	plan->parserstat[parser].ns += NowNs() - start;
+	plan->parserstat[parser].bytes += xmlStrlen(value);
+	plan->parserstat[parser].calls++;
+}
+
+static void printNode(struct stplan *plan, xmlTextReaderPtr reader)  
 {  int nodetype = -1;
+	unsigned long long start;
     const xmlChar *name,*value;  
     name=xmlTextReaderConstName(reader);
 
@@ -592,57 +840,57 @@ static void printNode(xmlTextReaderPtr reader)
 	//printf("PrintNode %d [%s]...\n", nodetype, name);  	
     if(nodetype ==XML_READER_TYPE_ELEMENT)
     {  
-        printf("start=[%s]\n",name);
+        PLANLOG(plan, "start=[%s]\n",name);
 
 		// Get the first Cont/Short elements
 		if (0 == strcmp("Cont", name)) {
-			printf("start get Cont ...\n");
-			GetCont = 1;
+			PLANLOG(plan, "start get Cont ...\n");
+			plan->GetCont = 1;
 		}
 
 		if (0 == strcmp("Short", name)) {
-			printf("start get Short ...\n");
-			GetShort = 1;
+			PLANLOG(plan, "start get Short ...\n");
+			plan->GetShort = 1;
 		}
 
 		if (0 == strcmp("Fixture", name)) {
-			printf("start get Fixture ...\n");
-			g_fixturename[0] = '\0';
-			GetFixture = 1;
+			PLANLOG(plan, "start get Fixture ...\n");
+			plan->fixturename[0] = '\0';
+			plan->GetFixture = 1;
 		}
 
 		if (0 == strcmp("Splices", name)) {
-			printf("start get Splices ...\n");
-			GetSplice = 1;
+			PLANLOG(plan, "start get Splices ...\n");
+			plan->GetSplice = 1;
 		}
 
 		if (0 == strcmp("Components", name)) {
-			printf("start get compoments ...\n");
-			GetComp = 1;
+			PLANLOG(plan, "start get compoments ...\n");
+			plan->GetComp = 1;
 		} 
 
 		if (0 == strcmp("GroupInfo", name)) {
-			printf("start get connections ...\n");
-			GetConnection= 1;
+			PLANLOG(plan, "start get connections ...\n");
+			plan->GetConnection= 1;
 		}
 		
-        printAttribute(reader);
+        printAttribute(plan, reader);
     }
 	else if(nodetype == XML_READER_TYPE_END_ELEMENT)  
     {  
     	//printf("End XML element\n");
-    	g_fixturename[0] = '\0';
-    	GetFixture = 0;
-    	GetSplice = 0;
-    	GetConnection = 0;
-    	GetComp = 0;
-		GetCont = 0;
-		GetShort = 0;
+    	plan->fixturename[0] = '\0';
+    	plan->GetFixture = 0;
+    	plan->GetSplice = 0;
+    	plan->GetConnection = 0;
+    	plan->GetComp = 0;
+		plan->GetCont = 0;
+		plan->GetShort = 0;
         //printf("end=[%s]\n",name);
     } else if (nodetype == XML_READER_TYPE_COMMENT) {
-		printf("comment=[%s]\n",name);
+		PLANLOG(plan, "comment=[%s]\n",name);
 	} else if (nodetype == XML_READER_TYPE_ATTRIBUTE ) {
-		printf("attribute=[%s]\n",name);
+		PLANLOG(plan, "attribute=[%s]\n",name);
 	} else if (nodetype == XML_READER_TYPE_SIGNIFICANT_WHITESPACE) {
 		//printf("whitespace=[%s]\n",name);
 	} else if (nodetype == XML_READER_TYPE_TEXT) {
@@ -652,7 +900,7 @@ static void printNode(xmlTextReaderPtr reader)
 	}
 	else
     {  
-       printf("name=[%s] nodetype=%d\n",name, nodetype);  
+       PLANLOG(plan, "name=[%s] nodetype=%d\n",name, nodetype);  
     }
 
 	if (nodetype == XML_READER_TYPE_SIGNIFICANT_WHITESPACE) {}
@@ -660,21 +908,29 @@ static void printNode(xmlTextReaderPtr reader)
 	    if(xmlTextReaderHasValue(reader))  
 	    {  
 	        value=xmlTextReaderConstValue(reader);
-	        printf("\tvalue=[%s]\n",value);
-			if (1 == GetComp) {
-				GetCompoments(value);
+	        PLANLOG(plan, "\tvalue=[%s]\n",value);
+			if (1 == plan->GetComp) {
+				start = NowNs();
+				GetCompoments(plan, value);
+				ParserTime(plan, PARSER_COMPOMENT, start, value);
 			}
 
-			if (1 == GetSplice) {
-				GetSplices(value);
+			if (1 == plan->GetSplice) {
+				start = NowNs();
+				GetSplices(plan, value);
+				ParserTime(plan, PARSER_SPLICE, start, value);
 			}
 
-			if (1 == GetConnection) {
-				GetConnections(value);
+			if (1 == plan->GetConnection) {
+				start = NowNs();
+				GetConnections(plan, value);
+				ParserTime(plan, PARSER_CONNECTION, start, value);
 			}
 
-			if (1 == GetFixture) {
-				GetFixtures(value);
+			if (1 == plan->GetFixture) {
+				start = NowNs();
+				GetFixtures(plan, value);
+				ParserTime(plan, PARSER_FIXTURE, start, value);
 			}
 			
 	    }
@@ -715,45 +971,57 @@ processNode(xmlTextReaderPtr reader) {
  * Parse, validate and print information about an XML file.
  */
 static void
-streamFile(const char *filename) {
+streamFile(struct stplan *plan, const char *filename) {
     xmlTextReaderPtr reader;
+    struct stnxfstream *stream = NULL;
+    struct stat st;
+    int format;
     int ret;
 
-
     /*
      * Pass some special parsing options to activate DTD attribute defaulting,
      * entities substitution and DTD validation
+     * .nxf.gz/.nxf.xz are decompressed as the reader pulls them
      */
-    reader = xmlReaderForFile(filename, NULL,
+    format = NSFormat(filename);
+    if (NS_PLAIN == format) {
+        reader = xmlReaderForFile(filename, NULL,
                  XML_PARSE_DTDATTR |  /* default DTD attributes */
 		 XML_PARSE_NOENT); /* validate with the DTD */
+    } else {
+        stream = NSOpen(filename, format);
+        reader = (NULL == stream) ? NULL : xmlReaderForIO(NSRead, NSClose, stream, filename, NULL,
+                 XML_PARSE_DTDATTR | XML_PARSE_NOENT);
+    }
     if (reader != NULL) {
         ret = xmlTextReaderRead(reader);
         while (ret == 1) {
             //processNode(reader);
-            printNode(reader);
+            printNode(plan, reader);
             ret = xmlTextReaderRead(reader);
         }
+        if (NULL != stream) {
+            plan->xmlbytes = NSBytes(stream);
+        } else if (0 == stat(filename, &st)) {
+            plan->xmlbytes = st.st_size;
+        }
 	/*
 	 * Once the document has been fully parsed check the validation results
 	 */
-	if (xmlTextReaderIsValid(reader) != 1) {
+	if (plan->verbose && (xmlTextReaderIsValid(reader) != 1)) {
 	    fprintf(stderr, "Document %s does not validate\n", filename);
 	}
         xmlFreeTextReader(reader);
         if (ret != 0) {
             fprintf(stderr, "%s : failed to parse\n", filename);
+            plan->errors++;
         }
     } else {
         fprintf(stderr, "Unable to open %s\n", filename);
+        plan->errors++;
     }
 }
 
-static void usage() {
-	printf("check ADC values \n");
-	return;
-}
-
 void Unexport(int gpionum)
 {
   FILE *fd ;
@@ -773,6 +1041,10 @@ void UnexportALL()
 { 
 	int i = 0;
 
+	if (g_simulate) {
+		return;
+	}
+
 	for (i = 0; i < ARRAY_SIZE(a_domain); i++) {
 		Unexport(a_domain[i]);
 	}
@@ -845,6 +1117,10 @@ void ExportALLOut0()
 {
 	int i = 0;
 
+	if (g_simulate) {
+		return;
+	}
+
 	for (i = 0; i < ARRAY_SIZE(a_domain); i++) {
 		ExportOut0(a_domain[i]);
 	}
@@ -859,6 +1135,10 @@ int writeDomain(unsigned int num, int *domain) {
 	unsigned int temp = num;
 	int i;
     //printf("writeDomain %d\n", num);
+	if (g_simulate) {
+		SimSelect((domain == a_domain) ? 0 : 1, num, ARRAY_SIZE(a_domain));
+		return 0;
+	}
 	for (i = 0; i < ARRAY_SIZE(a_domain); i++) {
 		WritePin(domain[i], temp & 1);
 		temp = temp >> 1;
@@ -866,6 +1146,10 @@ int writeDomain(unsigned int num, int *domain) {
 }
 
 int OpenADC() {
+	if (g_simulate) {
+		return -1;
+	}
+
 	int adc_fd = open(IMX_ADC_DEVICE, 0);
 	if (!adc_fd) {
 	  printf("Error opening %s:  %s\n", IMX_ADC_DEVICE, strerror(errno));
@@ -886,7 +1170,11 @@ int OpenADC() {
 	return adc_fd;
 }
 
-CloseADC(int adc_fd) {
+void CloseADC(int adc_fd) {
+	if (g_simulate) {
+		return;
+	}
+
 	 int err = ioctl(adc_fd, IMX_ADC_DEINIT);
 	  if (err) {
 		printf("Failure.  %d.\n", err);
@@ -903,13 +1191,24 @@ CloseADC(int adc_fd) {
 	adc_fd = -1;
 }
 
-float ReadADC(int adc_fd, int channel) {
+// average the first samples (1-16) results of one conversion
+float ReadADCAvg(int adc_fd, int channel, int samples) {
 	int i, j;
 	int loops = 1;
-	int results_per_loop = 4;
+	int results_per_loop = samples;
 	float sum = 0;
 	int err;
 
+	if (results_per_loop < 1) {
+		results_per_loop = 1;
+	} else if (results_per_loop > 16) {
+		results_per_loop = 16;
+	}
+
+	if (g_simulate) {
+		return SimReadADC(channel, results_per_loop);
+	}
+
 	//printf("starting conversion...\n");
 	for (j = 0; j < loops; j++) {
 	  struct t_adc_convert_param convert_param;
@@ -936,6 +1235,22 @@ float ReadADC(int adc_fd, int channel) {
 	return (sum / results_per_loop);
 }
 
+float ReadADC(int adc_fd, int channel) {
+	return ReadADCAvg(adc_fd, channel, 4);
+}
+
+// wait for the mux and the sense node to settle
+void Settle(int us) {
+	if (us <= 0) {
+		return;
+	}
+	if (g_simulate) {
+		SimDelay(us);
+	} else {
+		usleep(us);
+	}
+}
+
 // 256x256 20 seconds
 float ReadADCAll(int adc_fd) {
 	int i, j;
@@ -1003,16 +1318,16 @@ int SelfTest()
 			#else
 			// 20S
 			sum0 = ReadADCAll(adc_fd);
-			printf("AB[%02d-%02d] ADC0-ADC2=%f\n", testpointsA[i], testpointsB[i], sum0);
+			printf("AB[%02d-%02d] ADC0-ADC2=%f\n", g_plan->testpointsA[i], g_plan->testpointsB[i], sum0);
 			#endif
 		}
 	}
 #else
-	for (i = 0; i < ARRAY_SIZE(testpointsA); i++) {
-		writeDomain(testpointsA[i], a_domain);
-		writeDomain(testpointsB[i], b_domain);
+	for (i = 0; i < ARRAY_SIZE(g_plan->testpointsA); i++) {
+		writeDomain(g_plan->testpointsA[i], a_domain);
+		writeDomain(g_plan->testpointsB[i], b_domain);
 		sum0 = ReadADCAll(adc_fd);
-		printf("AB[%02d-%02d] ADC0-ADC2=%f\n", testpointsA[i], testpointsB[i], sum0);
+		printf("AB[%02d-%02d] ADC0-ADC2=%f\n", g_plan->testpointsA[i], g_plan->testpointsB[i], sum0);
 	}
 #endif
 	UnexportALL();
@@ -1028,645 +1343,3081 @@ int SelfTest()
 	return 0;
 }
 
+static char isDiodeExpect(float expect) {
+	return (expect == ADC_DIODE_CONNVALUE) || (expect == ADC_OPEN_CONNVALUE);
+}
 
-int main(int argc, char **argv) {
-	float resist = 0;
-	float sum0 = 0;
-	float sum1 = 0;
-	int adc_fd = -1;
-	int i = 0;
-	int j = 0;
-	int c = 0;
-	unsigned int pointA, pointB, pointNext;
-	unsigned int pointLeft, pointRight, pointPair;
-	struct stcompoment* pcompoment = NULL;
-
-	printf("ADC test build %s-%s\n", __DATE__, __TIME__);
+static char isOpenExpect(float expect) {
+	return (expect == -1) || (expect == ADC_OPEN_CONNVALUE);
+}
 
-#if 0
-	while ((c = getopt(argc, argv, "ht")) > 0) {
-				   switch (c) {
-				   case 'h':
-						   usage();
-						   break;
-				   default:
-						   usage();
-						   break;
-				   }
+// wires, resistors and opens read the same both ways, diodes do not
+// The builder stores wires and resistors one way only, a reciprocal
+// reading expects the same from both ends.
+static float PairExpect(struct stplan *plan, int i, int j) {
+	if ((-1 == plan->adcarray[i][j]) && !isDiodeExpect(plan->adcarray[j][i])) {
+		return plan->adcarray[j][i];
 	}
+	return plan->adcarray[i][j];
+}
 
+static char isReciprocal(struct stplan *plan, int i, int j) {
+	return !isDiodeExpect(plan->adcarray[i][j]) && !isDiodeExpect(plan->adcarray[j][i]);
+}
 
-	printf("%d\n", optind);
-	c = argc - optind;
-	 if (c > 4 || c < 1)
-			 usage ();
-#endif
-	
-    if (argc != 2) {
-        printf("a.out selftest\n");
-		printf("a.out NXfile.nxf check configfile\n");
-		return -1;
-    }
+static int MeasKey(struct stplan *plan, int i, int j) {
+	int low = (i < j) ? i : j;
+	int high = (i < j) ? j : i;
+	int dir;
 
-	for (i = 0; i < MAXCHANNEL; i++) {
-		g_gpiofd[i] = -1;
+	if (isReciprocal(plan, i, j) || (i == low)) {
+		dir = MEAS_RECIPROCAL;
+	} else {
+		dir = MEAS_REVERSE;
 	}
+	return (high * (high + 1) / 2 + low) * 2 + dir;
+}
 
-	for (i = 0; i < MAXCHANNEL; i++) {
-		for (j = 0; j < MAXCHANNEL; j++) {
-			adcarray[i][j] = -1;
-			readADC0value[i][j] = -1;
-			readADC2value[i][j] = -1;
-		}
+static char isScheduled(struct stplan *plan, int i, int j) {
+	if (i == j) {
+		return 0;
 	}
-
-	for (i = 0; i < MAXCHANNEL; i++) {
-		testpointsA[i] = -1;
-		testpointsB[i] = -1;
-		allUsedpoints[i] = -1;
+	if (plan->retest) {
+		return plan->retestpairs[i][j];
 	}
+	return (plan->testpointsA[i] != -1) && (plan->testpointsB[j] != -1);
+}
 
-	for (i = 0; i < 999; i++) {
-		fixturelist[i].name[0] = '\0';
-		fixturelist[i].id = -1;
+static void AddFail(int i, int j, const char *kind) {
+	g_totalfail++;
+	if (NULL != g_failfile) {
+		fprintf(g_failfile, "%d-%d %s %s %s\n", i, j, kind,
+			g_plan->fixturelist[i].name[0] ? g_plan->fixturelist[i].name : "-",
+			g_plan->fixturelist[j].name[0] ? g_plan->fixturelist[j].name : "-");
 	}
+}
 
-	if (strcmp(argv[1], "selftest") == 0) {
-		printf("perform selftest...\n");
-		SelfTest();
-		return 0;
+// PASS band of the computed resistance for an adcarray value
+static void ExpectLimits(struct stplan *plan, float expect, struct stinstr *in) {
+	in->expect = expect;
+	in->lower = 0;
+	in->upper = 0; // no band: always FAIL
+
+	if (expect == ADC_OPEN_CONNVALUE) {
+		in->verdict = TP_VERDICT_OPEN;
+		in->lower = MAX_RESIST - 1; // only MAX_RESIST itself in float
+		in->upper = MAX_RESIST + 1;
+	} else if (expect == ADC_DIODE_CONNVALUE) {
+		in->verdict = TP_VERDICT_DIODE;
+		in->lower = 0;
+		in->upper = MAX_RESIST;
+	} else if (expect == ADC_DIRECT_CONNVALUE) {
+		in->verdict = TP_VERDICT_DIRECT;
+		in->lower = plan->ContMin;
+		in->upper = plan->ContMax;
+	} else if (expect == -1) {
+		in->verdict = TP_VERDICT_DISCONNECT;
+		in->lower = MAX_RESIST - 1; // only MAX_RESIST itself in float
+		in->upper = MAX_RESIST + 1;
+	} else { // resist
+		in->verdict = TP_VERDICT_RESIST;
+		if ((expect > 0) && (expect < 100)) {
+			in->lower = expect - 5;
+			in->upper = expect + 5;
+		} else if ((expect >= 100) && (expect < 10000)) {
+			in->lower = expect * 0.95;
+			in->upper = expect * 1.05;
+		} else if ((expect >= 10000) && (expect < 50000)) {
+			in->lower = expect * 0.9;
+			in->upper = expect * 1.1;
+		} else if (expect < 0) { // FIXME check the undef connections
+			printf("ADC error! adcarray=%f\n", expect);
+		}
 	}
+}
 
-    /*
-     * this initialize the library and check potential ABI mismatches
-     * between the version it was compiled for and the actual shared
-     * library used.
-     */
-    LIBXML_TEST_VERSION
+struct stcompile {
+	int *slotmap;
+	unsigned char *measured;
+	int slots;
+	int pairs;
+	int reads;
+	int screens;
+	int reused;  // instructions copied from the previous program
+	const struct stxtoptions *options; // two-stage, samples and settle
+};
 
-	if (argc != 2) {
-		streamFile("3.nxf");
-	} else {
-    	streamFile(argv[1]);
+// give the instruction the slot of its reading and append it
+static int EmitPair(struct stplan *plan, struct stprogram *prog, struct stcompile *cc,
+	struct stinstr *in, int key) {
+	if (-1 == cc->slotmap[key]) {
+		cc->slotmap[key] = cc->slots++;
 	}
-    /*
-     * Cleanup function for the XML library.
-     */
-    xmlCleanupParser();
-    /*
-     * this is to debug memory for regression tests
-     */
-    xmlMemoryDump();
+	in->slot = cc->slotmap[key];
 
-	printf("\nfixture list total=%d:\n", totalfixture);
-	for (i = 0; i < 999; i++) {
-		if (fixturelist[i].id != -1)
-		{
-			printf("name=%s point=%d\n", fixturelist[i].name, fixturelist[i].id);
+	if (TP_SCREEN == in->op) {
+		cc->screens++;
+	} else {
+		plan->allUsedpoints[in->muxA] = 1;
+		plan->allUsedpoints[in->muxB] = 1;
+		cc->pairs++;
+		if (!cc->measured[key]) {
+			cc->measured[key] = 1;
+			cc->reads++;
 		}
 	}
+	return TPEmit(prog, in);
+}
 
+// one instruction of the pass for the pair, if scheduled
+static int CompilePair(struct stplan *plan, struct stprogram *prog, struct stcompile *cc,
+	int pass, int i, int j) {
+	struct stinstr in;
+	float expect;
+	int key;
 
-	printf("\nsplice list:\n");
-	for (i = 0; i < totalsplice; i++) {
-		printf("%d %s\n", splicelist[i].id, splicelist[i].name);
+	if (!isScheduled(plan, i, j)) {
+		return 0;
 	}
-
-	printf("comp list:\n");
-	for (i = 0; i < totalcomp; i++) {
-		printf("%d: type=%d id=%d name=%s ", i, complist[i].type, 
-			complist[i].id, complist[i].name);
-			if (complist[i].type == COMP_R) {
-				printf("%f", complist[i].value); 	
-			}
-			printf("\n");
+	key = MeasKey(plan, i, j);
+	expect = PairExpect(plan, i, j);
+	if ((0 == pass) && (!isOpenExpect(expect) || (-1 != cc->slotmap[key]))) {
+		return 0; // screen the expected opens, once per reading
 	}
 
-	pointA = 0;
-	pointB = 0;
-	// TODO Display the open items
-	printf("\nconnection list:\n");
-	for (i = 0; i < totalconnectnum; i++) {
-		printf("%d<->%d \t\tname=%s color=%d\n", connlist[i].pointA,
-			connlist[i].pointB, connlist[i].name, connlist[i].color);
-#if 1
-		pointA = (connlist[i].pointA);
-		pointB = (connlist[i].pointB);
+	memset(&in, 0, sizeof(in));
+	in.muxA = i;
+	in.muxB = j;
+	ExpectLimits(plan, expect, &in);
+
+	if (0 == pass) {
+		in.op = TP_SCREEN;
+		in.accept = TP_LEVEL_SCREEN;
+		in.samples = 1;
+		in.settle_us = 0;
+		in.verdict = TP_VERDICT_NONE;
+	} else {
+		in.op = TP_MEASURE;
+		in.accept = (cc->options->twostage && isOpenExpect(expect)) ?
+			TP_LEVEL_SCREEN : TP_LEVEL_PRECISE;
+		in.samples = cc->options->samples;
+		in.settle_us = cc->options->settle_us;
+	}
+	return EmitPair(plan, prog, cc, &in, key);
+}
 
-		if ((pointA >= 65636) && (pointB >= 65636)) {
-			printf("connection check fail! indirect point[%d-%d]\n", pointA, pointB);
-			return -1;
-		}
-		
-		// for splice find all these points to conencted to the same splice		
-		if ((pointA < 81920) && (pointA >= 65636) && (pointB < 999)) {
-			// pointA is splice
-			if (!inSpliceList(pointA)) {
-				printf("point fail! %d\n", pointA);
-				return -1;
-			}
+// Compile the expectation table into the scan program: the screen pass
+// first when enabled, then one instruction per scheduled pair in mux A
+// order. Reciprocal pairs share a slot, so the executor reads them once.
+// With the program of the previous version of the plan, the pairs of two
+// points not marked in affected are copied from it, only their slots are
+// assigned again.
+static int CompilePlanFrom(struct stplan *plan, struct stprogram *prog,
+	const struct stxtoptions *options, const struct stprogram *old, const unsigned char *affected) {
+	struct stcompile cc;
+	struct stinstr in;
+	int rowstart[2][MAXCHANNEL];
+	int rowend[2][MAXCHANNEL];
+	int pass, key;
+	int i, j, pc;
+
+	TPInit(prog);
+	memset(&cc, 0, sizeof(cc));
+	cc.options = options;
+	cc.slotmap = malloc(MEAS_KEYS * sizeof(int));
+	cc.measured = calloc(MEAS_KEYS, 1);
+	if ((NULL == cc.slotmap) || (NULL == cc.measured)) {
+		printf("plan alloc fail!\n");
+		free(cc.slotmap);
+		free(cc.measured);
+		return -1;
+	}
+	for (key = 0; key < MEAS_KEYS; key++) {
+		cc.slotmap[key] = -1;
+	}
 
-			pointNext = -1;
-			for (j = 0; j < totalconnectnum; j++) {
-				if (connlist[j].pointB == pointA) {
-					pointNext = connlist[j].pointA;
-					//printf("nextpoint=%d\n", pointNext);
-					if (pointNext < 999) {
-						if (adcarray[pointB][pointNext] == ADC_DIRECT_CONNVALUE) {
-							//printf("Skip dup %d-%d\n", pointNext, pointB);
-						} else { adcarray[pointNext][pointB] = ADC_DIRECT_CONNVALUE;}
-					} else {printf("splice warning %d...\n", pointA);}
-					//break;
-				} else if ((connlist[j].pointA == pointA) && (connlist[j].pointB != pointB)) {
-					pointNext = connlist[j].pointB;
-					if (pointNext < 999) {
-						if (adcarray[pointNext][pointB] == ADC_DIRECT_CONNVALUE) {
-							//printf("Skip dup %d-%d\n", pointNext, pointB);
-						} else adcarray[pointB][pointNext] = ADC_DIRECT_CONNVALUE;
-					} else {printf("splice warning %d...\n", pointA);}
-				}  
-			}
+	// the rows of the previous program, screen pass 0 and precision pass 1
+	for (i = 0; i < MAXCHANNEL; i++) {
+		rowstart[0][i] = rowstart[1][i] = rowend[0][i] = rowend[1][i] = 0;
+	}
+	for (pc = 0; (NULL != old) && (pc < old->count); pc++) {
+		pass = (TP_SCREEN == old->code[pc].op) ? 0 : 1;
+		i = old->code[pc].muxA;
+		if (rowstart[pass][i] == rowend[pass][i]) {
+			rowstart[pass][i] = pc;
 		}
+		rowend[pass][i] = pc + 1;
+	}
 
-		if ((pointB < 81920) && (pointB >= 65636) && (pointA < 999)) {
-			// pointB is splice
-			if (!inSpliceList(pointB)) {
-				printf("point fail!\n");
-				return -1;
+	for (pass = options->twostage ? 0 : 1; pass < 2; pass++) {
+		for (i = 0; i < MAXCHANNEL; i++) {
+			if ((NULL == old) || affected[i]) {
+				for (j = 0; j < MAXCHANNEL; j++) {
+					if (CompilePair(plan, prog, &cc, pass, i, j) < 0) {
+						goto fail;
+					}
+				}
+				continue;
 			}
-			pointNext = -1;
-			for (j = 0; j < totalconnectnum; j++) {
-				if (connlist[j].pointA == pointB) {
-					pointNext = connlist[j].pointB;
-					//printf("nextpoint=%d\n", pointNext);
-					if (pointNext < 999) {
-						if (adcarray[pointNext][pointA] == ADC_DIRECT_CONNVALUE) {
-							//printf("Skip dup %d-%d\n", pointNext, pointB);
-						} else adcarray[pointA][pointNext] = ADC_DIRECT_CONNVALUE;
-					} else {printf("splice warning ...\n");}
-					//break;
-				} else if ((connlist[j].pointB == pointB) && (connlist[j].pointA != pointA)) {
-					pointNext = connlist[j].pointA;
-					if (pointNext < 999) {
-						if (adcarray[pointNext][pointA] == ADC_DIRECT_CONNVALUE) {
-							//printf("Skip dup %d-%d\n", pointNext, pointB);
-						} else adcarray[pointA][pointNext] = ADC_DIRECT_CONNVALUE;
-					} else {printf("splice warning ...\n");}
+			pc = rowstart[pass][i];
+			for (j = 0; j < MAXCHANNEL; j++) {
+				while ((pc < rowend[pass][i]) && (old->code[pc].muxB < j)) {
+					pc++;
+				}
+				if (affected[j]) {
+					if (CompilePair(plan, prog, &cc, pass, i, j) < 0) {
+						goto fail;
+					}
+					continue;
+				}
+				for (; (pc < rowend[pass][i]) && (old->code[pc].muxB == j); pc++) {
+					in = old->code[pc];
+					if (EmitPair(plan, prog, &cc, &in, MeasKey(plan, i, j)) < 0) {
+						goto fail;
+					}
+					cc.reused++;
 				}
 			}
 		}
+	}
+	free(cc.slotmap);
+	free(cc.measured);
 
-		if ((pointA < 999) && (pointB < 999)) {
-			printf("Direct %d-%d %f\n", pointA, pointB, adcarray[pointB][pointA]);
-			if (adcarray[pointB][pointA] == ADC_DIRECT_CONNVALUE) {
-				//printf("Skip dup %d-%d\n", pointNext, pointB);
-			} else { 
-				adcarray[pointA][pointB] = ADC_DIRECT_CONNVALUE;
-			}
-		}
+	PLANLOG(plan, "Scan plan: %d pairs, %d hardware reads, %d reads saved, %d screens\n",
+		cc.pairs, cc.reads, cc.pairs - cc.reads, cc.screens);
+	if (NULL != old) {
+		PLANLOG(plan, "Scan plan: %d instructions reused\n", cc.reused);
+	}
+	return prog->count;
 
-		if ((pointA < 999) && (pointB >= 81920)) {
-			//printf("Checking B...\n");
-			// pointB is a compoment, should be input pin=even
-			pointRight = pointLeft = -1;
-			pcompoment = NULL;
-			if ((pointB % 2) != 0) {
-				pointRight = pointB;
-				pointLeft = pointB - 1;
-				//printf("warning pointB connected to outpin %d\n", pointB);
-				pcompoment = FindCompoment(pointB - 1);
-			} else {
-				pointLeft = pointB;
-				pointRight = pointB + 1;
-				pcompoment= FindCompoment(pointB);
-			}
-	
-			if (NULL == pcompoment) {
-				printf("Find compoment fail! pointB=%d\n", pointB);
-				return -1;
-			}
+fail:
+	free(cc.slotmap);
+	free(cc.measured);
+	return -1;
+}
 
-			//printf("Find compoment %d\n", pcompoment->id);
-			
-			if (pcompoment->type == COMP_D) {// pointB is connected to a diode
-				// find all these nodes directly connected to the same
-				for (j = 0; j < totalconnectnum; j++) { 
-					if (connlist[j].pointA == pointB) {
-						pointNext = connlist[j].pointB;
-						//printf("nextpoint=%d\n", pointNext);
-						if (pointNext < 999) {
-							if (adcarray[pointNext][pointA] == ADC_DIRECT_CONNVALUE) {
-								//printf("Skip dup %d-%d\n", pointNext, pointB);
-							} else adcarray[pointA][pointNext] = ADC_DIRECT_CONNVALUE;
-						} else {printf("splice warning ...\n");}
-						//break;
-					} else if ((connlist[j].pointB == pointB) && (connlist[j].pointA != pointA)) {
-						pointNext = connlist[j].pointA;
-						if (pointNext < 999) {
-							if (adcarray[pointNext][pointA] == ADC_DIRECT_CONNVALUE) {
-							//printf("Skip dup %d-%d\n", pointNext, pointB);
-						} else adcarray[pointA][pointNext] = ADC_DIRECT_CONNVALUE;
-						} else {printf("splice warning ...\n");}
-					}
-				}
+static int CompilePlan(struct stplan *plan, struct stprogram *prog,
+	const struct stxtoptions *options) {
+	return CompilePlanFrom(plan, prog, options, NULL, NULL);
+}
 
-				// find the other node of the diode
-				if ((pointB % 2) == 0) {// diode input pin
-					pointPair = pointB + 1;
-					for (j = 0; j < totalconnectnum; j++) {
-						if (connlist[j].pointA == pointPair) {
-							pointNext = connlist[j].pointB;
-							if (pointNext < 999) {		
-								adcarray[pointA][pointNext] = ADC_DIODE_CONNVALUE;
-								adcarray[pointNext][pointA] = ADC_OPEN_CONNVALUE;
-							} else {printf("splice warning ...\n");}		
-						} else if ((connlist[j].pointB == pointPair) && (connlist[j].pointA != pointA)) {
-							pointNext = connlist[j].pointA;
-							if (pointNext < 999) {
-								adcarray[pointA][pointNext] = ADC_DIODE_CONNVALUE;
-								adcarray[pointNext][pointA] = ADC_OPEN_CONNVALUE;
-							} else {printf("splice warning ...\n");}
-						}
-					}					
-				} else {// diode output
-					pointPair = pointB - 1;
-					for (j = 0; j < totalconnectnum; j++) {
-						if (connlist[j].pointA == pointPair) {
-							pointNext = connlist[j].pointB;
-							if (pointNext < 999) {		
-								adcarray[pointA][pointNext] = ADC_OPEN_CONNVALUE;
-								adcarray[pointNext][pointA] = ADC_DIODE_CONNVALUE;
-							} else {printf("splice warning ...\n");}		
-						} else if ((connlist[j].pointB == pointPair) && (connlist[j].pointA != pointA)) {
-							pointNext = connlist[j].pointA;
-							if (pointNext < 999) {
-								adcarray[pointA][pointNext] = ADC_OPEN_CONNVALUE;
-								adcarray[pointNext][pointA] = ADC_DIODE_CONNVALUE;
-							} else {printf("splice warning ...\n");}
-						}
-					}
-				}
-			}
-			else if (pcompoment->type == COMP_R) {// pointB is connected to resistor
-				pointNext = -1;
-				// find all these nodes directly connected to the resistor
-				for (j = 0; j < totalconnectnum; j++) { 
-					if (connlist[j].pointA == pointB) {
-						pointNext = connlist[j].pointB;
-						//printf("nextpoint=%d\n", pointNext);
-						if (pointNext < 999) {
-							if (adcarray[pointNext][pointA] == ADC_DIRECT_CONNVALUE) {
-							//printf("Skip dup %d-%d\n", pointNext, pointB);
-						} else adcarray[pointA][pointNext] = ADC_DIRECT_CONNVALUE;
-						} else {printf("splice warning ...\n");}
-						//break;
-					} else if ((connlist[j].pointB == pointB) && (connlist[j].pointA != pointA)) {
-						pointNext = connlist[j].pointA;
-						if (pointNext < 999) {
-							if (adcarray[pointNext][pointA] == ADC_DIRECT_CONNVALUE) {
-								//printf("Skip dup %d-%d\n", pointNext, pointB);
-							} else 	adcarray[pointA][pointNext] = ADC_DIRECT_CONNVALUE;
-						} else {printf("splice warning ...\n");}
-					}
-				}
+static void ScanSelect(int domain, unsigned int num) {
+	unsigned long long start = NowNs();
 
-				// find the other node of the resistor
-				if ((pointB % 2) == 0) {
-					pointPair = pointB + 1;
-				} else {
-					pointPair = pointB - 1;
-				}
+	writeDomain(num, domain ? b_domain : a_domain);
+	g_switchns = NowNs();
+	g_switched = 1;
+	HistoAdd(&g_phase[PHASE_GPIO], g_switchns - start);
+}
 
-				pointNext = -1;
-				for (j = 0; j < totalconnectnum; j++) {
-					if (connlist[j].pointA == pointPair) {
-						pointNext = connlist[j].pointB;
-						if (pointNext < 999) {
-							if (adcarray[pointNext][pointA] == pcompoment->value) {
-								//printf("Skip dup %d-%d\n", pointNext, pointB);
-							} else adcarray[pointA][pointNext] = pcompoment->value;
-						} else {printf("splice warning 2...\n");}		
-					} else if ((connlist[j].pointB == pointPair) && (connlist[j].pointA != pointA)) {
-						pointNext = connlist[j].pointA;
-						if (pointNext < 999) {
-							if (adcarray[pointNext][pointA] == pcompoment->value) {
-								//printf("Skip dup %d-%d\n", pointNext, pointB);
-							} else adcarray[pointA][pointNext] = pcompoment->value;
-						} else {printf("splice warning 3...\n");}
-					}
-				}
-			} else {
-				printf("connection unsupport fail!\n");	
-			}
-			
-			if (pointNext < 999) {
-			} else {
-				printf("Resistor1 fail %d\n", pointNext);
-			}
-		}
+static void ScanSettle(int us) {
+	unsigned long long start = NowNs();
 
-		if ((pointB < 999) && (pointA >= 81920)) {
-			//printf("Checking A...\n");
-			// pointA is a compoment, should be input pin=even
-			pointRight = pointLeft = -1;
-			pcompoment = NULL;
-			if ((pointA % 2) != 0) {
-				pointRight = pointA;
-				pointLeft = pointA - 1;
-				//printf("warning pointA connected to outpin %d\n", pointA);
-				pcompoment = FindCompoment(pointA - 1);
-			} else {
-				pointLeft = pointA;
-				pointRight = pointA + 1;
-				pcompoment= FindCompoment(pointA);
-			}
-	
-			if (NULL == pcompoment) {
-				printf("Find compoment fail! pointA=%d\n", pointA);
-				return -1;
-			}
+	Settle(us);
+	HistoAdd(&g_phase[PHASE_SETTLE], NowNs() - start);
+}
 
-			//printf("find compoment id=%d\n", pcompoment->id);
-			
-			if (pcompoment->type == COMP_D) {// pointA=diode pin
-				// find all these nodes directly connected to the same
-				for (j = 0; j < totalconnectnum; j++) {
-					if (connlist[j].pointB == pointA) {
-						pointNext = connlist[j].pointA;
-						//printf("nextpoint=%d\n", pointNext);
-						if (pointNext < 999) {
-							if (adcarray[pointNext][pointB] == ADC_DIRECT_CONNVALUE) {
-								//printf("Skip dup %d-%d\n", pointNext, pointB);
-							} else adcarray[pointB][pointNext] = ADC_DIRECT_CONNVALUE;
-						} else {printf("splice warning D1...\n");}
-						//break;
-					} else if ((connlist[j].pointA == pointA) && (connlist[j].pointB != pointB)) {
-						pointNext = connlist[j].pointB;
-						if (pointNext < 999) {
-							if (adcarray[pointNext][pointB] == ADC_DIRECT_CONNVALUE) {
-								//printf("Skip dup %d-%d\n", pointNext, pointB);
-							} else adcarray[pointB][pointNext] = ADC_DIRECT_CONNVALUE;
-						} else {printf("splice warning D2...\n");}
-					}
-				}
+static float ScanRead(int channel, int samples) {
+	unsigned long long start = NowNs();
+	float value;
 
-				// find the other node of the diode
-				if ((pointA % 2) == 0) {// pontA=diode input pin
-					//printf("PointA is diode in...\n");
-					pointPair = pointA + 1;
-					for (j = 0; j < totalconnectnum; j++) {
-						if (connlist[j].pointB == pointPair) {
-							pointNext = connlist[j].pointA;
-							//printf("Din=%d\n", pointNext);
-							if (pointNext < 999) {		
-								adcarray[pointB][pointNext] = ADC_DIODE_CONNVALUE;
-								adcarray[pointNext][pointB] = ADC_OPEN_CONNVALUE;
-							} else {printf("splice warning D3...\n");}		
-						} else if ((connlist[j].pointA == pointPair) && (connlist[j].pointB != pointB)) {
-							pointNext = connlist[j].pointB;
-							if (pointNext < 999) {
-								adcarray[pointB][pointNext] = ADC_DIODE_CONNVALUE;
-								adcarray[pointNext][pointB] = ADC_OPEN_CONNVALUE;
-							} else {printf("splice warning D4...\n");}
-						}
-					}					
-				} else {// diode output
-					pointPair = pointA - 1; // PointA=Diode output
-					for (j = 0; j < totalconnectnum; j++) {
-						if (connlist[j].pointB == pointPair) {
-							pointNext = connlist[j].pointA;
-							//printf("Dout=%d\n", pointNext);
-							if (pointNext < 999) {		
-								adcarray[pointB][pointNext] = ADC_OPEN_CONNVALUE;
-								adcarray[pointNext][pointB] = ADC_DIODE_CONNVALUE;
-							} else {printf("splice warning D5...\n");}		
-						} else if ((connlist[j].pointA == pointPair) && (connlist[j].pointB != pointB)) {
-							pointNext = connlist[j].pointB;
-							if (pointNext < 999) {
-								adcarray[pointB][pointNext] = ADC_OPEN_CONNVALUE;
-								adcarray[pointNext][pointB] = ADC_DIODE_CONNVALUE;
-							} else {printf("splice warning D6...\n");}
-						}
-					}
-				}
-			}
-			else if (pcompoment->type == COMP_R) {// pointA is a resistor pin
-				pointNext = -1;
-				// find all these nodes directly connected to the resistor
-				for (j = 0; j < totalconnectnum; j++) {
-					if (connlist[j].pointB == pointA) {
-						pointNext = connlist[j].pointA;
-						//printf("nextpoint=%d\n", pointNext);
-						if (pointNext < 999) {
-							if (pointNext == pointB) {
-								printf("R warning loop ... \n");
-							}
-							if (adcarray[pointNext][pointB] == ADC_DIRECT_CONNVALUE) {
-								//printf("Skip dup %d-%d\n", pointNext, pointB);
-							} else adcarray[pointB][pointNext] = ADC_DIRECT_CONNVALUE;
-						} else {printf("R warning1 ...\n");}
-					} else if ((connlist[j].pointA == pointA) && (connlist[j].pointB != pointB)) {
-						pointNext = connlist[j].pointB;
-						if (pointNext < 999) {
-							if (adcarray[pointNext][pointB] == ADC_DIRECT_CONNVALUE) {
-								//printf("Skip dup %d-%d\n", pointNext, pointB);
-							} else adcarray[pointB][pointNext] = ADC_DIRECT_CONNVALUE;
-						} else {printf("R warning2 ...\n");}
-					}
-				}
+	if (g_switched) {
+		HistoAdd(&g_jitter, start - g_switchns);
+		g_switched = 0;
+	}
+	value = ReadADCAvg(g_adcfd, channel, samples);
+	HistoAdd(&g_phase[PHASE_ADC], NowNs() - start);
+	return value;
+}
 
-				// find the other node of the resistor
-				if ((pointA % 2) == 0) {
-					pointPair = pointA + 1;
-				} else {
-					pointPair = pointA - 1;
-				}
+static float ScanResist(float adc0, float adc2) {
+	unsigned long long start = NowNs();
+	float resist;
 
-				pointNext = -1;
-				for (j = 0; j < totalconnectnum; j++) {
-					if (connlist[j].pointA == pointPair) {
-						pointNext = connlist[j].pointB;
-						if (pointNext < 999) {
-							if (pointNext == pointB) { printf("resistor warning loop ...\n");}
-							if (adcarray[pointNext][pointB] == pcompoment->value) {
-								//printf("Skip dup %d-%d\n", pointNext, pointB);
-							} else adcarray[pointB][pointNext] = pcompoment->value;
-						} else {printf("splice warning R5...\n");}		
-					} else if ((connlist[j].pointB == pointPair)) {
-						pointNext = connlist[j].pointA;
-						if (pointNext < 999) {
-							if (pointNext == pointB) { printf("resistor warning loop ...\n");}
-							if (adcarray[pointNext][pointB] == pcompoment->value) {
-								//printf("Skip dup %d-%d\n", pointNext, pointB);
-							} else adcarray[pointB][pointNext] = pcompoment->value;
-						} else {printf("splice warning R6...\n");}
-					}
-				}
-			} else {
-				printf("connection unsupport fail!\n");	
-			}
-		}	
-	#endif	
-		// 81920 = first compoment ; 65636= first splice	
+	resist = GetResist(adc0, adc2);
+	HistoAdd(&g_phase[PHASE_RESIST], NowNs() - start);
+	return resist;
+}
+
+static void PhaseDump(FILE *fp) {
+	unsigned long long total = g_scanns;
+	unsigned long long timed = 0;
+	int i;
+
+	if (g_scanstart) {
+		total += NowNs() - g_scanstart;
+	}
+	if (0 == total) {
+		return;
 	}
 
-	printf("\nADC check table:\n");
-	for (i = 0; i < MAXCHANNEL; i++) {
-		for (j = 0; j < MAXCHANNEL; j++) {
-			if (-1 != adcarray[i][j]) {
-				printf("adcarray[%d-%d]=%fohm\n", i, j, adcarray[i][j]);
-				testpointsA[i] = 1;
-				testpointsB[j] = 1;
-			}
-		}
+	fprintf(fp, "Scan phases, %.1f ms in the scan loop:\n", total / 1e6);
+	for (i = 0; i < PHASE_MAX; i++) {
+		HistoPrint(&g_phase[i], phasenames[i], fp);
 	}
+	HistoPrint(&g_jitter, "switch-to-sample", fp);
+	for (i = 0; i < PHASE_MAX; i++) {
+		fprintf(fp, "%s %.1f%%, ", phasenames[i], 100.0 * g_phase[i].sum / total);
+		timed += g_phase[i].sum;
+	}
+	fprintf(fp, "other %.1f%%\n", (timed < total) ? 100.0 * (total - timed) / total : 0.0);
+	fflush(fp);
+}
 
-	printf("\nTest point A list:\n");
-	for (i = 0; i < MAXCHANNEL; i++) {
-		if (testpointsA[i] != -1) {
-			printf("%d[name=%s] ", i, fixturelist[i].name);
-		}
+// print the verdict of one pair in the scan log format
+static void PrintPair(const struct stinstr *in, float adc0, float adc2, float resist, int pass) {
+	int i = in->muxA;
+	int j = in->muxB;
+
+	g_totaltested++;
+	SCANLOG("AB[%d-%d] adcarray=%f ADC0=%f ADC2=%f R=%f\n", 
+		i, j, in->expect, adc0, adc2, resist);
+
+	if (!pass) {
+		AddFail(i, j, TPVerdictName(in->verdict));
+	} else if (g_quiet) {
+		return;
 	}
 
-	printf("\nTest point B list:\n");
-	for (i = 0; i < MAXCHANNEL; i++) {
-		if (testpointsB[i] != -1) {
-			printf("%d[name=%s] ", i, fixturelist[i].name);
+	switch (in->verdict) {
+	case TP_VERDICT_OPEN:
+		if (pass) {
+			printf("***open %d-%d PASS!\n", i, j);
+		} else {
+			printf("***open %d-%d FAIL! %f\n", i, j, resist);
 		}
-	}	
-	
-	printf("\n");
-#if 1
-	printf("\nStart ADC...\n");
-
-	ExportALLOut0();
-	adc_fd = OpenADC();
-	
-   	// check all these points in testpointA/B
-	for (i = 0; i < MAXCHANNEL; i++) {	
-		if (testpointsA[i] == -1) {// skip unused points in group A
-	   		continue;
-		}
-		allUsedpoints[i] = 1;
-	   	writeDomain(i, a_domain);
-	   	for (j = 0; j < MAXCHANNEL; j++) {
-	   		if (i == j) {continue; } // skip self-test
-			if (testpointsB[j] == -1) { // skip unused points in group B 
+		break;
+	case TP_VERDICT_RESIST:
+		printf("***resist %d-%d %s %f==%f\n", i, j, pass ? "PASS" : "FAIL",
+			in->expect, resist);
+		break;
+	default:
+		printf("***%s %d-%d %s %f\n", TPVerdictName(in->verdict), i, j,
+			pass ? "PASS" : "FAIL", resist);
+		break;
+	}
+}
+
+// hand the pair to the library caller, after PrintPair counted it
+static void EngineReport(const struct stinstr *in, float adc0, float adc2, float resist, int pass) {
+	const struct stxtcallbacks *cb = &g_engine->callbacks;
+	struct stresult result;
+
+	if (NULL != cb->result) {
+		result.pointA = in->muxA;
+		result.pointB = in->muxB;
+		result.verdict = in->verdict;
+		result.pass = pass;
+		result.reserved = 0;
+		result.expect = in->expect;
+		result.adc0 = adc0;
+		result.adc2 = adc2;
+		result.resist = resist;
+		cb->result(cb->arg, &result);
+	}
+	if ((NULL != cb->progress) && (0 == g_totaltested % XT_PROGRESS_PAIRS)) {
+		cb->progress(cb->arg, g_totaltested, g_engine->pairs, g_totalfail);
+	}
+}
+
+static int ScanCancelled() {
+	return (NULL != g_engine) && __atomic_load_n(&g_engine->cancel, __ATOMIC_RELAXED);
+}
+
+static void ReportPair(const struct stinstr *in, float adc0, float adc2, float resist, int pass) {
+	unsigned long long start = NowNs();
+	struct stresult result;
+
+	if (NULL != g_resultsink) {
+		result.pointA = in->muxA;
+		result.pointB = in->muxB;
+		result.verdict = in->verdict;
+		result.pass = pass;
+		result.reserved = 0;
+		result.expect = in->expect;
+		result.adc0 = adc0;
+		result.adc2 = adc2;
+		result.resist = resist;
+		RSWrite(g_resultsink, &result);
+	}
+	if (NULL != g_history) {
+		struct sthsrow row;
+
+		row.pointA = in->muxA;
+		row.pointB = in->muxB;
+		row.verdict = in->verdict;
+		row.pass = pass;
+		row.expect = in->expect;
+		row.adc0 = adc0;
+		row.adc2 = adc2;
+		row.resist = resist;
+		HSAppend(g_history, &row);
+	}
+	if (NULL != g_live) {
+		LSPair(g_live, in->muxA, in->muxB, in->verdict, pass, in->expect, resist);
+	}
+	if (NULL != g_fb) {
+		FBPair(g_fb, in->muxA, in->muxB, g_plan->fixturelist[in->muxA].name,
+			g_plan->fixturelist[in->muxB].name, TPVerdictName(in->verdict), pass);
+	}
+	PrintPair(in, adc0, adc2, resist, pass);
+	if (NULL != g_engine) {
+		EngineReport(in, adc0, adc2, resist, pass);
+	}
+	HistoAdd(&g_phase[PHASE_REPORT], NowNs() - start);
+
+	if (g_phasedump) {
+		g_phasedump = 0;
+		PhaseDump(stderr);
+	}
+}
+
+static const struct sthwops scanops = {
+	ScanSelect,
+	ScanRead,
+	ScanSettle,
+	ScanResist,
+	ReportPair,
+	ScanCancelled,
+};
+
+static int ScanPlan(const struct stprogram *prog, int adc_fd, struct sttpstats *stats) {
+	int ret;
+
+	g_adcfd = adc_fd;
+	g_scanstart = NowNs();
+	ret = TPExecute(prog, &scanops, stats);
+	g_scanns += NowNs() - g_scanstart;
+	g_scanstart = 0;
+	return ret;
+}
+
+struct stscanjob {
+	const struct stprogram *prog;
+	int adc_fd;
+	struct sttpstats *stats;
+	int ret;
+};
+
+// the simulated harness is the golden one described by the plan
+static float ExpectToResist(float expect) {
+	if (isOpenExpect(expect)) {
+		return SIM_OPEN;
+	}
+	if (expect == ADC_DIRECT_CONNVALUE) {
+		return 0.2; // wire
+	}
+	if (expect == ADC_DIODE_CONNVALUE) {
+		return 1500; // forward biased diode
+	}
+	return expect;
+}
+
+static void SimLoadPlan(struct stplan *plan) {
+	int i, j;
+
+	SimInit(MAXCHANNEL, &g_simlatency, 1);
+	for (i = 0; i < MAXCHANNEL; i++) {
+		for (j = 0; j < MAXCHANNEL; j++) {
+			SimSetResist(i, j, ExpectToResist(PairExpect(plan, i, j)));
+		}
+	}
+}
+
+// a plan loaded with -p has no netlist: the golden harness is the one
+// its measurements expect
+static void SimLoadProgram(const struct stprogram *prog) {
+	int pc;
+
+	SimInit(MAXCHANNEL, &g_simlatency, 1);
+	for (pc = 0; pc < prog->count; pc++) {
+		SimSetResist(prog->code[pc].muxA, prog->code[pc].muxB, ExpectToResist(prog->code[pc].expect));
+	}
+}
+
+// load the truth written by nxfgen -e: "pointA pointB verdict value" per
+// connected pair, every other pair is open
+static int SimLoadExpect(const char *filename) {
+	char line[128];
+	char verdict[32];
+	unsigned int pointA, pointB;
+	float value;
+	FILE *fp;
+	int pairs = 0;
+
+	fp = fopen(filename, "r");
+	if (NULL == fp) {
+		printf("Open expect %s fail! %s\n", filename, strerror(errno));
+		return -1;
+	}
+
+	SimInit(MAXCHANNEL, &g_simlatency, 1);
+	while (fgets(line, sizeof(line), fp)) {
+		if (4 != sscanf(line, "%u %u %31s %f", &pointA, &pointB, verdict, &value)) {
+			continue;
+		}
+		if (0 == strcmp(verdict, TPVerdictName(TP_VERDICT_DIRECT))) {
+			SimSetResist(pointA, pointB, ExpectToResist(ADC_DIRECT_CONNVALUE));
+		} else if (0 == strcmp(verdict, TPVerdictName(TP_VERDICT_DIODE))) {
+			SimSetResist(pointA, pointB, ExpectToResist(ADC_DIODE_CONNVALUE));
+		} else if (0 == strcmp(verdict, TPVerdictName(TP_VERDICT_RESIST))) {
+			SimSetResist(pointA, pointB, value);
+		} else {
+			SimSetResist(pointA, pointB, SIM_OPEN);
+		}
+		pairs++;
+	}
+	fclose(fp);
+	printf("Load expect %s: %d pairs\n", filename, pairs);
+	return 0;
+}
+
+static void AddBenchConnection(struct stplan *plan, unsigned int pointA, unsigned int pointB) {
+	plan->connlist[plan->totalconnectnum].pointA = pointA;
+	plan->connlist[plan->totalconnectnum].pointB = pointB;
+	sprintf(plan->connlist[plan->totalconnectnum].name, "W%d", plan->totalconnectnum + 1);
+	plan->connlist[plan->totalconnectnum].color = 0;
+	plan->totalconnectnum++;
+}
+
+static void AddBenchFixture(struct stplan *plan, unsigned int point) {
+	plan->fixturelist[point].id = point;
+	sprintf(plan->fixturelist[point].name, "BENCH-P%d", point);
+	plan->totalfixture++;
+}
+
+// Synthetic harness for the scan benchmark, in place of the NXF parse:
+// splice nets of three points, point-to-point wires, resistors and diodes
+// until the requested number of wires is reached.
+static void BuildBenchHarness(struct stplan *plan, int wires) {
+	struct stcompoment *pcompoment;
+	unsigned int point = 0;
+	unsigned int id;
+	int net = 0;
+	int i;
+
+	plan->ContMin = -5;
+	plan->ContMax = 5;
+
+	while ((plan->totalconnectnum + 3 <= wires) && (point + 3 <= MAXCHANNEL)) {
+		switch (net % 10) {
+		case 6:
+		case 7: // point to point
+			AddBenchConnection(plan, point, point + 1);
+			for (i = 0; i < 2; i++) {
+				AddBenchFixture(plan, point++);
+			}
+			break;
+		case 8:
+		case 9: // resistor or diode, pin id+0 is the input
+			id = 81920 + 2 * plan->totalcomp;
+			pcompoment = &plan->complist[plan->totalcomp++];
+			pcompoment->id = id;
+			if (net % 10 == 8) {
+				pcompoment->type = COMP_R;
+				pcompoment->value = 1000 * (1 + (net / 10) % 5);
+				pcompoment->tolerance = 5;
+				sprintf(pcompoment->name, "R%d", plan->totalcomp);
+			} else {
+				pcompoment->type = COMP_D;
+				pcompoment->value = 0;
+				pcompoment->tolerance = 90;
+				sprintf(pcompoment->name, "D%d", plan->totalcomp);
+			}
+			AddBenchConnection(plan, point, id);
+			AddBenchConnection(plan, id + 1, point + 1);
+			for (i = 0; i < 2; i++) {
+				AddBenchFixture(plan, point++);
+			}
+			break;
+		default: // splice of three wires
+			id = 65636 + plan->totalsplice;
+			plan->splicelist[plan->totalsplice].id = id;
+			sprintf(plan->splicelist[plan->totalsplice].name, "S%d", plan->totalsplice + 1);
+			plan->totalsplice++;
+			AddBenchConnection(plan, point, id);
+			AddBenchConnection(plan, id, point + 1);
+			AddBenchConnection(plan, id, point + 2);
+			for (i = 0; i < 3; i++) {
+				AddBenchFixture(plan, point++);
+			}
+			break;
+		}
+		net++;
+	}
+	printf("bench harness: %d wires, %d points, %d splices, %d compoments\n",
+		plan->totalconnectnum, point, plan->totalsplice, plan->totalcomp);
+}
+
+// forget the parsed NXF before parsing the next one
+static void ResetNetlist(struct stplan *plan) {
+	int i;
+
+	plan->errors = 0;
+	plan->totalconnectnum = 0;
+	plan->totalcomp = 0;
+	plan->totalsplice = 0;
+	plan->totalfixture = 0;
+	plan->GetConnection = plan->GetComp = plan->GetSplice = plan->GetFixture = 0;
+	plan->GetCont = plan->GetShort = 0;
+	plan->ContMin = plan->ContMax = plan->ShortMin = plan->ShortMax = 0;
+	plan->ContisUsed = plan->ShortisUsed = 0;
+	plan->fixturename[0] = '\0';
+
+	for (i = 0; i < 999; i++) {
+		plan->fixturelist[i].name[0] = '\0';
+		plan->fixturelist[i].id = -1;
+	}
+}
+
+static void ResetExpect(struct stplan *plan) {
+	int i, j;
+
+	for (i = 0; i < MAXCHANNEL; i++) {
+		for (j = 0; j < MAXCHANNEL; j++) {
+			plan->adcarray[i][j] = -1;
+		}
+	}
+
+	for (i = 0; i < MAXCHANNEL; i++) {
+		plan->testpointsA[i] = -1;
+		plan->testpointsB[i] = -1;
+		plan->allUsedpoints[i] = -1;
+	}
+	plan->retest = 0;
+}
+
+static struct stplan *NewPlan(const char *filename, int verbose) {
+	struct stplan *plan;
+
+	plan = calloc(1, sizeof(*plan));
+	if (NULL == plan) {
+		printf("plan alloc fail!\n");
+		return NULL;
+	}
+	plan->filename = filename;
+	plan->verbose = verbose;
+	ResetNetlist(plan);
+	ResetExpect(plan);
+	return plan;
+}
+
+// name the pairs across every resistor and diode in the history, so a
+// query can ask for "R1" instead of the points
+static void LabelCompoments(struct stplan *plan, struct sthistory *hs) {
+	unsigned int pointA, pointB;
+	int i, j, k;
+
+	for (i = 0; i < plan->totalcomp; i++) {
+		for (j = 0; j < plan->totalconnectnum; j++) {
+			pointA = (plan->connlist[j].pointA == plan->complist[i].id) ? plan->connlist[j].pointB :
+				(plan->connlist[j].pointB == plan->complist[i].id) ? plan->connlist[j].pointA : -1;
+			if (pointA >= MAXCHANNEL) {
 				continue;
 			}
-			allUsedpoints[j] = 1;
-			
-			if ((adcarray[i][j] == ADC_DIODE_CONNVALUE)
-				|| (adcarray[i][j] == ADC_OPEN_CONNVALUE)) {// need to rad adc[ij] and adc[ji]
-				printf("Diode adcarray[%d-%d]=%f...\n", i, j, adcarray[i][j]);
-			} else if ((adcarray[i][j] == ADC_DIRECT_CONNVALUE)
-				|| (adcarray[i][j] == -1) ||
-				((adcarray[i][j] > 0))) {//direct/undef/resist
-					printf("adcarray[%d-%d]=%f\n", i, j, adcarray[i][j]);
-					if (-1 != readADC0value[j][i]) {
-						printf("resist/short/undef skip %d-%d read=%f\n", i, j, readADC0value[j][i]);
-						readADC0value[i][j] = readADC0value[j][i];
-						readADC2value[i][j] = readADC2value[j][i];
-					} else { //
-						printf("No ADC value!\n");
-					}
+			for (k = 0; k < plan->totalconnectnum; k++) {
+				pointB = (plan->connlist[k].pointA == plan->complist[i].id + 1) ? plan->connlist[k].pointB :
+					(plan->connlist[k].pointB == plan->complist[i].id + 1) ? plan->connlist[k].pointA : -1;
+				if (pointB >= MAXCHANNEL) {
+					continue;
+				}
+				HSLabel(hs, plan->complist[i].name, pointA, pointB);
+				HSLabel(hs, plan->complist[i].name, pointB, pointA);
+			}
+		}
+	}
+}
+
+// parse the NXF file, or build the synthetic bench harness
+// libxml2 is initialized once by main, ParsePlan() may run on any thread
+static int ParsePlan(struct stplan *plan, const char *filename) {
+	int i;
+
+	if (strcmp(filename, "bench") == 0) {
+		PLANLOG(plan, "perform scan bench...\n");
+		BuildBenchHarness(plan, 200);
+	} else {
+		streamFile(plan, filename);
+	}
+
+	PLANLOG(plan, "\nfixture list total=%d:\n", plan->totalfixture);
+	for (i = 0; i < 999; i++) {
+		if (plan->fixturelist[i].id != -1)
+		{
+			PLANLOG(plan, "name=%s point=%d\n", plan->fixturelist[i].name, plan->fixturelist[i].id);
+		}
+	}
+
+
+	PLANLOG(plan, "\nsplice list:\n");
+	for (i = 0; i < plan->totalsplice; i++) {
+		PLANLOG(plan, "%d %s\n", plan->splicelist[i].id, plan->splicelist[i].name);
+	}
+
+	PLANLOG(plan, "comp list:\n");
+	for (i = 0; i < plan->totalcomp; i++) {
+		PLANLOG(plan, "%d: type=%d id=%d name=%s ", i, plan->complist[i].type, 
+			plan->complist[i].id, plan->complist[i].name);
+			if (plan->complist[i].type == COMP_R) {
+				PLANLOG(plan, "%f", plan->complist[i].value); 	
+			}
+			PLANLOG(plan, "\n");
+	}
+	return plan->errors ? -1 : 0;
+}
+
+// Write the adcarray entries of one connection: the points joined to it
+// through its splice or compoment
+static int BuildConnection(struct stplan *plan, int i) {
+	int j = 0;
+	unsigned int pointA, pointB, pointNext;
+	unsigned int pointLeft, pointRight, pointPair;
+	struct stcompoment* pcompoment = NULL;
+
+	PLANLOG(plan, "%d<->%d \t\tname=%s color=%d\n", plan->connlist[i].pointA,
+		plan->connlist[i].pointB, plan->connlist[i].name, plan->connlist[i].color);
+#if 1
+	pointA = (plan->connlist[i].pointA);
+	pointB = (plan->connlist[i].pointB);
+
+	if ((pointA >= 65636) && (pointB >= 65636)) {
+		PlanError(plan, "connection check fail! indirect point[%d-%d]\n", pointA, pointB);
+		return -1;
+	}
+	
+	// for splice find all these points to conencted to the same splice		
+	if ((pointA < 81920) && (pointA >= 65636) && (pointB < 999)) {
+		// pointA is splice
+		if (!inSpliceList(plan, pointA)) {
+			PlanError(plan, "point fail! %d\n", pointA);
+			return -1;
+		}
+
+		pointNext = -1;
+		for (j = 0; j < plan->totalconnectnum; j++) {
+			if (plan->connlist[j].pointB == pointA) {
+				pointNext = plan->connlist[j].pointA;
+				//printf("nextpoint=%d\n", pointNext);
+				if (pointNext < 999) {
+					if (plan->adcarray[pointB][pointNext] == ADC_DIRECT_CONNVALUE) {
+						//printf("Skip dup %d-%d\n", pointNext, pointB);
+					} else { plan->adcarray[pointNext][pointB] = ADC_DIRECT_CONNVALUE;}
+				} else {PLANLOG(plan, "splice warning %d...\n", pointA);}
+				//break;
+			} else if ((plan->connlist[j].pointA == pointA) && (plan->connlist[j].pointB != pointB)) {
+				pointNext = plan->connlist[j].pointB;
+				if (pointNext < 999) {
+					if (plan->adcarray[pointNext][pointB] == ADC_DIRECT_CONNVALUE) {
+						//printf("Skip dup %d-%d\n", pointNext, pointB);
+					} else plan->adcarray[pointB][pointNext] = ADC_DIRECT_CONNVALUE;
+				} else {PLANLOG(plan, "splice warning %d...\n", pointA);}
 			}  
-			else { // FIXME check the undef connections(adcarray=4095)
-				printf("ADC error! adcarray[%d-%d]=%f\n", i, j, adcarray[i][j]);
-			} 
+		}
+	}
 
-			if (readADC0value[i][j] == -1) { // no adc value
-				writeDomain(j, b_domain);
-				sum0 = ReadADC(adc_fd, 0);
-				sum1 = ReadADC(adc_fd, 2);
-				readADC0value[i][j] = sum0;
-				readADC2value[i][j] = sum1;
-				printf("Read %d-%d ADC0=%f ADC2=%f\n", i, j, sum0, sum1);
+	if ((pointB < 81920) && (pointB >= 65636) && (pointA < 999)) {
+		// pointB is splice
+		if (!inSpliceList(plan, pointB)) {
+			PlanError(plan, "point fail!\n");
+			return -1;
+		}
+		pointNext = -1;
+		for (j = 0; j < plan->totalconnectnum; j++) {
+			if (plan->connlist[j].pointA == pointB) {
+				pointNext = plan->connlist[j].pointB;
+				//printf("nextpoint=%d\n", pointNext);
+				if (pointNext < 999) {
+					if (plan->adcarray[pointNext][pointA] == ADC_DIRECT_CONNVALUE) {
+						//printf("Skip dup %d-%d\n", pointNext, pointB);
+					} else plan->adcarray[pointA][pointNext] = ADC_DIRECT_CONNVALUE;
+				} else {PLANLOG(plan, "splice warning ...\n");}
+				//break;
+			} else if ((plan->connlist[j].pointB == pointB) && (plan->connlist[j].pointA != pointA)) {
+				pointNext = plan->connlist[j].pointA;
+				if (pointNext < 999) {
+					if (plan->adcarray[pointNext][pointA] == ADC_DIRECT_CONNVALUE) {
+						//printf("Skip dup %d-%d\n", pointNext, pointB);
+					} else plan->adcarray[pointA][pointNext] = ADC_DIRECT_CONNVALUE;
+				} else {PLANLOG(plan, "splice warning ...\n");}
 			}
-			//compar with adcarray
-			//if ( i == j)
-			resist = GetResist(readADC0value[i][j], readADC2value[i][j]);
-			printf("AB[%d-%d] adcarray=%f ADC0=%f ADC2=%f R=%f\n", 
-				i, j, adcarray[i][j], readADC0value[i][j], readADC2value[i][j], resist);
-			
-			if (adcarray[i][j] == ADC_OPEN_CONNVALUE) {
-				if (resist == MAX_RESIST) {
-					printf("***open %d-%d PASS!\n", i, j);
-				} else {
-					printf("***open %d-%d FAIL! %f\n", i, j, resist);
+		}
+	}
+
+	if ((pointA < 999) && (pointB < 999)) {
+		PLANLOG(plan, "Direct %d-%d %f\n", pointA, pointB, plan->adcarray[pointB][pointA]);
+		if (plan->adcarray[pointB][pointA] == ADC_DIRECT_CONNVALUE) {
+			//printf("Skip dup %d-%d\n", pointNext, pointB);
+		} else { 
+			plan->adcarray[pointA][pointB] = ADC_DIRECT_CONNVALUE;
+		}
+	}
+
+	if ((pointA < 999) && (pointB >= 81920)) {
+		//printf("Checking B...\n");
+		// pointB is a compoment, should be input pin=even
+		pointRight = pointLeft = -1;
+		pcompoment = NULL;
+		if ((pointB % 2) != 0) {
+			pointRight = pointB;
+			pointLeft = pointB - 1;
+			//printf("warning pointB connected to outpin %d\n", pointB);
+			pcompoment = FindCompoment(plan, pointB - 1);
+		} else {
+			pointLeft = pointB;
+			pointRight = pointB + 1;
+			pcompoment= FindCompoment(plan, pointB);
+		}
+
+		if (NULL == pcompoment) {
+			PlanError(plan, "Find compoment fail! pointB=%d\n", pointB);
+			return -1;
+		}
+
+		//printf("Find compoment %d\n", pcompoment->id);
+		
+		if (pcompoment->type == COMP_D) {// pointB is connected to a diode
+			// find all these nodes directly connected to the same
+			for (j = 0; j < plan->totalconnectnum; j++) { 
+				if (plan->connlist[j].pointA == pointB) {
+					pointNext = plan->connlist[j].pointB;
+					//printf("nextpoint=%d\n", pointNext);
+					if (pointNext < 999) {
+						if (plan->adcarray[pointNext][pointA] == ADC_DIRECT_CONNVALUE) {
+							//printf("Skip dup %d-%d\n", pointNext, pointB);
+						} else plan->adcarray[pointA][pointNext] = ADC_DIRECT_CONNVALUE;
+					} else {PLANLOG(plan, "splice warning ...\n");}
+					//break;
+				} else if ((plan->connlist[j].pointB == pointB) && (plan->connlist[j].pointA != pointA)) {
+					pointNext = plan->connlist[j].pointA;
+					if (pointNext < 999) {
+						if (plan->adcarray[pointNext][pointA] == ADC_DIRECT_CONNVALUE) {
+						//printf("Skip dup %d-%d\n", pointNext, pointB);
+					} else plan->adcarray[pointA][pointNext] = ADC_DIRECT_CONNVALUE;
+					} else {PLANLOG(plan, "splice warning ...\n");}
 				}
-			} else if (adcarray[i][j] == ADC_DIODE_CONNVALUE) {
-					if ((resist > 0) && (resist < MAX_RESIST)) {
-						printf("***DIOD %d-%d PASS %f\n", i, j, resist);
-					} else {
-						printf("***DIOD %d-%d FAIL %f\n", i, j, resist);
+			}
+
+			// find the other node of the diode
+			if ((pointB % 2) == 0) {// diode input pin
+				pointPair = pointB + 1;
+				for (j = 0; j < plan->totalconnectnum; j++) {
+					if (plan->connlist[j].pointA == pointPair) {
+						pointNext = plan->connlist[j].pointB;
+						if (pointNext < 999) {		
+							plan->adcarray[pointA][pointNext] = ADC_DIODE_CONNVALUE;
+							plan->adcarray[pointNext][pointA] = ADC_OPEN_CONNVALUE;
+						} else {PLANLOG(plan, "splice warning ...\n");}		
+					} else if ((plan->connlist[j].pointB == pointPair) && (plan->connlist[j].pointA != pointA)) {
+						pointNext = plan->connlist[j].pointA;
+						if (pointNext < 999) {
+							plan->adcarray[pointA][pointNext] = ADC_DIODE_CONNVALUE;
+							plan->adcarray[pointNext][pointA] = ADC_OPEN_CONNVALUE;
+						} else {PLANLOG(plan, "splice warning ...\n");}
 					}
-				} 
-			else if (adcarray[i][j] == ADC_DIRECT_CONNVALUE) {
-					if ((resist > ContMin) && (resist < ContMax)) {
-						printf("***directconnection %d-%d PASS %f\n", i, j, resist);
-					} else {
-						printf("***directconnection %d-%d FAIL %f\n", i, j, resist);
+				}					
+			} else {// diode output
+				pointPair = pointB - 1;
+				for (j = 0; j < plan->totalconnectnum; j++) {
+					if (plan->connlist[j].pointA == pointPair) {
+						pointNext = plan->connlist[j].pointB;
+						if (pointNext < 999) {		
+							plan->adcarray[pointA][pointNext] = ADC_OPEN_CONNVALUE;
+							plan->adcarray[pointNext][pointA] = ADC_DIODE_CONNVALUE;
+						} else {PLANLOG(plan, "splice warning ...\n");}		
+					} else if ((plan->connlist[j].pointB == pointPair) && (plan->connlist[j].pointA != pointA)) {
+						pointNext = plan->connlist[j].pointA;
+						if (pointNext < 999) {
+							plan->adcarray[pointA][pointNext] = ADC_OPEN_CONNVALUE;
+							plan->adcarray[pointNext][pointA] = ADC_DIODE_CONNVALUE;
+						} else {PLANLOG(plan, "splice warning ...\n");}
 					}
 				}
-			else if (adcarray[i][j] == -1) {
-				if (resist == MAX_RESIST) {
-					printf("***disconnect %d-%d PASS %f\n", i, j, resist);
-				} else {
-					printf("***disconnect %d-%d FAIL %f\n", i, j, resist);
+			}
+		}
+		else if (pcompoment->type == COMP_R) {// pointB is connected to resistor
+			pointNext = -1;
+			// find all these nodes directly connected to the resistor
+			for (j = 0; j < plan->totalconnectnum; j++) { 
+				if (plan->connlist[j].pointA == pointB) {
+					pointNext = plan->connlist[j].pointB;
+					//printf("nextpoint=%d\n", pointNext);
+					if (pointNext < 999) {
+						if (plan->adcarray[pointNext][pointA] == ADC_DIRECT_CONNVALUE) {
+						//printf("Skip dup %d-%d\n", pointNext, pointB);
+					} else plan->adcarray[pointA][pointNext] = ADC_DIRECT_CONNVALUE;
+					} else {PLANLOG(plan, "splice warning ...\n");}
+					//break;
+				} else if ((plan->connlist[j].pointB == pointB) && (plan->connlist[j].pointA != pointA)) {
+					pointNext = plan->connlist[j].pointA;
+					if (pointNext < 999) {
+						if (plan->adcarray[pointNext][pointA] == ADC_DIRECT_CONNVALUE) {
+							//printf("Skip dup %d-%d\n", pointNext, pointB);
+						} else 	plan->adcarray[pointA][pointNext] = ADC_DIRECT_CONNVALUE;
+					} else {PLANLOG(plan, "splice warning ...\n");}
 				}
-			} else { // resist
-				if ((adcarray[i][j] > 0) && (adcarray[i][j] < 100)) {
-					if ((resist > (adcarray[i][j] - 5)) && (resist < (adcarray[i][j] + 5))) {
-						printf("***resist %d-%d PASS %f==%f\n", i, j, adcarray[i][j], resist);
-					} else {
-						printf("***resist %d-%d FAIL %f==%f\n", i, j, adcarray[i][j], resist);
+			}
+
+			// find the other node of the resistor
+			if ((pointB % 2) == 0) {
+				pointPair = pointB + 1;
+			} else {
+				pointPair = pointB - 1;
+			}
+
+			pointNext = -1;
+			for (j = 0; j < plan->totalconnectnum; j++) {
+				if (plan->connlist[j].pointA == pointPair) {
+					pointNext = plan->connlist[j].pointB;
+					if (pointNext < 999) {
+						if (plan->adcarray[pointNext][pointA] == pcompoment->value) {
+							//printf("Skip dup %d-%d\n", pointNext, pointB);
+						} else plan->adcarray[pointA][pointNext] = pcompoment->value;
+					} else {PLANLOG(plan, "splice warning 2...\n");}		
+				} else if ((plan->connlist[j].pointB == pointPair) && (plan->connlist[j].pointA != pointA)) {
+					pointNext = plan->connlist[j].pointA;
+					if (pointNext < 999) {
+						if (plan->adcarray[pointNext][pointA] == pcompoment->value) {
+							//printf("Skip dup %d-%d\n", pointNext, pointB);
+						} else plan->adcarray[pointA][pointNext] = pcompoment->value;
+					} else {PLANLOG(plan, "splice warning 3...\n");}
+				}
+			}
+		} else {
+			PLANLOG(plan, "connection unsupport fail!\n");	
+		}
+		
+		if (pointNext < 999) {
+		} else {
+			PLANLOG(plan, "Resistor1 fail %d\n", pointNext);
+		}
+	}
+
+	if ((pointB < 999) && (pointA >= 81920)) {
+		//printf("Checking A...\n");
+		// pointA is a compoment, should be input pin=even
+		pointRight = pointLeft = -1;
+		pcompoment = NULL;
+		if ((pointA % 2) != 0) {
+			pointRight = pointA;
+			pointLeft = pointA - 1;
+			//printf("warning pointA connected to outpin %d\n", pointA);
+			pcompoment = FindCompoment(plan, pointA - 1);
+		} else {
+			pointLeft = pointA;
+			pointRight = pointA + 1;
+			pcompoment= FindCompoment(plan, pointA);
+		}
+
+		if (NULL == pcompoment) {
+			PlanError(plan, "Find compoment fail! pointA=%d\n", pointA);
+			return -1;
+		}
+
+		//printf("find compoment id=%d\n", pcompoment->id);
+		
+		if (pcompoment->type == COMP_D) {// pointA=diode pin
+			// find all these nodes directly connected to the same
+			for (j = 0; j < plan->totalconnectnum; j++) {
+				if (plan->connlist[j].pointB == pointA) {
+					pointNext = plan->connlist[j].pointA;
+					//printf("nextpoint=%d\n", pointNext);
+					if (pointNext < 999) {
+						if (plan->adcarray[pointNext][pointB] == ADC_DIRECT_CONNVALUE) {
+							//printf("Skip dup %d-%d\n", pointNext, pointB);
+						} else plan->adcarray[pointB][pointNext] = ADC_DIRECT_CONNVALUE;
+					} else {PLANLOG(plan, "splice warning D1...\n");}
+					//break;
+				} else if ((plan->connlist[j].pointA == pointA) && (plan->connlist[j].pointB != pointB)) {
+					pointNext = plan->connlist[j].pointB;
+					if (pointNext < 999) {
+						if (plan->adcarray[pointNext][pointB] == ADC_DIRECT_CONNVALUE) {
+							//printf("Skip dup %d-%d\n", pointNext, pointB);
+						} else plan->adcarray[pointB][pointNext] = ADC_DIRECT_CONNVALUE;
+					} else {PLANLOG(plan, "splice warning D2...\n");}
+				}
+			}
+
+			// find the other node of the diode
+			if ((pointA % 2) == 0) {// pontA=diode input pin
+				//printf("PointA is diode in...\n");
+				pointPair = pointA + 1;
+				for (j = 0; j < plan->totalconnectnum; j++) {
+					if (plan->connlist[j].pointB == pointPair) {
+						pointNext = plan->connlist[j].pointA;
+						//printf("Din=%d\n", pointNext);
+						if (pointNext < 999) {		
+							plan->adcarray[pointB][pointNext] = ADC_DIODE_CONNVALUE;
+							plan->adcarray[pointNext][pointB] = ADC_OPEN_CONNVALUE;
+						} else {PLANLOG(plan, "splice warning D3...\n");}		
+					} else if ((plan->connlist[j].pointA == pointPair) && (plan->connlist[j].pointB != pointB)) {
+						pointNext = plan->connlist[j].pointB;
+						if (pointNext < 999) {
+							plan->adcarray[pointB][pointNext] = ADC_DIODE_CONNVALUE;
+							plan->adcarray[pointNext][pointB] = ADC_OPEN_CONNVALUE;
+						} else {PLANLOG(plan, "splice warning D4...\n");}
 					}
-				} else if ((adcarray[i][j] >= 100) && (adcarray[i][j] < 10000)) {
-					if ((resist > (adcarray[i][j] * 0.95)) && (resist < (adcarray[i][j] * 1.05))) {
-						printf("***resist %d-%d PASS %f==%f\n", i, j, adcarray[i][j], resist);
-					} else {
-						printf("***resist %d-%d FAIL %f==%f\n", i, j, adcarray[i][j], resist);
-					}				
-				} else if ((adcarray[i][j] >= 10000) && (adcarray[i][j] < 50000)) {
-					if ((resist > (adcarray[i][j] * 0.9)) && (resist < (adcarray[i][j] * 1.1))) {
-						printf("***resist %d-%d PASS %f==%f\n", i, j, adcarray[i][j], resist);
-					} else {
-						printf("***resist %d-%d FAIL %f==%f\n", i, j, adcarray[i][j], resist);
-					}				
-				} else {
-					printf("***resist %d-%d FAIL %f==%f\n", i, j, adcarray[i][j], resist);
-				} 
+				}					
+			} else {// diode output
+				pointPair = pointA - 1; // PointA=Diode output
+				for (j = 0; j < plan->totalconnectnum; j++) {
+					if (plan->connlist[j].pointB == pointPair) {
+						pointNext = plan->connlist[j].pointA;
+						//printf("Dout=%d\n", pointNext);
+						if (pointNext < 999) {		
+							plan->adcarray[pointB][pointNext] = ADC_OPEN_CONNVALUE;
+							plan->adcarray[pointNext][pointB] = ADC_DIODE_CONNVALUE;
+						} else {PLANLOG(plan, "splice warning D5...\n");}		
+					} else if ((plan->connlist[j].pointA == pointPair) && (plan->connlist[j].pointB != pointB)) {
+						pointNext = plan->connlist[j].pointB;
+						if (pointNext < 999) {
+							plan->adcarray[pointB][pointNext] = ADC_OPEN_CONNVALUE;
+							plan->adcarray[pointNext][pointB] = ADC_DIODE_CONNVALUE;
+						} else {PLANLOG(plan, "splice warning D6...\n");}
+					}
+				}
+			}
+		}
+		else if (pcompoment->type == COMP_R) {// pointA is a resistor pin
+			pointNext = -1;
+			// find all these nodes directly connected to the resistor
+			for (j = 0; j < plan->totalconnectnum; j++) {
+				if (plan->connlist[j].pointB == pointA) {
+					pointNext = plan->connlist[j].pointA;
+					//printf("nextpoint=%d\n", pointNext);
+					if (pointNext < 999) {
+						if (pointNext == pointB) {
+							PLANLOG(plan, "R warning loop ... \n");
+						}
+						if (plan->adcarray[pointNext][pointB] == ADC_DIRECT_CONNVALUE) {
+							//printf("Skip dup %d-%d\n", pointNext, pointB);
+						} else plan->adcarray[pointB][pointNext] = ADC_DIRECT_CONNVALUE;
+					} else {PLANLOG(plan, "R warning1 ...\n");}
+				} else if ((plan->connlist[j].pointA == pointA) && (plan->connlist[j].pointB != pointB)) {
+					pointNext = plan->connlist[j].pointB;
+					if (pointNext < 999) {
+						if (plan->adcarray[pointNext][pointB] == ADC_DIRECT_CONNVALUE) {
+							//printf("Skip dup %d-%d\n", pointNext, pointB);
+						} else plan->adcarray[pointB][pointNext] = ADC_DIRECT_CONNVALUE;
+					} else {PLANLOG(plan, "R warning2 ...\n");}
+				}
+			}
+
+			// find the other node of the resistor
+			if ((pointA % 2) == 0) {
+				pointPair = pointA + 1;
+			} else {
+				pointPair = pointA - 1;
+			}
+
+			pointNext = -1;
+			for (j = 0; j < plan->totalconnectnum; j++) {
+				if (plan->connlist[j].pointA == pointPair) {
+					pointNext = plan->connlist[j].pointB;
+					if (pointNext < 999) {
+						if (pointNext == pointB) { PLANLOG(plan, "resistor warning loop ...\n");}
+						if (plan->adcarray[pointNext][pointB] == pcompoment->value) {
+							//printf("Skip dup %d-%d\n", pointNext, pointB);
+						} else plan->adcarray[pointB][pointNext] = pcompoment->value;
+					} else {PLANLOG(plan, "splice warning R5...\n");}		
+				} else if ((plan->connlist[j].pointB == pointPair)) {
+					pointNext = plan->connlist[j].pointA;
+					if (pointNext < 999) {
+						if (pointNext == pointB) { PLANLOG(plan, "resistor warning loop ...\n");}
+						if (plan->adcarray[pointNext][pointB] == pcompoment->value) {
+							//printf("Skip dup %d-%d\n", pointNext, pointB);
+						} else plan->adcarray[pointB][pointNext] = pcompoment->value;
+					} else {PLANLOG(plan, "splice warning R6...\n");}
+				}
+			}
+		} else {
+			PLANLOG(plan, "connection unsupport fail!\n");	
+		}
+	}	
+#endif	
+	// 81920 = first compoment ; 65636= first splice	
+	return 0;
+}
+
+// mark the points of mux A and B used by the expectation table
+static void BuildTestPoints(struct stplan *plan) {
+	int i, j;
+
+	PLANLOG(plan, "\nADC check table:\n");
+	for (i = 0; i < MAXCHANNEL; i++) {
+		for (j = 0; j < MAXCHANNEL; j++) {
+			if (-1 != plan->adcarray[i][j]) {
+				PLANLOG(plan, "adcarray[%d-%d]=%fohm\n", i, j, plan->adcarray[i][j]);
+				plan->testpointsA[i] = 1;
+				plan->testpointsB[j] = 1;
 			}
-	   }
-   }
+		}
+	}
+
+	PLANLOG(plan, "\nTest point A list:\n");
+	for (i = 0; i < MAXCHANNEL; i++) {
+		if (plan->testpointsA[i] != -1) {
+			PLANLOG(plan, "%d[name=%s] ", i, plan->fixturelist[i].name);
+		}
+	}
+
+	PLANLOG(plan, "\nTest point B list:\n");
+	for (i = 0; i < MAXCHANNEL; i++) {
+		if (plan->testpointsB[i] != -1) {
+			PLANLOG(plan, "%d[name=%s] ", i, plan->fixturelist[i].name);
+		}
+	}	
+	
+	PLANLOG(plan, "\n");
+}
+
+// the test points of the connection list must be on the mux
+static int CheckConnections(struct stplan *plan) {
+	int i = 0;
+	unsigned int pointA, pointB;
+
+	for (i = 0; i < plan->totalconnectnum; i++) {
+		pointA = plan->connlist[i].pointA;
+		pointB = plan->connlist[i].pointB;
+		if (((pointA < 999) && (pointA >= MAXCHANNEL)) || ((pointB < 999) && (pointB >= MAXCHANNEL))) {
+			PlanError(plan, "connection check fail! point[%d-%d] over %d channels\n", pointA, pointB, MAXCHANNEL);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+// Build the expectation table adcarray from the connection list, and the
+// test points of mux A and B
+static int BuildADCArray(struct stplan *plan) {
+	int i = 0;
+
+	if (CheckConnections(plan) < 0) {
+		return -1;
+	}
+
+	// TODO Display the open items
+	PLANLOG(plan, "\nconnection list:\n");
+	for (i = 0; i < plan->totalconnectnum; i++) {
+		if (BuildConnection(plan, i) < 0) {
+			return -1;
+		}
+	}
+	BuildTestPoints(plan);
+	return 0;
+}
+
+// Incremental rebuild: the builder only joins the points of one net,
+// through wires, splices and both pins of a compoment, so the entries of a
+// net depend on its own connections only, in list order. Nets whose
+// connections, splices and compoments did not change keep their entries.
+#define REBUILD_SPLICES (81920 - 65636)
+#define REBUILD_COMPOMENTS (4096)
+#define REBUILD_NODES (MAXCHANNEL + REBUILD_SPLICES + REBUILD_COMPOMENTS)
+
+struct strebuild {
+	int parent[REBUILD_NODES];
+	unsigned char changed[REBUILD_NODES];
+	int oldhead[REBUILD_NODES]; // connections of the net, in list order
+	int newhead[REBUILD_NODES];
+	int oldnext[999];
+	int newnext[999];
+	int oldnet[999];
+	int newnet[999];
+};
+
+// node of a point: both pins of a compoment are one node, -1 for the
+// points the builder does not join, -2 when out of the table
+static int RebuildNode(unsigned int point) {
+	if (point < MAXCHANNEL) {
+		return point;
+	}
+	if (point < 65636) {
+		return -1;
+	}
+	if (point < 81920) {
+		return MAXCHANNEL + point - 65636;
+	}
+	if ((point - 81920) / 2 < REBUILD_COMPOMENTS) {
+		return MAXCHANNEL + REBUILD_SPLICES + (point - 81920) / 2;
+	}
+	return -2;
+}
+
+// root of the node in a union-find forest, halving the path on the way
+static int NetFind(int *parent, int node) {
+	while (parent[node] != node) {
+		parent[node] = parent[parent[node]];
+		node = parent[node];
+	}
+	return node;
+}
+
+static int RebuildFind(struct strebuild *rb, int node) {
+	return NetFind(rb->parent, node);
+}
+
+// join the two points of every connection, returns -1 on a point out of the table
+static int RebuildJoin(struct strebuild *rb, const struct stplan *plan) {
+	int nodeA, nodeB;
+	int i;
+
+	for (i = 0; i < plan->totalconnectnum; i++) {
+		nodeA = RebuildNode(plan->connlist[i].pointA);
+		nodeB = RebuildNode(plan->connlist[i].pointB);
+		if ((-2 == nodeA) || (-2 == nodeB)) {
+			return -1;
+		}
+		if ((nodeA >= 0) && (nodeB >= 0)) {
+			rb->parent[RebuildFind(rb, nodeA)] = RebuildFind(rb, nodeB);
+		}
+	}
+	return 0;
+}
+
+// node of a point in the electrical nets: unlike RebuildNode() every
+// compoment pin is a node of its own, a compoment is between two nets;
+// -1 outside the table
+#define NET_NODES (MAXCHANNEL + REBUILD_SPLICES + 2 * REBUILD_COMPOMENTS)
+static int NetNode(unsigned int point) {
+	if (point < MAXCHANNEL) {
+		return point;
+	}
+	if ((point >= 65636) && (point < 81920)) {
+		return MAXCHANNEL + point - 65636;
+	}
+	if ((point >= 81920) && (point - 81920 < 2 * REBUILD_COMPOMENTS)) {
+		return MAXCHANNEL + REBUILD_SPLICES + point - 81920;
+	}
+	return -1;
+}
+
+// the fixture pin of every point and its net, for the fail lists: the
+// wires and splices join the nets, a net is named by its first wire
+static void NamePoints(struct stplan *plan, struct sthistory *hs) {
+	const char *net;
+	int *parent, *first;
+	int nodeA, nodeB;
+	int i;
+
+	parent = malloc(2 * NET_NODES * sizeof(int));
+	if (NULL == parent) {
+		printf("net alloc fail!\n");
+		return;
+	}
+	first = parent + NET_NODES;
+	for (i = 0; i < NET_NODES; i++) {
+		parent[i] = i;
+		first[i] = -1;
+	}
+	for (i = 0; i < plan->totalconnectnum; i++) {
+		nodeA = NetNode(plan->connlist[i].pointA);
+		nodeB = NetNode(plan->connlist[i].pointB);
+		if ((nodeA >= 0) && (nodeB >= 0)) {
+			parent[NetFind(parent, nodeA)] = NetFind(parent, nodeB);
+		}
+	}
+	for (i = plan->totalconnectnum - 1; i >= 0; i--) {
+		nodeA = NetNode(plan->connlist[i].pointA);
+		nodeA = (nodeA >= 0) ? nodeA : NetNode(plan->connlist[i].pointB);
+		if (nodeA >= 0) {
+			first[NetFind(parent, nodeA)] = i;
+		}
+	}
+
+	for (i = 0; i < MAXCHANNEL; i++) {
+		if (plan->fixturelist[i].id != i) {
+			continue;
+		}
+		nodeA = first[NetFind(parent, i)];
+		net = (nodeA >= 0) ? plan->connlist[nodeA].name : "";
+		HSName(hs, i, plan->fixturelist[i].name, net);
+	}
+	free(parent);
+}
+
+// chain the connections of every net in list order
+static void RebuildChain(struct strebuild *rb, const struct stplan *plan, int *head, int *next, int *net) {
+	int node;
+	int i;
+
+	for (i = plan->totalconnectnum - 1; i >= 0; i--) {
+		node = RebuildNode(plan->connlist[i].pointA);
+		if (node < 0) {
+			node = RebuildNode(plan->connlist[i].pointB);
+		}
+		net[i] = (node < 0) ? -1 : RebuildFind(rb, node);
+		if (net[i] < 0) {
+			continue;
+		}
+		next[i] = head[net[i]];
+		head[net[i]] = i;
+	}
+}
+
+// the compoment is missing or different in the other plan
+static char isCompomentChanged(struct stplan *plan, struct stplan *other, unsigned int id) {
+	struct stcompoment *a = FindCompoment(plan, id);
+	struct stcompoment *b = FindCompoment(other, id);
+
+	return (NULL == b) || (a->type != b->type) || (a->value != b->value);
+}
+
+static void RebuildMarkChanged(struct strebuild *rb, struct stplan *plan, struct stplan *other) {
+	int node;
+	int i;
+
+	for (i = 0; i < plan->totalcomp; i++) {
+		node = RebuildNode(plan->complist[i].id);
+		if ((node >= 0) && isCompomentChanged(plan, other, plan->complist[i].id)) {
+			rb->changed[RebuildFind(rb, node)] = 1;
+		}
+	}
+	for (i = 0; i < plan->totalsplice; i++) {
+		node = RebuildNode(plan->splicelist[i].id);
+		if ((node >= 0) && !inSpliceList(other, plan->splicelist[i].id)) {
+			rb->changed[RebuildFind(rb, node)] = 1;
+		}
+	}
+}
+
+static int FullBuild(struct stplan *plan, struct stprogram *prog,
+	const struct stxtoptions *options) {
+	if ((BuildADCArray(plan) < 0) || (CompilePlan(plan, prog, options) < 0)) {
+		return -1;
+	}
+	return MAXCHANNEL;
+}
+
+// Build plan, the new parse of the NXF old was built from, again from the
+// old expectation table and program: only the points on the nets touched
+// by a changed connection, splice or compoment are built and compiled.
+// Returns the number of points built, MAXCHANNEL after a full build.
+static int RebuildPlan(struct stplan *old, const struct stprogram *oldprog,
+	struct stplan *plan, struct stprogram *prog, const struct stxtoptions *options) {
+	struct strebuild *rb;
+	unsigned char affected[MAXCHANNEL];
+	int touched = 0;
+	int a, b;
+	int i, j;
+
+	ResetExpect(plan);
+	if (old->retest || (old->ContMin != plan->ContMin) || (old->ContMax != plan->ContMax)) {
+		return FullBuild(plan, prog, options);
+	}
+	if (CheckConnections(plan) < 0) {
+		return -1;
+	}
+
+	rb = malloc(sizeof(*rb));
+	if (NULL == rb) {
+		printf("rebuild alloc fail!\n");
+		return -1;
+	}
+	for (i = 0; i < REBUILD_NODES; i++) {
+		rb->parent[i] = i;
+		rb->changed[i] = 0;
+		rb->oldhead[i] = rb->newhead[i] = -1;
+	}
+	if ((RebuildJoin(rb, old) < 0) || (RebuildJoin(rb, plan) < 0)) {
+		free(rb);
+		return FullBuild(plan, prog, options);
+	}
+
+	RebuildMarkChanged(rb, plan, old);
+	RebuildMarkChanged(rb, old, plan);
+	RebuildChain(rb, old, rb->oldhead, rb->oldnext, rb->oldnet);
+	RebuildChain(rb, plan, rb->newhead, rb->newnext, rb->newnet);
+	for (i = 0; i < REBUILD_NODES; i++) {
+		if (rb->parent[i] != i) {
+			continue;
+		}
+		for (a = rb->oldhead[i], b = rb->newhead[i]; (a >= 0) && (b >= 0);
+			a = rb->oldnext[a], b = rb->newnext[b]) {
+			if ((old->connlist[a].pointA != plan->connlist[b].pointA)
+				|| (old->connlist[a].pointB != plan->connlist[b].pointB)) {
+				break;
+			}
+		}
+		if ((a >= 0) || (b >= 0)) {
+			rb->changed[i] = 1;
+		}
+	}
+
+	for (i = 0; i < MAXCHANNEL; i++) {
+		affected[i] = rb->changed[RebuildFind(rb, i)];
+		touched += affected[i];
+	}
+
+	memcpy(plan->adcarray, old->adcarray, sizeof(plan->adcarray));
+	for (i = 0; i < MAXCHANNEL; i++) {
+		if (!affected[i]) {
+			continue;
+		}
+		for (j = 0; j < MAXCHANNEL; j++) {
+			plan->adcarray[i][j] = -1;
+			plan->adcarray[j][i] = -1;
+		}
+	}
+
+	PLANLOG(plan, "\nconnection list:\n");
+	for (i = 0; i < plan->totalconnectnum; i++) {
+		if ((rb->newnet[i] >= 0) && rb->changed[rb->newnet[i]]
+			&& (BuildConnection(plan, i) < 0)) {
+			free(rb);
+			return -1;
+		}
+	}
+	free(rb);
+	BuildTestPoints(plan);
+
+	// the test points and pairs of two other points did not change either
+	return (CompilePlanFrom(plan, prog, options, oldprog, affected) < 0) ? -1 : touched;
+}
+
+struct stbatchfile {
+	const char *filename;
+	int ret;           // 0: compiled, -1: rejected
+	int errors;
+	int connections;
+	int instructions;
+	unsigned long long ns;
+};
+
+struct stbatch {
+	struct stbatchfile *files;
+	int count;
+	int next;          // next file to take, shared by the threads
+};
+
+// the points a program measures, the highest mux channel plus one
+static int ProgramPoints(const struct stprogram *prog) {
+	int points = 0;
+	int i;
+
+	for (i = 0; i < prog->count; i++) {
+		if (prog->code[i].muxA >= points) {
+			points = prog->code[i].muxA + 1;
+		}
+		if (prog->code[i].muxB >= points) {
+			points = prog->code[i].muxB + 1;
+		}
+	}
+	return points;
+}
+
+// open the outputs of one scan of the current plan: fail list, result
+// sink and history run
+static int BeginRun(const char *name, const struct stprogram *prog) {
+	int pairs = 0;
+	int i;
+
+	g_totaltested = g_totalfail = 0;
+	g_failfile = fopen(g_failfilename, "w");
+	if (NULL == g_failfile) {
+		printf("Open fail list %s fail! %s\n", g_failfilename, strerror(errno));
+	}
+	if (g_resultfilename[0]) {
+		g_resultsink = RSOpen(g_resultfilename, RSFormat(g_resultfilename), MAXCHANNEL);
+		if (NULL == g_resultsink) {
+			return -1;
+		}
+		for (i = 0; i < MAXCHANNEL; i++) {
+			if (g_plan->fixturelist[i].id == i) {
+				RSName(g_resultsink, i, g_plan->fixturelist[i].name);
+			}
+		}
+	}
+	if (g_historydir[0]) {
+		g_history = HSOpen(g_historydir, 1);
+		if ((NULL == g_history) || (HSBeginRun(g_history, g_serial, name) < 0)) {
+			return -1;
+		}
+		LabelCompoments(g_plan, g_history);
+		NamePoints(g_plan, g_history);
+	}
+	for (i = 0; i < prog->count; i++) {
+		pairs += (TP_MEASURE == prog->code[i].op);
+	}
+	if (NULL != g_fb) {
+		FBBegin(g_fb, pairs);
+	}
+	if (NULL != g_live) {
+		LSBeginRun(g_live, name, g_serial, pairs, ProgramPoints(prog));
+		for (i = 0; i < MAXCHANNEL; i++) {
+			if (g_plan->fixturelist[i].id == i) {
+				LSName(g_live, i, g_plan->fixturelist[i].name);
+			}
+		}
+	}
+	return 0;
+}
+
+// the simulated harness: the nxfgen truth, else the program of a loaded
+// plan, else the current plan
+static int SimLoad(const struct stprogram *loaded) {
+	if (g_simulate && g_expectfilename[0]) {
+		return SimLoadExpect(g_expectfilename);
+	} else if (g_simulate && (NULL != loaded)) {
+		SimLoadProgram(loaded);
+	} else if (g_simulate) {
+		SimLoadPlan(g_plan);
+	}
+	return 0;
+}
+
+// close the outputs of the scan and print its summary
+static void EndRun() {
+	if (NULL != g_fb) {
+		FBEnd(g_fb);
+	}
+	if (NULL != g_live) {
+		LSEndRun(g_live);
+	}
+	if (NULL != g_failfile) {
+		fclose(g_failfile);
+		g_failfile = NULL;
+	}
+	if ((NULL != g_resultsink) && (RSClose(g_resultsink) < 0)) {
+		printf("Write result %s fail!\n", g_resultfilename);
+	}
+	g_resultsink = NULL;
+	if (NULL != g_history) {
+		HSEndRun(g_history);
+		printf("History %s: %u results, %u runs\n", g_historydir, HSRows(g_history),
+			HSRuns(g_history));
+		HSClose(g_history);
+		g_history = NULL;
+	}
+	if (0 == g_totaltested) {
+		printf("%s: no pairs tested, FAIL\n", g_retest ? "Retest" : "Test");
+	} else {
+		printf("%s %d pairs, %d FAIL, fail list %s\n", g_retest ? "Retest" : "Test",
+			g_totaltested, g_totalfail, g_failfilename);
+	}
+	printf("ADC reads %d, saved %d, screen %d\n", g_scanstats.measures,
+		g_scanstats.reuses, g_scanstats.screens);
+}
+
+// a harness type of the station: the netlist, expectation table and the
+// compiled scan, kept together in the plan cache
+struct stcompiled {
+	char filename[PC_NAME_SIZE];
+	struct stplan *plan;
+	struct stprogram prog;
+};
+
+static void FreeCompiled(void *arg) {
+	struct stcompiled *compiled = arg;
+
+	TPFree(&compiled->prog);
+	free(compiled->plan);
+	free(compiled);
+}
+
+static struct stcompiled *CompileFile(const char *filename, const struct stxtoptions *options) {
+	struct stcompiled *compiled;
+
+	compiled = calloc(1, sizeof(*compiled));
+	if (NULL == compiled) {
+		printf("plan alloc fail!\n");
+		return NULL;
+	}
+	snprintf(compiled->filename, sizeof(compiled->filename), "%s", filename);
+	TPInit(&compiled->prog);
+	compiled->plan = NewPlan(compiled->filename, 0);
+	if ((NULL == compiled->plan) || (ParsePlan(compiled->plan, filename) < 0)
+		|| (BuildADCArray(compiled->plan) < 0)
+		|| (CompilePlan(compiled->plan, &compiled->prog, options) < 0)) {
+		FreeCompiled(compiled);
+		return NULL;
+	}
+	return compiled;
+}
+
+// the new version of a cached harness, built again from the stale plan
+static struct stcompiled *RebuildFile(struct stcompiled *old, const char *filename,
+	const struct stxtoptions *options, int *touched) {
+	struct stcompiled *compiled;
+
+	compiled = calloc(1, sizeof(*compiled));
+	if (NULL == compiled) {
+		printf("plan alloc fail!\n");
+		return NULL;
+	}
+	snprintf(compiled->filename, sizeof(compiled->filename), "%s", filename);
+	TPInit(&compiled->prog);
+	compiled->plan = NewPlan(compiled->filename, 0);
+	if ((NULL == compiled->plan) || (ParsePlan(compiled->plan, filename) < 0)) {
+		FreeCompiled(compiled);
+		return NULL;
+	}
+	*touched = RebuildPlan(old->plan, &old->prog, compiled->plan, &compiled->prog, options);
+	if (*touched < 0) {
+		FreeCompiled(compiled);
+		return NULL;
+	}
+	return compiled;
+}
+
+// the hardware of the station, opened for the first engine
+static int EngineAttach(const struct stxtoptions *options) {
+	int ret = 0;
+	int i;
+
+	pthread_mutex_lock(&g_enginelock);
+	if (0 == g_engines) {
+		LIBXML_TEST_VERSION
+		g_simulate = options->simulate;
+		for (i = 0; i < MAXCHANNEL; i++) {
+			g_gpiofd[i] = -1;
+		}
+		ExportALLOut0();
+		g_engineadc = OpenADC();
+	} else if (g_simulate != options->simulate) {
+		printf("engine: the station is %s already\n", g_simulate ? "simulated" : "real");
+		ret = -1;
+	}
+	if (0 == ret) {
+		g_engines++;
+	}
+	pthread_mutex_unlock(&g_enginelock);
+	return ret;
+}
+
+static void EngineDetach() {
+	pthread_mutex_lock(&g_enginelock);
+	if (0 == --g_engines) {
+		UnexportALL();
+		CloseADC(g_engineadc);
+		g_engineadc = -1;
+	}
+	pthread_mutex_unlock(&g_enginelock);
+}
+
+// the compiled plan of the file, built again from the previous one when
+// only the file changed: its size or mtime, as the plan cache checks
+static int EngineLoad(struct stxtengine *engine) {
+	struct stcompiled *compiled;
+	struct stat st;
+	int touched;
+
+	if (stat(engine->filename, &st) < 0) {
+		printf("Open %s fail! %s\n", engine->filename, strerror(errno));
+		return -1;
+	}
+	if ((NULL != engine->compiled) && (0 == strcmp(engine->compiled->filename, engine->filename))) {
+		if ((st.st_size == engine->size) && (st.st_mtime == engine->mtime)) {
+			return 0;
+		}
+		compiled = RebuildFile(engine->compiled, engine->filename, &engine->options, &touched);
+	} else {
+		compiled = CompileFile(engine->filename, &engine->options);
+	}
+	if (NULL == compiled) {
+		return -1;
+	}
+	if (NULL != engine->compiled) {
+		FreeCompiled(engine->compiled);
+	}
+	engine->compiled = compiled;
+	engine->size = st.st_size;
+	engine->mtime = st.st_mtime;
+	return 0;
+}
+
+// load on the thread of the engine, then scan when the hardware is free
+static void *EngineThread(void *arg) {
+	struct stxtengine *engine = arg;
+	const struct stxtcallbacks *cb = &engine->callbacks;
+	struct stplan *mainplan;
+	int status = XT_FAIL;
+	int i;
+
+	if (EngineLoad(engine) < 0) {
+		goto done;
+	}
+	engine->pairs = 0;
+	for (i = 0; i < engine->compiled->prog.count; i++) {
+		engine->pairs += (TP_MEASURE == engine->compiled->prog.code[i].op);
+	}
+	if (NULL != cb->loaded) {
+		cb->loaded(cb->arg, ProgramPoints(&engine->compiled->prog), engine->pairs);
+	}
+
+	pthread_mutex_lock(&g_enginelock);
+	if (__atomic_load_n(&engine->cancel, __ATOMIC_RELAXED)) {
+		status = XT_CANCELLED;
+	} else {
+		mainplan = g_plan;
+		g_plan = engine->compiled->plan;
+		g_quiet = engine->options.quiet;
+		snprintf(g_serial, sizeof(g_serial), "%s", engine->serial);
+		snprintf(g_failfilename, sizeof(g_failfilename), "%s", engine->faillist);
+		snprintf(g_historydir, sizeof(g_historydir), "%s", engine->historydir);
+		g_engine = engine;
+		if ((BeginRun(engine->filename, &engine->compiled->prog) == 0) && (SimLoad(NULL) == 0)) {
+			status = ScanPlan(&engine->compiled->prog, g_engineadc, &g_scanstats);
+			status = (TP_CANCELLED == status) ? XT_CANCELLED : (status < 0) ? XT_FAIL : XT_OK;
+		}
+		EndRun();
+		if (NULL != cb->progress) {
+			cb->progress(cb->arg, g_totaltested, engine->pairs, g_totalfail);
+		}
+		g_engine = NULL;
+		g_plan = mainplan;
+	}
+	pthread_mutex_unlock(&g_enginelock);
+
+done:
+	engine->status = status;
+	__atomic_store_n(&engine->finished, 1, __ATOMIC_RELEASE);
+	if (NULL != cb->done) {
+		cb->done(cb->arg, status);
+	}
+	return NULL;
+}
+
+struct stxtengine *XTCreate(const struct stxtoptions *options, const struct stxtcallbacks *callbacks) {
+	struct stxtengine *engine;
+
+	engine = calloc(1, sizeof(*engine));
+	if (NULL == engine) {
+		printf("engine alloc fail!\n");
+		return NULL;
+	}
+	engine->options = *options;
+	if (engine->options.samples < 1) {
+		engine->options.samples = XT_SAMPLES_DEFAULT;
+	}
+	snprintf(engine->serial, sizeof(engine->serial), "%s", options->serial ? options->serial : "-");
+	snprintf(engine->faillist, sizeof(engine->faillist), "%s",
+		options->faillist ? options->faillist : FAILLIST_DEFAULT);
+	snprintf(engine->historydir, sizeof(engine->historydir), "%s",
+		options->historydir ? options->historydir : "");
+	engine->callbacks = *callbacks;
+	if (EngineAttach(options) < 0) {
+		free(engine);
+		return NULL;
+	}
+	return engine;
+}
+
+void XTDestroy(struct stxtengine *engine) {
+	if (NULL == engine) {
+		return;
+	}
+	XTCancel(engine);
+	XTWait(engine);
+	if (NULL != engine->compiled) {
+		FreeCompiled(engine->compiled);
+	}
+	EngineDetach();
+	free(engine);
+}
+
+// load and scan the file on the thread of the engine, returns at once
+int XTStart(struct stxtengine *engine, const char *filename) {
+	int err;
+
+	if (engine->running) {
+		if (!__atomic_load_n(&engine->finished, __ATOMIC_ACQUIRE)) {
+			printf("engine busy with %s\n", engine->filename);
+			return -1;
+		}
+		XTWait(engine);
+	}
+	snprintf(engine->filename, sizeof(engine->filename), "%s", filename);
+	engine->cancel = 0;
+	engine->finished = 0;
+	err = pthread_create(&engine->thread, NULL, EngineThread, engine);
+	if (err) {
+		printf("engine thread fail! %s\n", strerror(err));
+		return -1;
+	}
+	engine->running = 1;
+	return 0;
+}
+
+// the scan stops before the next A point, a run still loading does not scan
+void XTCancel(struct stxtengine *engine) {
+	__atomic_store_n(&engine->cancel, 1, __ATOMIC_RELAXED);
+}
+
+int XTWait(struct stxtengine *engine) {
+	if (engine->running) {
+		pthread_join(engine->thread, NULL);
+		engine->running = 0;
+	}
+	return engine->status;
+}
+
+// the fixture pin of a point of the loaded plan, "" when none; not while
+// the engine loads the next plan
+const char *XTPointName(const struct stxtengine *engine, int point) {
+	if ((NULL == engine->compiled) || (point < 0) || (point >= MAXCHANNEL)
+		|| (engine->compiled->plan->fixturelist[point].id != point)) {
+		return "";
+	}
+	return engine->compiled->plan->fixturelist[point].name;
+}
+
+#ifndef XT_LIBRARY
+// the command line: main() and the modes, perf and batch code only it runs
+
+// the compile options of the command line
+static void CliOptions(struct stxtoptions *options) {
+	memset(options, 0, sizeof(*options));
+	options->simulate = g_simulate;
+	options->quiet = g_quiet;
+	options->twostage = g_twostage;
+	options->samples = g_samples;
+	options->settle_us = g_settleus;
+}
+
+static const char *parsernames[PARSER_MAX] = {
+	"GetFixtures",
+	"GetSplices",
+	"GetConnections",
+	"GetCompoments",
+};
+
+static void PerfSelect(int domain, unsigned int num) {
+}
+
+static void PerfSettle(int us) {
+}
+
+static float PerfRead(int channel, int samples) {
+	return channel ? 2000 : SIM_ADC0;
+}
+
+static void PerfReport(const struct stinstr *in, float adc0, float adc2, float resist, int pass) {
+}
+
+// the scan without hardware and log, only the compare against the bands
+static const struct sthwops perfops = {
+	PerfSelect,
+	PerfRead,
+	PerfSettle,
+	GetResist,
+	PerfReport,
+};
+
+// touch the stack the scan will use, so it does not fault in the loop
+static void PrefaultStack() {
+	volatile unsigned char stack[RT_STACK_PREFAULT];
+	int i;
+
+	for (i = 0; i < sizeof(stack); i += 4096) {
+		stack[i] = 0;
+	}
+}
+
+static int BatchSave(const struct stprogram *prog, const char *filename) {
+	char path[512];
+	const char *name = strrchr(filename, '/');
+
+	snprintf(path, sizeof(path), "%s/%s.tp", g_savefilename, name ? name + 1 : filename);
+	return TPSave(prog, path);
+}
+
+static int findNet(struct stplan *plan, int point) {
+	while (plan->netparent[point] != point) {
+		plan->netparent[point] = plan->netparent[plan->netparent[point]];
+		point = plan->netparent[point];
+	}
+	return point;
+}
+
+static void *RealtimeScanThread(void *arg) {
+	struct stscanjob *job = arg;
+
+	PrefaultStack();
+	job->ret = ScanPlan(job->prog, job->adc_fd, job->stats);
+	return NULL;
+}
+
+// every thread works on its own plan, the files are taken in order
+static void *BatchThread(void *arg) {
+	struct stbatch *batch = arg;
+	struct stbatchfile *file;
+	struct stxtoptions options;
+	struct stprogram prog;
+	struct stplan *plan;
+	unsigned long long start;
+	int i;
+
+	CliOptions(&options);
+	plan = NewPlan(NULL, 0);
+	if (NULL == plan) {
+		return NULL;
+	}
+	TPInit(&prog);
+	while ((i = __sync_fetch_and_add(&batch->next, 1)) < batch->count) {
+		file = &batch->files[i];
+		start = NowNs();
+		ResetNetlist(plan);
+		ResetExpect(plan);
+		plan->filename = file->filename;
+
+		file->ret = ParsePlan(plan, file->filename);
+		if (0 == file->ret) {
+			file->ret = BuildADCArray(plan);
+		}
+		if ((0 == file->ret) && (CompilePlan(plan, &prog, &options) < 0)) {
+			file->ret = -1;
+		}
+		if ((0 == file->ret) && g_savefilename[0] && (BatchSave(&prog, file->filename) < 0)) {
+			file->ret = -1;
+		}
+		file->errors = plan->errors;
+		file->connections = plan->totalconnectnum;
+		file->instructions = prog.count;
+		file->ns = NowNs() - start;
+		TPFree(&prog);
+	}
+	free(plan);
+	return NULL;
+}
+
+// group the points joined by direct connections (wires/splices) into nets
+static void BuildNets(struct stplan *plan) {
+	int i, j;
+	int rootA, rootB;
+
+	for (i = 0; i < MAXCHANNEL; i++) {
+		plan->netparent[i] = i;
+	}
+
+	for (i = 0; i < MAXCHANNEL; i++) {
+		for (j = 0; j < MAXCHANNEL; j++) {
+			if (plan->adcarray[i][j] != ADC_DIRECT_CONNVALUE) {
+				continue;
+			}
+			rootA = findNet(plan, i);
+			rootB = findNet(plan, j);
+			if (rootA != rootB) {
+				plan->netparent[rootB] = rootA;
+			}
+		}
+	}
+}
+
+// the point is wired in this plan (fixture pin or scheduled test point)
+static char isPlanPoint(struct stplan *plan, int point) {
+	if ((point < 0) || (point >= MAXCHANNEL)) {
+		return 0;
+	}
+	return (plan->fixturelist[point].id == point) || (plan->testpointsA[point] != -1)
+		|| (plan->testpointsB[point] != -1);
+}
+
+static void PhaseDumpExit() {
+	PhaseDump(stdout);
+}
+
+// only note the request, the dump runs from the scan loop or the idle station
+static void PhaseSignal(int sig) {
+	g_phasedump = 1;
+}
+
+// SA_RESTART for the scan, so a dump request does not fail an ADC read;
+// without it a wait for input returns EINTR and the dump is served there
+static void PhaseSignalFlags(int flags) {
+	struct sigaction sa;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = PhaseSignal;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = flags;
+	sigaction(SIGUSR1, &sa, NULL);
+}
+
+// Run the scan in a thread with locked memory, SCHED_FIFO priority and
+// pinned to one cpu, so the time from a mux switch to the ADC sample does
+// not depend on page faults or on the other processes (the test1 GUI).
+// Without the thread the scan runs here, as ScanPlan().
+static int RealtimeScan(const struct stprogram *prog, int adc_fd, struct sttpstats *stats) {
+	struct stscanjob job = {prog, adc_fd, stats, -1};
+	struct sched_param param;
+	pthread_attr_t attr;
+	pthread_t thread;
+	cpu_set_t cpus;
+	int cpus_online = sysconf(_SC_NPROCESSORS_ONLN);
+	int cpu = g_rtcpu;
+	int err;
+
+	if (mlockall(MCL_CURRENT | MCL_FUTURE)) {
+		printf("mlockall fail! %s\n", strerror(errno));
+	}
+	// keep freed heap mapped, the next allocation does not fault
+	mallopt(M_TRIM_THRESHOLD, -1);
+	mallopt(M_MMAP_MAX, 0);
+
+	if (cpus_online < 1) {
+		cpus_online = 1;
+	}
+	if (cpu >= cpus_online) {
+		printf("cpu %d not online, %d cpus: scan on cpu %d\n", cpu, cpus_online, cpus_online - 1);
+		cpu = -1;
+	}
+	if (cpu < 0) {
+		cpu = cpus_online - 1;
+	}
+	CPU_ZERO(&cpus);
+	CPU_SET(cpu, &cpus);
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = g_rtprio;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setstacksize(&attr, RT_STACK_SIZE);
+	pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+	pthread_attr_setschedparam(&attr, &param);
+
+	err = pthread_create(&thread, &attr, RealtimeScanThread, &job);
+	if (EPERM == err) {
+		printf("SCHED_FIFO not permitted, scan with normal priority\n");
+		pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+		err = pthread_create(&thread, &attr, RealtimeScanThread, &job);
+	} else if (0 == err) {
+		printf("realtime scan: cpu %d SCHED_FIFO %d\n", cpu, g_rtprio);
+	}
+	pthread_attr_destroy(&attr);
+
+	if (err) {
+		printf("scan thread fail! %s, scan with normal priority\n", strerror(err));
+		job.ret = ScanPlan(prog, adc_fd, stats);
+	} else {
+		pthread_join(thread, NULL);
+	}
+	munlockall();
+	return job.ret;
+}
+
+// start a JSON line with the timing of one perf stage
+static void PerfPrint(FILE *fp, const char *bench, const struct sthisto *histo) {
+	fprintf(fp, "{\"bench\":\"%s\",\"iterations\":%llu,\"ns_min\":%llu,"
+		"\"ns_p50\":%llu,\"ns_p99\":%llu,\"ns_max\":%llu,\"ns_mean\":%.0f",
+		bench, histo->count, histo->min, HistoPercentile(histo, 50),
+		HistoPercentile(histo, 99), histo->max,
+		histo->count ? (double)histo->sum / histo->count : 0.0);
+}
+
+// per second from a mean time in ns
+static double PerfRate(double count, const struct sthisto *histo) {
+	if (0 == histo->sum) {
+		return 0;
+	}
+	return count * 1e9 * histo->count / histo->sum;
+}
+
+// a kB line of /proc/self/status, VmRSS or VmHWM (the peak since the reset)
+static long ProcStatusKb(const char *field) {
+	char line[128];
+	long kb = -1;
+	FILE *fp;
+
+	fp = fopen("/proc/self/status", "r");
+	if (NULL == fp) {
+		return -1;
+	}
+	while (fgets(line, sizeof(line), fp)) {
+		if (0 == strncmp(line, field, strlen(field))) {
+			kb = atol(line + strlen(field));
+			break;
+		}
+	}
+	fclose(fp);
+	return kb;
+}
+
+// restart VmHWM from the current RSS
+static void ResetPeakRss() {
+	int fd;
+
+	fd = open("/proc/self/clear_refs", O_WRONLY);
+	if (fd >= 0) {
+		if (write(fd, "5", 1) < 0) {
+			printf("peak RSS reset fail! %s\n", strerror(errno));
+		}
+		close(fd);
+	}
+}
+
+// run the batch on threads, returns the wall time in ns
+static unsigned long long BatchPool(struct stbatch *batch, int threads) {
+	pthread_t thread[BATCH_THREADS_MAX];
+	unsigned long long start = NowNs();
+	int started = 0;
+	int i;
+
+	batch->next = 0;
+	for (i = 0; i < threads; i++) {
+		if (pthread_create(&thread[started], NULL, BatchThread, batch)) {
+			printf("batch thread fail! %s\n", strerror(errno));
+			break;
+		}
+		started++;
+	}
+	if (0 == started) {
+		BatchThread(batch);
+	}
+	for (i = 0; i < started; i++) {
+		pthread_join(thread[i], NULL);
+	}
+	return NowNs() - start;
+}
+
+static int BatchThreads() {
+	int threads = g_batchthreads;
+
+	if (threads <= 0) {
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if (threads > BATCH_THREADS_MAX) {
+		threads = BATCH_THREADS_MAX;
+	}
+	return (threads < 1) ? 1 : threads;
+}
+
+static unsigned long long CompiledBytes(const struct stcompiled *compiled) {
+	return sizeof(*compiled) + sizeof(struct stplan) +
+		compiled->prog.size * sizeof(struct stinstr) +
+		(compiled->prog.stats ? compiled->prog.nslots * sizeof(struct stpairstat) : 0);
+}
+
+static void usage() {
+	printf("check ADC values \n");
+	printf("a.out selftest\n");
+	printf("a.out [options] bench\n");
+	printf("a.out [options] NXfile.nxf  or .nxf.gz/.nxf.xz, decompressed while parsed\n");
+	printf("a.out [options] -p plan\n");
+	printf("a.out [options] perf <NXfile.nxf|bench>\n");
+	printf("a.out [options] perf NXfile.nxf NXfile.nxf ...  batch scaling over 1..N threads\n");
+	printf("a.out [options] batch NXfile.nxf ...\n");
+	printf("a.out [options] station  commands on stdin: load <NXfile.nxf>, scan, cache, quit\n");
+	printf("a.out rebuild old.nxf new.nxf  build new.nxf incrementally from old.nxf\n");
+	printf("  -f file  write the failed pairs of this run to file (default %s)\n", FAILLIST_DEFAULT);
+	printf("  -o file  write every checked pair to file, .csv, .jsonl or binary\n");
+	printf("  -H dir   append the results to the history in dir, query with xthist\n");
+	printf("  -M name  publish the live results in shared memory /dev/shm/name for the GUI\n");
+	printf("  -F dev   show the status on the framebuffer dev (%s, or file:WxHxBPP)\n", FB_DEVICE_DEFAULT);
+	printf("  -S serial  harness serial for the history\n");
+	printf("  -r file  retest only the failed pairs of a previous run and their nets\n");
+	printf("  -s       two-stage scan: screen the expected opens first\n");
+	printf("  -n num   ADC results averaged per precision measurement (default 4)\n");
+	printf("  -t us    settle time before a precision measurement (default 0)\n");
+	printf("  -x       run on the simulated mux/ADC\n");
+	printf("  -e file  simulate the harness of an nxfgen expect file (implies -x)\n");
+	printf("  -q       only print the FAIL lines of the scan\n");
+	printf("  -c file  save the compiled test plan\n");
+	printf("  -p file  run a saved test plan instead of an NXF\n");
+	printf("  -u       learn the pair statistics into the -p/-c plan after the run and\n");
+	printf("           budget samples and settle per pair from them\n");
+	printf("  -R cpu[:prio] scan in a SCHED_FIFO thread (default prio 80) pinned\n");
+	printf("           to cpu (-1: last cpu) with locked memory, use with -q\n");
+	printf("  -m plans[:MB] station: compiled plans kept resident (default %d, %d MB)\n",
+		CACHE_PLANS, CACHE_BUDGET_MB);
+	printf("  -j num   batch: parser threads (default one per cpu), -c dir saves the plans\n");
+	printf("  -i num   perf: iterations of the parse/build/compile runs (default %d)\n", PERF_ITERATIONS);
+	printf("  -L gpio,convert,tau[,noise] perf: scan with this latency model in us,\n");
+	printf("           repeat for more models (default ideal/default/slow-gpio/slow-adc)\n");
+	printf("kill -USR1 <pid> prints the scan phase latencies to stderr\n");
+	return;
+}
+
+// Read the fail list of a previous run and mark the pairs to measure again:
+// every scheduled pair touching a net of a failed pair, plus an isolation
+// check of these nets against the neighbour pins.
+static int SelectRetestPairs(struct stplan *plan, const char *filename) {
+	FILE *fp;
+	char line[256];
+	unsigned int pointA, pointB;
+	unsigned char netfailed[MAXCHANNEL] = {0};
+	unsigned char affected[MAXCHANNEL] = {0};
+	int neighbour[2];
+	int failed = 0;
+	int isolation = 0;
+	int total = 0;
+	int i, j, n;
+
+	fp = fopen(filename, "r");
+	if (NULL == fp) {
+		printf("Open fail list %s fail! %s\n", filename, strerror(errno));
+		return -1;
+	}
+
+	BuildNets(plan);
+
+	while (fgets(line, sizeof(line), fp)) {
+		if (2 != sscanf(line, "%u-%u", &pointA, &pointB)) {
+			continue;
+		}
+		if ((pointA >= MAXCHANNEL) || (pointB >= MAXCHANNEL)) {
+			printf("retest pair %d-%d out of range\n", pointA, pointB);
+			continue;
+		}
+		netfailed[findNet(plan, pointA)] = 1;
+		netfailed[findNet(plan, pointB)] = 1;
+		failed++;
+	}
+	fclose(fp);
+
+	for (i = 0; i < MAXCHANNEL; i++) {
+		affected[i] = netfailed[findNet(plan, i)];
+	}
+
+	memset(plan->retestpairs, 0, sizeof(plan->retestpairs));
+	plan->retest = 1;
+
+	for (i = 0; i < MAXCHANNEL; i++) {
+		if (plan->testpointsA[i] == -1) {
+			continue;
+		}
+		for (j = 0; j < MAXCHANNEL; j++) {
+			if ((i == j) || (plan->testpointsB[j] == -1)) {
+				continue;
+			}
+			if (affected[i] || affected[j]) {
+				plan->retestpairs[i][j] = 1;
+				total++;
+			}
+		}
+	}
+
+	// shorts after a rework show up on the adjacent pins
+	for (i = 0; i < MAXCHANNEL; i++) {
+		if (!affected[i]) {
+			continue;
+		}
+		neighbour[0] = i - 1;
+		neighbour[1] = i + 1;
+		for (n = 0; n < ARRAY_SIZE(neighbour); n++) {
+			j = neighbour[n];
+			if (!isPlanPoint(plan, j) || affected[j] || plan->retestpairs[i][j] || plan->retestpairs[j][i]) {
+				continue;
+			}
+			plan->retestpairs[i][j] = 1;
+			isolation++;
+			total++;
+		}
+	}
+
+	printf("Retest %d failed pairs: %d pairs to measure (%d isolation checks)\n",
+		failed, total, isolation);
+	return total;
+}
+
+// break the first point-to-point wire and short two neighbour nets, so both
+// scan strategies have to find the same FAILs
+static void SimInjectFaults(struct stplan *plan) {
+	int i;
+
+	for (i = 0; i < plan->totalconnectnum; i++) {
+		if ((plan->connlist[i].pointA < 999) && (plan->connlist[i].pointB < 999)) {
+			SimSetResist(plan->connlist[i].pointA, plan->connlist[i].pointB, SIM_OPEN);
+			SimSetResist(plan->connlist[i].pointB, plan->connlist[i].pointA, SIM_OPEN);
+			printf("fault: open %d-%d\n", plan->connlist[i].pointA, plan->connlist[i].pointB);
+			break;
+		}
+	}
+	SimSetResist(2, 3, 0.5);
+	SimSetResist(3, 2, 0.5);
+	printf("fault: short 2-3\n");
+}
+
+// Scan the same harness once with the precision measurement on every pair
+// and once with the screen pass first, on the simulated hardware.
+static void RunScanBench(struct stplan *plan, int adc_fd) {
+	struct stsimcounter counter[2];
+	double elapsed[2];
+	int tested[2], fails[2], reads[2], screens[2];
+	FILE *failfile = g_failfile;
+	struct stresultsink *resultsink = g_resultsink;
+	struct sthistory *history = g_history;
+	struct stlive *live = g_live;
+	struct stfb *fb = g_fb;
+	struct stxtoptions options;
+	struct stprogram prog;
+	double start;
+	int pass;
+
+	CliOptions(&options);
+	for (pass = 0; pass < 2; pass++) {
+		options.twostage = pass;
+		g_failfile = pass ? failfile : NULL;
+		g_resultsink = pass ? resultsink : NULL;
+		g_history = pass ? history : NULL;
+		g_live = pass ? live : NULL;
+		g_fb = pass ? fb : NULL;
+		g_totaltested = g_totalfail = 0;
+		if (CompilePlan(plan, &prog, &options) < 0) {
+			return;
+		}
+
+		SimResetCounter();
+		start = SimClock();
+		ScanPlan(&prog, adc_fd, &g_scanstats);
+		elapsed[pass] = SimClock() - start;
+		SimGetCounter(&counter[pass]);
+		TPFree(&prog);
+
+		tested[pass] = g_totaltested;
+		fails[pass] = g_totalfail;
+		reads[pass] = g_scanstats.measures;
+		screens[pass] = g_scanstats.screens;
+	}
+
+	printf("\nscan bench, latency model: gpio %.0fus convert %.0fus tau %.0fus, settle %dus, %d samples\n",
+		g_simlatency.gpio_us, g_simlatency.convert_us, g_simlatency.settle_tau_us,
+		options.settle_us, options.samples);
+	printf("%-10s %8s %6s %8s %8s %8s %8s %10s\n", "scan", "pairs", "FAIL",
+		"precise", "screen", "ioctl", "gpio", "time(ms)");
+	for (pass = 0; pass < 2; pass++) {
+		printf("%-10s %8d %6d %8d %8d %8lu %8lu %10.1f\n",
+			pass ? "two-stage" : "precise", tested[pass], fails[pass],
+			reads[pass], screens[pass], counter[pass].converts,
+			counter[pass].gpiowrites, elapsed[pass] / 1000);
+	}
+	printf("two-stage speedup %.2fx%s\n", elapsed[0] / elapsed[1],
+		(fails[0] == fails[1]) ? "" : ", FAIL count differs!");
+}
+
+// Time every stage from the NXF to the verdicts on the simulated hardware:
+// parse (streamFile and the row parsers), the expectation table build, the
+// plan compile, the check of every pair and the scan under each latency
+// model. One JSON line per result on stdout, so two builds can be diffed.
+static int RunPerf(struct stplan *plan, const char *filename) {
+	struct sthisto histo;
+	struct stxtoptions options;
+	struct stprogram prog;
+	struct sttpstats stats;
+	struct stsimcounter counter;
+	struct stsimlatency latency = g_simlatency;
+	struct stat st;
+	unsigned long long start;
+	long long bytes = 0;
+	long rss, peak;
+	int bench;
+	int nullfd;
+	int it, m, pass;
+	FILE *out;
+
+	CliOptions(&options);
+	bench = (0 == strcmp(filename, "bench"));
+	if (!bench) {
+		if (stat(filename, &st) < 0) {
+			printf("Open %s fail! %s\n", filename, strerror(errno));
+			return -1;
+		}
+		bytes = st.st_size;
+	}
+
+	// keep the results on stdout, the parse and scan log to /dev/null
+	fflush(stdout);
+	out = fdopen(dup(STDOUT_FILENO), "w");
+	nullfd = open("/dev/null", O_WRONLY);
+	if ((NULL == out) || (nullfd < 0)) {
+		printf("perf output fail! %s\n", strerror(errno));
+		return -1;
+	}
+	dup2(nullfd, STDOUT_FILENO);
+	close(nullfd);
+	g_simulate = 1;
+	g_failfile = NULL;
+
+	HistoReset(&histo);
+	memset(plan->parserstat, 0, sizeof(plan->parserstat));
+	rss = ProcStatusKb("VmRSS:");
+	ResetPeakRss();
+	for (it = 0; it < g_perfiterations; it++) {
+		ResetNetlist(plan);
+		start = NowNs();
+		ParsePlan(plan, filename);
+		HistoAdd(&histo, NowNs() - start);
+	}
+	peak = ProcStatusKb("VmHWM:");
+	PerfPrint(out, "parse", &histo);
+	fprintf(out, ",\"file\":");
+	RSJsonString(out, filename);
+	fprintf(out, ",\"bytes\":%lld,\"xml_bytes\":%llu,\"fixtures\":%d,"
+		"\"connections\":%d,\"splices\":%d,\"compoments\":%d,\"mb_per_s\":%.2f,"
+		"\"connections_per_s\":%.0f,\"rss_kb\":%ld,\"parse_peak_rss_kb\":%ld}\n",
+		bytes, plan->xmlbytes, plan->totalfixture, plan->totalconnectnum,
+		plan->totalsplice, plan->totalcomp, PerfRate(bytes, &histo) / 1e6,
+		PerfRate(plan->totalconnectnum, &histo), rss, peak - rss);
+	for (it = 0; it < PARSER_MAX; it++) {
+		if (0 == plan->parserstat[it].calls) {
+			continue;
+		}
+		fprintf(out, "{\"bench\":\"parser\",\"name\":\"%s\",\"calls\":%lu,\"bytes\":%llu,"
+			"\"ns\":%llu,\"mb_per_s\":%.2f}\n", parsernames[it], plan->parserstat[it].calls,
+			plan->parserstat[it].bytes, plan->parserstat[it].ns,
+			plan->parserstat[it].ns ? plan->parserstat[it].bytes * 1e3 / plan->parserstat[it].ns : 0.0);
+	}
+
+	HistoReset(&histo);
+	for (it = 0; it < g_perfiterations; it++) {
+		ResetExpect(plan);
+		start = NowNs();
+		if (BuildADCArray(plan) < 0) {
+			fclose(out);
+			return -1;
+		}
+		HistoAdd(&histo, NowNs() - start);
+	}
+	PerfPrint(out, "build", &histo);
+	fprintf(out, ",\"connections_per_s\":%.0f}\n", PerfRate(plan->totalconnectnum, &histo));
+
+	HistoReset(&histo);
+	TPInit(&prog);
+	for (it = 0; it < g_perfiterations; it++) {
+		TPFree(&prog);
+		start = NowNs();
+		if (CompilePlan(plan, &prog, &options) < 0) {
+			fclose(out);
+			return -1;
+		}
+		HistoAdd(&histo, NowNs() - start);
+	}
+	PerfPrint(out, "compile", &histo);
+	fprintf(out, ",\"twostage\":%d,\"instructions\":%d,\"instructions_per_s\":%.0f}\n",
+		options.twostage, prog.count, PerfRate(prog.count, &histo));
+
+	HistoReset(&histo);
+	for (it = 0; it < g_perfiterations; it++) {
+		start = NowNs();
+		TPExecute(&prog, &perfops, &stats);
+		HistoAdd(&histo, NowNs() - start);
+	}
+	PerfPrint(out, "classify", &histo);
+	fprintf(out, ",\"checks\":%d,\"checks_per_s\":%.0f}\n", stats.checks,
+		PerfRate(stats.checks, &histo));
+	TPFree(&prog);
+
+	for (m = 0; m < g_perfmodelnum; m++) {
+		g_simlatency = g_perfmodels[m].latency;
+		for (pass = 0; pass < 2; pass++) {
+			options.twostage = pass;
+			g_totaltested = g_totalfail = 0;
+			if (CompilePlan(plan, &prog, &options) < 0) {
+				fclose(out);
+				return -1;
+			}
+			SimLoadPlan(plan);
+			start = NowNs();
+			ScanPlan(&prog, -1, &stats);
+			start = NowNs() - start;
+			SimGetCounter(&counter);
+			TPFree(&prog);
+
+			fprintf(out, "{\"bench\":\"scan\",\"model\":\"%s\",\"gpio_us\":%.1f,"
+				"\"convert_us\":%.1f,\"tau_us\":%.1f,\"settle_us\":%d,\"samples\":%d,"
+				"\"mode\":\"%s\",\"pairs\":%d,\"fails\":%d,\"reads\":%d,\"screens\":%d,"
+				"\"ioctls\":%lu,\"gpio_writes\":%lu,\"sim_ms\":%.1f,\"wall_ms\":%.3f}\n",
+				g_perfmodels[m].name, g_simlatency.gpio_us, g_simlatency.convert_us,
+				g_simlatency.settle_tau_us, options.settle_us, options.samples,
+				pass ? "two-stage" : "precise", g_totaltested, g_totalfail,
+				stats.measures, stats.screens, counter.converts, counter.gpiowrites,
+				SimClock() / 1000, start / 1e6);
+		}
+	}
+	g_simlatency = latency;
+
+	fflush(stdout);
+	fflush(out);
+	dup2(fileno(out), STDOUT_FILENO);
+	fclose(out);
+	return 0;
+}
+
+// Load the NXF programs of the next shift: parse, validate and compile
+// every file, -c dir keeps the compiled plans for -p.
+static int RunBatch(char **filenames, int count) {
+	struct stbatch batch;
+	unsigned long long ns;
+	int threads = BatchThreads();
+	int failed = 0;
+	int i;
+
+	batch.files = calloc(count, sizeof(struct stbatchfile));
+	if (NULL == batch.files) {
+		printf("batch alloc fail!\n");
+		return -1;
+	}
+	batch.count = count;
+	for (i = 0; i < count; i++) {
+		batch.files[i].filename = filenames[i];
+	}
+
+	ns = BatchPool(&batch, threads);
+	for (i = 0; i < count; i++) {
+		printf("%s %s: %d connections, %d instructions, %d errors, %.1f ms\n",
+			batch.files[i].ret ? "FAIL" : "OK", batch.files[i].filename,
+			batch.files[i].connections, batch.files[i].instructions,
+			batch.files[i].errors, batch.files[i].ns / 1e6);
+		failed += (0 != batch.files[i].ret);
+	}
+	printf("Batch %d files, %d FAIL, %d threads, %.1f ms, %.1f files/s\n", count, failed,
+		threads, ns / 1e6, count * 1e9 / ns);
+	free(batch.files);
+	return failed ? -1 : 0;
+}
+
+// files/s of the batch from one thread up to -j threads, the file list
+// repeated -i times; one JSON line per thread count
+static int RunBatchPerf(char **filenames, int count) {
+	struct stbatch batch;
+	unsigned long long ns;
+	double single = 0;
+	double rate;
+	int maxthreads = BatchThreads();
+	int threads;
+	int failed;
+	int i;
+
+	batch.count = count * g_perfiterations;
+	batch.files = calloc(batch.count, sizeof(struct stbatchfile));
+	if (NULL == batch.files) {
+		printf("batch alloc fail!\n");
+		return -1;
+	}
+
+	for (threads = 1; ; threads = (threads * 2 < maxthreads) ? threads * 2 : maxthreads) {
+		memset(batch.files, 0, batch.count * sizeof(struct stbatchfile));
+		for (i = 0; i < batch.count; i++) {
+			batch.files[i].filename = filenames[i % count];
+		}
+		ns = BatchPool(&batch, threads);
+		failed = 0;
+		for (i = 0; i < batch.count; i++) {
+			failed += (0 != batch.files[i].ret);
+		}
+		rate = batch.count * 1e9 / ns;
+		if (1 == threads) {
+			single = rate;
+		}
+		printf("{\"bench\":\"batch\",\"threads\":%d,\"files\":%d,\"failed\":%d,"
+			"\"ms\":%.1f,\"files_per_s\":%.1f,\"speedup\":%.2f}\n", threads,
+			batch.count, failed, ns / 1e6, rate, rate / single);
+		fflush(stdout);
+		if (threads == maxthreads) {
+			break;
+		}
+	}
+	free(batch.files);
+	return 0;
+}
+
+// Long-running station: harness types are switched with "load", which
+// takes the compiled plan from the cache when the file did not change,
+// so a switch back to a recent harness does not parse nor build again.
+static int RunStation() {
+	struct stplancache *cache;
+	struct stcompiled *current = NULL;
+	struct stplan *mainplan = g_plan;
+	struct stxtoptions options;
+	char filename[PC_NAME_SIZE];
+	char line[512];
+	unsigned long long start;
+	int adc_fd;
+	int cached, stale;
+	int touched;
+	int ret;
+
+	CliOptions(&options);
+	cache = PCOpen(g_cacheplans, g_cachebudget, FreeCompiled);
+	if (NULL == cache) {
+		return -1;
+	}
+
+	printf("\nStart ADC...\n");
+	ExportALLOut0();
+	adc_fd = OpenADC();
+	atexit(PhaseDumpExit);
+
+	printf("station: load <file.nxf>, scan, cache, quit\n");
+	fflush(stdout);
+	for (;;) {
+		// an idle station answers SIGUSR1 too
+		PhaseSignalFlags(0);
+		if (g_phasedump) {
+			g_phasedump = 0;
+			PhaseDump(stderr);
+		}
+		if (NULL == fgets(line, sizeof(line), stdin)) {
+			if (ferror(stdin) && (EINTR == errno)) {
+				clearerr(stdin);
+				continue;
+			}
+			break;
+		}
+		PhaseSignalFlags(SA_RESTART);
+		if (1 == sscanf(line, "load %255s", filename)) {
+			start = NowNs();
+			current = PCGet(cache, filename, &stale);
+			cached = (NULL != current) && !stale;
+			if (stale) {
+				current = RebuildFile(current, filename, &options, &touched);
+				if (NULL != current) {
+					printf("rebuilt %s: %d points built again\n", filename, touched);
+				}
+			} else if (!cached) {
+				current = CompileFile(filename, &options);
+			}
+			if (!cached) {
+				if ((NULL == current) || (PCPut(cache, filename, current,
+					CompiledBytes(current)) < 0)) {
+					printf("load %s FAIL\n", filename);
+					if (NULL != current) {
+						FreeCompiled(current);
+					}
+					current = NULL;
+					g_plan = mainplan;
+					fflush(stdout);
+					continue;
+				}
+			}
+			g_plan = current->plan;
+			printf("load %s: %s, %d instructions, %.3f ms\n", filename,
+				cached ? "cached" : (stale ? "rebuilt" : "compiled"), current->prog.count,
+				(NowNs() - start) / 1e6);
+		} else if (0 == strncmp(line, "scan", 4)) {
+			if (NULL == current) {
+				printf("scan: no plan loaded\n");
+			} else if ((BeginRun(current->filename, &current->prog) < 0) || (SimLoad(NULL) < 0)) {
+				printf("scan %s FAIL\n", current->filename);
+			} else {
+				if (g_realtime) {
+					ret = RealtimeScan(&current->prog, adc_fd, &g_scanstats);
+				} else {
+					ret = ScanPlan(&current->prog, adc_fd, &g_scanstats);
+				}
+				EndRun();
+				if (ret < 0) {
+					printf("scan %s FAIL\n", current->filename);
+				}
+			}
+		} else if (0 == strncmp(line, "cache", 5)) {
+			PCPrint(cache, stdout);
+		} else if (0 == strncmp(line, "quit", 4)) {
+			break;
+		} else if (line[0] != '\n') {
+			printf("unknown command: %s", line);
+		}
+		fflush(stdout);
+	}
+
+	g_plan = mainplan;
+	PCClose(cache);
+	UnexportALL();
+	CloseADC(adc_fd);
+	return 0;
+}
+
+// Compile old.nxf, then build new.nxf from it incrementally, and check
+// the result against the full build of new.nxf
+static int RunRebuild(const char *oldname, const char *newname) {
+	struct stcompiled *old, *rebuilt, *full;
+	struct stxtoptions options;
+	struct stplan *parsed;
+	unsigned long long start;
+	double parsems, rebuildms, fullms;
+	int touched = 0;
+	int same;
+
+	CliOptions(&options);
+	old = CompileFile(oldname, &options);
+	if (NULL == old) {
+		printf("compile %s FAIL\n", oldname);
+		return -1;
+	}
+
+	// both builds parse the whole file first
+	parsed = NewPlan(newname, 0);
+	start = NowNs();
+	if (NULL != parsed) {
+		ParsePlan(parsed, newname);
+		free(parsed);
+	}
+	parsems = (NowNs() - start) / 1e6;
+
+	start = NowNs();
+	rebuilt = RebuildFile(old, newname, &options, &touched);
+	rebuildms = (NowNs() - start) / 1e6;
+	start = NowNs();
+	full = CompileFile(newname, &options);
+	fullms = (NowNs() - start) / 1e6;
+	if ((NULL == rebuilt) || (NULL == full)) {
+		printf("rebuild %s FAIL\n", newname);
+		FreeCompiled(old);
+		if (rebuilt) {
+			FreeCompiled(rebuilt);
+		}
+		if (full) {
+			FreeCompiled(full);
+		}
+		return -1;
+	}
+
+	same = (0 == memcmp(rebuilt->plan->adcarray, full->plan->adcarray, sizeof(full->plan->adcarray)))
+		&& (rebuilt->prog.count == full->prog.count)
+		&& (0 == memcmp(rebuilt->prog.code, full->prog.code, full->prog.count * sizeof(struct stinstr)));
+	printf("Rebuild %s from %s: %d points built again, %.3f ms, full build %.3f ms, parse %.3f ms of both\n",
+		newname, oldname, touched, rebuildms, fullms, parsems);
+	printf("Rebuild %d instructions, full build %d instructions, %s\n", rebuilt->prog.count,
+		full->prog.count, same ? "identical" : "differs!");
+
+	FreeCompiled(old);
+	FreeCompiled(rebuilt);
+	FreeCompiled(full);
+	return same ? 0 : -1;
+}
+
+// keep the learned statistics and sample budget with the plan
+// -u -c compiles the NXF again on every run: go on with the statistics
+// and the budget the last run saved, as long as the checks are the same
+static void BudgetMerge(struct stprogram *prog, const char *filename) {
+	struct stprogram saved;
+
+	if (access(filename, R_OK) < 0) {
+		return; // the first run
+	}
+	if (TPLoad(&saved, filename) < 0) {
+		return;
+	}
+	if (!TPSameChecks(prog, &saved)) {
+		printf("Budget: %s holds other checks, statistics start over\n", filename);
+		TPFree(&saved);
+		return;
+	}
+	TPFree(prog);
+	*prog = saved;
+	printf("Budget: statistics of %s kept\n", filename);
+}
+
+static void BudgetSave(struct stprogram *prog) {
+	const char *filename = g_planfilename[0] ? g_planfilename : g_savefilename;
+	int measures = 0;
+	int least = 0;
+	int most = 0;
+	int samples = 0;
+	int pc;
+
+	if (0 == filename[0]) {
+		printf("Budget: no -p/-c plan, statistics not saved\n");
+		return;
+	}
+	for (pc = 0; pc < prog->count; pc++) {
+		if (TP_MEASURE == prog->code[pc].op) {
+			measures++;
+			samples += prog->code[pc].samples;
+			least += (prog->code[pc].samples <= g_budgetpolicy.minsamples);
+			most += (prog->code[pc].samples >= g_budgetpolicy.maxsamples);
+		}
+	}
+	if (0 == TPSave(prog, filename)) {
+		printf("Save plan %s: %d measurements, %.2f samples average, %d at least, %d at most\n",
+			filename, measures, measures ? (float)samples / measures : 0, least, most);
+	}
+}
+
+int main(int argc, char **argv) {
+	struct stxtoptions options;
+	int adc_fd = -1;
+	int i = 0;
+	int j = 0;
+	int c = 0;
+	int perf = 0;
+	int batch = 0;
+	int station = 0;
+	int rebuild = 0;
+	int cachemb = CACHE_BUDGET_MB;
+	int ret = 0;
+
+	while ((c = getopt(argc, argv, "hf:o:H:S:r:sn:t:xe:qc:p:uR:i:L:j:m:M:F:")) > 0) {
+		switch (c) {
+		case 'i':
+			g_perfiterations = atoi(optarg);
+			if (g_perfiterations < 1) {
+				g_perfiterations = 1;
+			}
+			break;
+		case 'L':
+			if (!g_perfusermodel) {
+				g_perfusermodel = 1;
+				g_perfmodelnum = 0;
+			}
+			if (g_perfmodelnum < PERF_MODELS_MAX) {
+				struct stperfmodel *model = &g_perfmodels[g_perfmodelnum];
+
+				model->latency.noise = 1.5;
+				if (sscanf(optarg, "%f,%f,%f,%f", &model->latency.gpio_us,
+					&model->latency.convert_us, &model->latency.settle_tau_us,
+					&model->latency.noise) < 3) {
+					usage();
+					return -1;
+				}
+				snprintf(model->name, sizeof(model->name), "model%d", g_perfmodelnum);
+				g_perfmodelnum++;
+			}
+			break;
+		case 'j':
+			g_batchthreads = atoi(optarg);
+			break;
+		case 'm':
+			sscanf(optarg, "%d:%d", &g_cacheplans, &cachemb);
+			g_cachebudget = cachemb * 1048576ULL;
+			break;
+		case 'R':
+			sscanf(optarg, "%d:%d", &g_rtcpu, &g_rtprio);
+			g_realtime = 1;
+			break;
+		case 'c':
+			snprintf(g_savefilename, sizeof(g_savefilename), "%s", optarg);
+			break;
+		case 'p':
+			snprintf(g_planfilename, sizeof(g_planfilename), "%s", optarg);
+			break;
+		case 'u':
+			g_budget = 1;
+			break;
+		case 's':
+			g_twostage = 1;
+			break;
+		case 'n':
+			g_samples = atoi(optarg);
+			break;
+		case 't':
+			g_settleus = atoi(optarg);
+			break;
+		case 'x':
+			g_simulate = 1;
+			break;
+		case 'e':
+			snprintf(g_expectfilename, sizeof(g_expectfilename), "%s", optarg);
+			g_simulate = 1;
+			break;
+		case 'q':
+			g_quiet = 1;
+			break;
+		case 'H':
+			snprintf(g_historydir, sizeof(g_historydir), "%s", optarg);
+			break;
+		case 'M':
+			snprintf(g_livename, sizeof(g_livename), "%s", optarg);
+			break;
+		case 'F':
+			snprintf(g_fbname, sizeof(g_fbname), "%s", optarg);
+			break;
+		case 'S':
+			snprintf(g_serial, sizeof(g_serial), "%s", optarg);
+			break;
+		case 'o':
+			snprintf(g_resultfilename, sizeof(g_resultfilename), "%s", optarg);
+			break;
+		case 'f':
+			snprintf(g_failfilename, sizeof(g_failfilename), "%s", optarg);
+			break;
+		case 'r':
+			snprintf(g_retestfilename, sizeof(g_retestfilename), "%s", optarg);
+			g_retest = 1;
+			break;
+		case 'h':
+		default:
+			usage();
+			return -1;
+		}
+	}
+
+	perf = (argc - optind >= 2) && (strcmp(argv[optind], "perf") == 0);
+	batch = (argc - optind >= 2) && (strcmp(argv[optind], "batch") == 0);
+	station = (argc - optind == 1) && (strcmp(argv[optind], "station") == 0);
+	rebuild = (argc - optind == 3) && (strcmp(argv[optind], "rebuild") == 0);
+	// perf writes JSON lines, the banner goes aside
+	fprintf(perf ? stderr : stdout, "ADC test build %s-%s\n", __DATE__, __TIME__);
+	if ((argc - optind != 1) && !(g_planfilename[0] && (argc == optind)) && !perf && !batch && !rebuild) {
+		usage();
+		return -1;
+	}
+
+	if (g_planfilename[0] && g_retest) {
+		printf("retest needs the NXF, not a compiled plan\n");
+		return -1;
+	}
+
+	for (i = 0; i < MAXCHANNEL; i++) {
+		g_gpiofd[i] = -1;
+	}
+
+	g_plan = NewPlan((optind < argc) ? argv[optind] : g_planfilename, 1);
+	if (NULL == g_plan) {
+		return -1;
+	}
+
+	if ((optind < argc) && (strcmp(argv[optind], "selftest") == 0)) {
+		printf("perform selftest...\n");
+		SelfTest();
+		return 0;
+	}
+
+    /*
+     * this initialize the library and check potential ABI mismatches
+     * between the version it was compiled for and the actual shared
+     * library used, once before the parser threads
+     */
+    LIBXML_TEST_VERSION
+
+	if (g_livename[0]) {
+		g_live = LSOpen(g_livename, 1);
+		if (NULL == g_live) {
+			return -1;
+		}
+	}
+	if (g_fbname[0]) {
+		g_fb = FBOpen(g_fbname);
+		if (NULL == g_fb) {
+			return -1;
+		}
+	}
+	if (station) {
+		ret = RunStation();
+		xmlCleanupParser();
+		return ret;
+	}
+	if (rebuild) {
+		ret = RunRebuild(argv[optind + 1], argv[optind + 2]);
+		xmlCleanupParser();
+		return ret;
+	}
+	if (batch) {
+		ret = RunBatch(&argv[optind + 1], argc - optind - 1);
+		xmlCleanupParser();
+		return ret;
+	}
+	if (perf && (argc - optind > 2)) {
+		ret = RunBatchPerf(&argv[optind + 1], argc - optind - 1);
+		xmlCleanupParser();
+		return ret;
+	}
+	if (perf) {
+		ret = RunPerf(g_plan, argv[optind + 1]);
+		xmlCleanupParser();
+		return ret;
+	}
+
+	if (g_planfilename[0]) {
+		if (TPLoad(&g_program, g_planfilename) < 0) {
+			return -1;
+		}
+		printf("Load plan %s: %d instructions\n", g_planfilename, g_program.count);
+	} else {
+		// the bench harness only exists on the simulated mux/ADC
+		if (strcmp(argv[optind], "bench") == 0) {
+			g_simulate = 1;
+		}
+		if (ParsePlan(g_plan, argv[optind]) < 0) {
+			printf("parse %s FAIL, %d errors\n", argv[optind], g_plan->errors);
+			xmlCleanupParser();
+			return -1;
+		}
+    /*
+     * Cleanup function for the XML library.
+     */
+    xmlCleanupParser();
+    /*
+     * this is to debug memory for regression tests
+     */
+    xmlMemoryDump();
+		if (BuildADCArray(g_plan) < 0) {
+			return -1;
+		}
+
+		if (g_retest) {
+			if (SelectRetestPairs(g_plan, g_retestfilename) < 0) {
+				return -1;
+			}
+		}
+
+		CliOptions(&options);
+		if (CompilePlan(g_plan, &g_program, &options) < 0) {
+			return -1;
+		}
+		if (g_budget && g_savefilename[0]) {
+			BudgetMerge(&g_program, g_savefilename);
+		}
+		if (g_savefilename[0] && (0 == TPSave(&g_program, g_savefilename))) {
+			printf("Save plan %s\n", g_savefilename);
+		}
+	}
+	if (g_budget) {
+		if (TPEnableStats(&g_program) < 0) {
+			return -1;
+		}
+		g_budgetpolicy.settle_us = g_settleus;
+		printf("Budget: %d measurements changed\n", TPBudget(&g_program, &g_budgetpolicy));
+	}
+
+	if (BeginRun(g_planfilename[0] ? g_planfilename : argv[optind], &g_program) < 0) {
+		return -1;
+	}
+#if 1
+	printf("\nStart ADC...\n");
+
+	ExportALLOut0();
+	adc_fd = OpenADC();
+	
+	if (SimLoad(g_planfilename[0] ? &g_program : NULL) < 0) {
+		return -1;
+	}
+
+	atexit(PhaseDumpExit);
+	signal(SIGUSR1, PhaseSignal);
+
+	if (!g_planfilename[0] && (strcmp(argv[optind], "bench") == 0)) {
+		SimInjectFaults(g_plan);
+		RunScanBench(g_plan, adc_fd);
+	} else if (g_realtime) {
+		ret = RealtimeScan(&g_program, adc_fd, &g_scanstats);
+	} else {
+		ret = ScanPlan(&g_program, adc_fd, &g_scanstats);
+	}
+	if (g_budget) {
+		BudgetSave(&g_program);
+	}
+	EndRun();
 
 // TODO if all connection test PASS, display the test result, and replace the cables; 
 // TODO when all connection are open, then start a new tests
 // TODO step2 test all connections in the used-pin list
 	printf("Test all used points:\n");
 	for (i = 0; i < MAXCHANNEL; i++) {
-		if (allUsedpoints[i] != -1) {
-			printf("%d\n", i);
+		if (g_plan->allUsedpoints[i] != -1) {
+			SCANLOG("%d\n", i);
 		}
 	}
 	
 	for (i = 0; i < MAXCHANNEL; i++) {
-		if (allUsedpoints[i] == -1) {
+		if (g_plan->allUsedpoints[i] == -1) {
 			continue;
 		};
 		for (j = i; j < MAXCHANNEL; j++) {
-			if (allUsedpoints[j] == -1) {
+			if (g_plan->allUsedpoints[j] == -1) {
 				continue;
 			};
-			printf("Test %d-%d\n", i, j);
+			SCANLOG("Test %d-%d\n", i, j);
 		}
 	}
    UnexportALL();
    CloseADC(adc_fd);
 #endif
-    return(0);
+	LSClose(g_live); // the segment stays for the readers of the last run
+	FBClose(g_fb);     // and the status on the screen
+    return (ret < 0) ? -1 : 0;
 }
+#endif // XT_LIBRARY
 
 #else
 #endif
@@ -0,0 +1,66 @@
+#ifndef XTENGINE_H
+#define XTENGINE_H
+
+/*
+ * The test engine of xmltest as a library, for the GUI to run a scan in
+ * its own process: xmltest.c built with -DXT_LIBRARY, without main().
+ *
+ * An engine is one context: its compiled plan, options and callbacks.
+ * Parsing and building run on the thread of the engine and do not share
+ * state, so engines load plans side by side. The mux and the ADC are one
+ * per station: the scans of the engines take turns, and the hardware is
+ * opened by the first engine and closed by the last one.
+ *
+ * XTStart() returns at once. The callbacks run on the thread of the engine,
+ * loaded once the plan is built with the points and pairs it measures,
+ * result for every checked pair, progress every XT_PROGRESS_PAIRS pairs
+ * and at the end, done once with the status of the run.
+ */
+
+#include "resultsink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define XT_PROGRESS_PAIRS (256)
+
+#define XT_SAMPLES_DEFAULT (4)
+
+#define XT_OK (0)
+#define XT_FAIL (-1)
+#define XT_CANCELLED (1)
+
+struct stxtoptions {
+	int simulate;           // the simulated harness of hwsim.c
+	int quiet;              // only print the FAIL lines
+	const char *serial;     // of the harness, NULL "-"
+	const char *faillist;   // NULL xmltest.fail
+	const char *historydir; // append the results, NULL none
+	int twostage;           // screen the expected opens first
+	int samples;            // averaged per measurement, 0 XT_SAMPLES_DEFAULT
+	int settle_us;          // after a mux switch, precision only
+};
+
+struct stxtcallbacks {
+	void (*loaded)(void *arg, int points, unsigned int pairs);
+	void (*result)(void *arg, const struct stresult *result);
+	void (*progress)(void *arg, unsigned int tested, unsigned int pairs, unsigned int fails);
+	void (*done)(void *arg, int status);
+	void *arg;
+};
+
+struct stxtengine;
+
+struct stxtengine *XTCreate(const struct stxtoptions *options, const struct stxtcallbacks *callbacks);
+void XTDestroy(struct stxtengine *engine);
+int XTStart(struct stxtengine *engine, const char *filename);
+void XTCancel(struct stxtengine *engine);
+int XTWait(struct stxtengine *engine);
+const char *XTPointName(const struct stxtengine *engine, int point);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // XTENGINE_H
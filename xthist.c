@@ -0,0 +1,265 @@
+/*
+ * xthist.c: queries on the result history written by xmltest -H
+ *
+ * xthist [-d days] [-s serial] dir fails 12-57
+ * xthist [-d days] [-s serial] dir resist R1|12-57
+ * xthist [-d days] [-s serial] dir runs
+ *
+ * gcc -o xthist /xthist.c /history.c /testplan.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "history.h"
+#include "testplan.h"
+
+#define MAXPAIRS (64)
+#define HISTO_BINS (10)
+
+int g_days = 7;
+char g_serial[HS_SERIAL_SIZE] = "";
+
+static double NowMs() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int SerialMatch(const struct sthistory *hs, unsigned int run) {
+	const struct sthsrun *r;
+
+	if (0 == g_serial[0]) {
+		return 1;
+	}
+	r = HSGetRun(hs, run);
+	return (NULL != r) && (0 == strcmp(r->serial, g_serial));
+}
+
+static void PrintTime(unsigned int t) {
+	char buffer[32];
+	time_t tt = t;
+
+	strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", localtime(&tt));
+	printf("%s", buffer);
+}
+
+// A plan scans a pair as A-B or as B-A, so both chains of the pair are
+// walked; rows are appended in time order, the larger index is the newer.
+static void PairNewest(const struct sthistory *hs, int pointA, int pointB, unsigned int *chain) {
+	chain[0] = HSNewest(hs, pointA, pointB);
+	chain[1] = (pointA != pointB) ? HSNewest(hs, pointB, pointA) : HS_NONE;
+}
+
+static unsigned int PairOlder(const struct sthistory *hs, unsigned int *chain) {
+	unsigned int *from = ((HS_NONE == chain[1]) || ((HS_NONE != chain[0]) && (chain[0] > chain[1]))) ? &chain[0] : &chain[1];
+	unsigned int index = *from;
+
+	if (HS_NONE != index) {
+		*from = HSOlder(hs, index);
+	}
+	return index;
+}
+
+static int QueryFails(const struct sthistory *hs, int pointA, int pointB, unsigned int since) {
+	struct sthsrow row;
+	unsigned int chain[2];
+	unsigned int index;
+	int rows = 0;
+	int fails = 0;
+
+	PairNewest(hs, pointA, pointB, chain);
+	while (HS_NONE != (index = PairOlder(hs, chain))) {
+		HSGetRow(hs, index, &row);
+		if (row.time < since) {
+			break; // older rows follow
+		}
+		rows++;
+		if (row.pass || !SerialMatch(hs, row.run)) {
+			continue;
+		}
+		fails++;
+		PrintTime(row.time);
+		printf(" %s %d-%d %s expect %g R %f ADC0 %f ADC2 %f\n",
+			HSGetRun(hs, row.run)->serial, row.pointA, row.pointB,
+			TPVerdictName(row.verdict), row.expect, row.resist, row.adc0, row.adc2);
+	}
+	printf("%d-%d: %d FAIL in %d results\n", pointA, pointB, fails, rows);
+	return fails;
+}
+
+static int CompareFloat(const void *a, const void *b) {
+	float fa = *(const float *)a;
+	float fb = *(const float *)b;
+
+	return (fa > fb) - (fa < fb);
+}
+
+static int QueryResist(const struct sthistory *hs, const char *what, unsigned int since) {
+	int pointA[MAXPAIRS], pointB[MAXPAIRS];
+	const char *plan[MAXPAIRS];
+	int bins[HISTO_BINS] = {0};
+	struct sthsrow row;
+	unsigned int chain[2];
+	unsigned int index;
+	float *values = NULL;
+	float *grow;
+	double sum = 0, sum2 = 0, mean, width;
+	int size = 0;
+	int count = 0;
+	int pairs;
+	int i, bin;
+
+	if (2 == sscanf(what, "%d-%d", &pointA[0], &pointB[0])) {
+		plan[0] = NULL;
+		pairs = 1;
+	} else {
+		pairs = HSFindLabel(hs, what, pointA, pointB, plan, MAXPAIRS);
+		if (0 == pairs) {
+			printf("%s: no such label\n", what);
+			return -1;
+		}
+	}
+
+	for (i = 0; i < pairs; i++) {
+		PairNewest(hs, pointA[i], pointB[i], chain);
+		if (NULL != plan[i]) {
+			chain[1] = HS_NONE; // a label lists both directions itself
+		}
+		while (HS_NONE != (index = PairOlder(hs, chain))) {
+			HSGetRow(hs, index, &row);
+			if (row.time < since) {
+				break;
+			}
+			if (!SerialMatch(hs, row.run)) {
+				continue;
+			}
+			// the label names this pair in its own plan only
+			if ((NULL != plan[i]) && strcmp(HSGetRun(hs, row.run)->plan, plan[i])) {
+				continue;
+			}
+			if (count == size) {
+				size = size ? size * 2 : 1024;
+				grow = realloc(values, size * sizeof(float));
+				if (NULL == grow) {
+					printf("alloc fail!\n");
+					free(values);
+					return -1;
+				}
+				values = grow;
+			}
+			values[count++] = row.resist;
+			sum += row.resist;
+			sum2 += (double)row.resist * row.resist;
+		}
+	}
+
+	printf("%s:", what);
+	for (i = 0; i < pairs; i++) {
+		printf(" %d-%d%s%s", pointA[i], pointB[i], plan[i] ? "@" : "", plan[i] ? plan[i] : "");
+	}
+	printf(", %d results\n", count);
+	if (0 == count) {
+		free(values);
+		return 0;
+	}
+
+	qsort(values, count, sizeof(float), CompareFloat);
+	mean = sum / count;
+	printf("min %f p5 %f p50 %f p95 %f max %f mean %f std %f\n", values[0],
+		values[count * 5 / 100], values[count / 2], values[count * 95 / 100],
+		values[count - 1], mean, sqrt(fabs(sum2 / count - mean * mean)));
+
+	width = (values[count - 1] - values[0]) / HISTO_BINS;
+	for (i = 0; i < count; i++) {
+		bin = (width > 0) ? (values[i] - values[0]) / width : 0;
+		bins[(bin < HISTO_BINS) ? bin : HISTO_BINS - 1]++;
+	}
+	for (i = 0; i < HISTO_BINS; i++) {
+		printf("%12f %6d ", values[0] + i * width, bins[i]);
+		for (bin = 0; bin < bins[i] * 50 / count; bin++) {
+			putchar('#');
+		}
+		putchar('\n');
+	}
+	free(values);
+	return 0;
+}
+
+static void QueryRuns(const struct sthistory *hs, unsigned int since) {
+	const struct sthsrun *r;
+	unsigned int run;
+
+	for (run = 0; run < HSRuns(hs); run++) {
+		r = HSGetRun(hs, run);
+		if ((r->time < since) || !SerialMatch(hs, run)) {
+			continue;
+		}
+		PrintTime(r->time);
+		printf(" run %u %s %s %u pairs %u FAIL\n", run, r->serial, r->plan, r->count, r->fails);
+	}
+}
+
+static void usage() {
+	printf("xthist [options] dir fails A-B\n");
+	printf("xthist [options] dir resist <label|A-B>\n");
+	printf("xthist [options] dir runs\n");
+	printf("  -d days  only the last days (default 7, 0 all)\n");
+	printf("  -s serial  only this harness serial\n");
+}
+
+int main(int argc, char **argv) {
+	struct sthistory *hs;
+	unsigned int since = 0;
+	int pointA, pointB;
+	double start;
+	int ret = 0;
+	int c;
+
+	while ((c = getopt(argc, argv, "hd:s:")) > 0) {
+		switch (c) {
+		case 'd':
+			g_days = atoi(optarg);
+			break;
+		case 's':
+			snprintf(g_serial, sizeof(g_serial), "%s", optarg);
+			break;
+		case 'h':
+		default:
+			usage();
+			return -1;
+		}
+	}
+	if (argc - optind < 2) {
+		usage();
+		return -1;
+	}
+
+	hs = HSOpen(argv[optind], 0);
+	if (NULL == hs) {
+		return -1;
+	}
+	if (g_days > 0) {
+		since = time(NULL) - g_days * 24 * 3600;
+	}
+
+	start = NowMs();
+	if ((0 == strcmp(argv[optind + 1], "fails")) && (argc - optind == 3)
+		&& (2 == sscanf(argv[optind + 2], "%d-%d", &pointA, &pointB))) {
+		QueryFails(hs, pointA, pointB, since);
+	} else if ((0 == strcmp(argv[optind + 1], "resist")) && (argc - optind == 3)) {
+		ret = QueryResist(hs, argv[optind + 2], since);
+	} else if (0 == strcmp(argv[optind + 1], "runs")) {
+		QueryRuns(hs, since);
+	} else {
+		usage();
+		ret = -1;
+	}
+	printf("%u results, %u runs, query %.2f ms\n", HSRows(hs), HSRuns(hs), NowMs() - start);
+
+	HSClose(hs);
+	return ret;
+}